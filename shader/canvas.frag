@@ -0,0 +1,9 @@
+#version 460 core
+
+in vec4 varying_color;
+out vec4 frag_color;
+
+void main()
+{
+    frag_color = varying_color;
+}
@@ -0,0 +1,14 @@
+#version 460 core
+
+layout (location = 0) in vec2 vertex_position;
+layout (location = 1) in vec4 vertex_color;
+
+layout (location = 0) uniform mat4 transform;
+
+out vec4 varying_color; // interpolated by rasterizer
+
+void main()
+{
+    gl_Position = transform * vec4(vertex_position, 0.0, 1.0);
+    varying_color = vertex_color;
+}
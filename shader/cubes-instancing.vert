@@ -3,75 +3,39 @@
 layout (location = 0) in vec3 vertex_position;
 layout (location = 1) in vec3 vertex_color;
 
-layout (location = 0) uniform mat4 view_matrix;
-layout (location = 1) uniform mat4 proj_matrix;
-layout (location = 2) uniform float tf;
-
-out vec3 varying_color; // interpolated by rasterizer
-
-// Returns a rotation matrix around the X axis
-mat4 rotate_x(float radians)
+// Written by shader/cubes-cull.comp, or by the CPU fallback
+layout(std430, binding = 0) readonly buffer TMatrix
 {
-    mat4 rx = mat4(
-        1.0, 0.0, 0.0, 0.0,
-        0.0, cos(radians), -sin(radians), 0.0,
-        0.0, sin(radians), cos(radians), 0.0,
-        0.0, 0.0, 0.0, 1.0);
-    return rx;
-}
+    mat4 mvp[]; // indexed by cube
+};
 
-// Returns a rotation matrix around the Y axis
-mat4 rotate_y(float radians)
+// Cubes to draw, indexed from the draw's base instance. Entries hold
+// the cube index and a crossfade code, see src/common/lod.h
+layout(std430, binding = 1) readonly buffer TVisible
 {
-    mat4 ry = mat4(
-        cos(radians), 0.0, sin(radians), 0.0,
-        0.0, 1.0, 0.0, 0.0,
-        -sin(radians), 0.0, cos(radians), 0.0,
-        0.0, 0.0, 0.0, 1.0);
-    return ry;
-}
+    uint visible[];
+};
 
-// Returns a rotation matrix around the Z axis
-mat4 rotate_z(float radians)
-{
-    mat4 rz = mat4(
-        cos(radians), -sin(radians), 0.0, 0.0,
-        sin(radians), cos(radians), 0.0, 0.0,
-        0.0, 0.0, 1.0, 0.0,
-        0.0, 0.0, 0.0, 1.0);
-    return rz;
-}
+layout (location = 0) uniform mat4 u_proj_matrix;
+layout (location = 1) uniform int  u_billboard_lods; // LODs below this are camera-facing quads
 
-// Returns a translation matrix
-mat4 translate(float tx, float ty, float tz)
-{
-    mat4 trans = mat4(
-        1.0, 0.0, 0.0, 0.0,
-        0.0, 1.0, 0.0, 0.0,
-        0.0, 0.0, 1.0, 0.0,
-        tx, ty, tz, 1.0);
-    return trans;
-}
+out vec3 varying_color; // interpolated by rasterizer
+flat out uint varying_fade;
+flat out uint varying_id; // cube index, for shader/id.frag
 
 void main()
 {
-    // Value based on time factor, but different for each cube instance
-    float i = gl_InstanceID + tf;
-
-    mat4 rx = rotate_x(1.75 * i);
-    mat4 ry = rotate_y(1.75 * i);
-    mat4 rz = rotate_z(1.75 * i);
-
-    float tx = sin(0.35 * i) * 8.0;
-    float ty = sin(0.52 * i) * 8.0;
-    float tz = sin(0.70 * i) * 8.0;
-
-    mat4 trans = translate(tx, ty, tz);
+    uint entry = visible[gl_BaseInstance + gl_InstanceID];
+    mat4 m = mvp[entry & 0xffffff];
 
-    // Build the model matrix and then the model-view matrix
-    mat4 model_matrix = trans * rx * ry * rz;
-    mat4 mv_matrix = view_matrix * model_matrix;
+    // Projection is linear, so a view-space offset from the cube's center
+    // becomes a clip-space offset from its projected center
+    if (gl_DrawID < u_billboard_lods)
+        gl_Position = m[3] + u_proj_matrix * vec4(vertex_position.xy, 0.0, 0.0);
+    else
+        gl_Position = m * vec4(vertex_position, 1.0);
 
-    gl_Position = proj_matrix * mv_matrix * vec4(vertex_position, 1.0);
     varying_color = vertex_color;
+    varying_fade = entry >> 24;
+    varying_id = entry & 0xffffff;
 }
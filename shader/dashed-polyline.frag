@@ -0,0 +1,33 @@
+#version 460 core
+
+// Alternating on and off lengths in pixels, starting with on
+layout(std430, binding = 2) readonly buffer TPattern
+{
+    float pattern[];
+};
+
+noperspective in float dist;
+
+out vec4 frag_color;
+
+layout (location = 1) uniform vec4  u_color;
+layout (location = 2) uniform uint  u_pattern_count;
+layout (location = 3) uniform float u_pattern_period; // sum of the pattern
+layout (location = 4) uniform float u_phase;
+
+void main()
+{
+    float d = mod(dist + u_phase, u_pattern_period);
+
+    uint i = 0;
+    while (i + 1 < u_pattern_count && d >= pattern[i])
+    {
+        d -= pattern[i];
+        ++i;
+    }
+
+    // Odd entries are gaps
+    if ((i & 1u) == 1u)
+        discard;
+    frag_color = u_color;
+}
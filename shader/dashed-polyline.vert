@@ -0,0 +1,43 @@
+#version 460 core
+
+// Pulls segment end points for a GL_LINES draw of 2 vertices per segment.
+// A point with w == 0 breaks the polyline, and the segments touching it
+// are moved outside the clip volume.
+
+layout(std430, binding = 0) readonly buffer TVertex
+{
+    vec4 vertex[];
+};
+
+// Distance along the polyline in pixels, see shader/dash-distance.comp
+layout(std430, binding = 1) readonly buffer TDistance
+{
+    float arc_length[];
+};
+
+// Index of the break before each point, whose distance restarts the dash
+// pattern, or 0 for the first polyline
+layout(std430, binding = 3) readonly buffer TStart
+{
+    uint start[];
+};
+
+layout (location = 0) uniform mat4 u_mvp;
+
+noperspective out float dist;
+
+void main()
+{
+    int seg = gl_VertexID / 2;
+    int i   = seg + gl_VertexID % 2;
+
+    if (vertex[seg].w == 0.0 || vertex[seg+1].w == 0.0)
+    {
+        dist = 0.0;
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        return;
+    }
+
+    dist = arc_length[i] - arc_length[start[i]];
+    gl_Position = u_mvp * vertex[i];
+}
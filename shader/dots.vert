@@ -0,0 +1,40 @@
+#version 460 core
+
+layout (location = 0) in vec2 vertex_position; // unit circle fan
+
+struct Dot
+{
+    vec2  position;
+    float radius;
+    uint  color; // RGBA8
+};
+
+layout(std430, binding = 0) readonly buffer TDot
+{
+    Dot dot[];
+};
+
+// Written by shader/dots-cull.comp, indexed from the draw's base instance.
+// Entries hold the dot index and a crossfade code, see src/common/lod.h
+layout(std430, binding = 1) readonly buffer TVisible
+{
+    uint visible[];
+};
+
+layout (location = 0) uniform mat4 u_mvp;
+layout (location = 1) uniform bool u_culled; // false draws every dot
+
+out vec3 varying_color; // interpolated by rasterizer
+flat out uint varying_fade;
+
+const uint OPAQUE = 127;
+
+void main()
+{
+    uint entry = u_culled ? visible[gl_BaseInstance + gl_InstanceID] : uint(gl_InstanceID) | (OPAQUE << 24);
+    Dot d = dot[entry & 0xffffff];
+
+    gl_Position = u_mvp * vec4(d.position + vertex_position * d.radius, 0.0, 1.0);
+    varying_color = unpackUnorm4x8(d.color).rgb;
+    varying_fade = entry >> 24;
+}
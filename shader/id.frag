@@ -0,0 +1,12 @@
+#version 460 core
+
+// Writes the id of the object plus one, so that 0 is left where nothing is
+// drawn, into the R32UI attachment that src/common/picking.h reads back
+
+flat in uint varying_id;
+layout (location = 0) out uint frag_id;
+
+void main()
+{
+    frag_id = varying_id + 1u;
+}
@@ -1,11 +1,11 @@
 #version 460 core
 
-layout(std430, binding = 0) buffer TVertex
+// Points already transformed to window coordinates by shader/polyline-transform.comp
+layout(std430, binding = 1) readonly buffer TScreen
 {
-    vec4 vertex[];
+    vec4 screen[];
 };
 
-uniform mat4  u_mvp;
 uniform vec2  u_resolution;
 uniform float u_thickness;
 
@@ -17,9 +17,7 @@ void main()
     vec4 va[4];
     for (int i=0; i<4; ++i)
     {
-        va[i] = u_mvp * vertex[line_i+i];
-        va[i].xyz /= va[i].w;
-        va[i].xy = (va[i].xy + 1.0) * 0.5 * u_resolution;
+        va[i] = screen[line_i+i];
     }
 
     vec2 v_line  = normalize(va[2].xy - va[1].xy);
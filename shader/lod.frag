@@ -0,0 +1,29 @@
+#version 460 core
+
+// Dithered crossfade between two LODs of an instance. The culling passes
+// append an instance to both LODs while its size is near a LOD threshold,
+// and the two draws keep complementary pixels of a 4x4 Bayer pattern.
+
+in vec3 varying_color;
+flat in uint varying_fade; // crossfade code from the instance list entry, see src/common/lod.h
+out vec4 frag_color;
+
+const float BAYER[16] = float[](
+     0.0,  8.0,  2.0, 10.0,
+    12.0,  4.0, 14.0,  6.0,
+     3.0, 11.0,  1.0,  9.0,
+    15.0,  7.0, 13.0,  5.0);
+
+void main()
+{
+    ivec2 p = ivec2(gl_FragCoord.xy) & 3;
+    float threshold = (BAYER[p.y * 4 + p.x] + 0.5) / 16.0;
+
+    // Codes 0..127 keep the pixels below the weight, codes 128..255 the rest
+    float weight = float(varying_fade & 127u) / 127.0;
+    bool keep = (varying_fade & 128u) == 0u ? threshold < weight : threshold >= weight;
+    if (!keep)
+        discard;
+
+    frag_color = vec4(varying_color, 1.0);
+}
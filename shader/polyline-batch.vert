@@ -0,0 +1,95 @@
+#version 460 core
+
+// Extrudes every segment of every polyline in a PolylineBatch (see
+// src/common/polyline.h) with one draw call of 6 vertices per segment.
+
+struct Polyline
+{
+    uint  first_point;   // index of the first point in screen[]
+    uint  num_points;
+    uint  first_segment; // number of segments in all preceding polylines
+    uint  closed;
+    vec4  color;
+    float thickness;
+};
+
+// Points already transformed to window coordinates by shader/polyline-transform.comp
+layout(std430, binding = 1) readonly buffer TScreen
+{
+    vec4 screen[];
+};
+
+layout(std430, binding = 2) readonly buffer TPolyline
+{
+    Polyline polyline[];
+};
+
+uniform vec2 u_resolution;
+uniform uint u_num_polylines;
+
+flat out vec4 varying_color;
+
+// Returns the polyline that owns segment `seg`, i.e. the last one whose
+// first_segment is not greater than `seg`
+uint find_polyline(uint seg)
+{
+    uint lo = 0;
+    uint hi = u_num_polylines - 1;
+    while (lo < hi)
+    {
+        uint mid = (lo + hi + 1) / 2;
+        if (polyline[mid].first_segment <= seg)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+void main()
+{
+    uint seg   = gl_VertexID / 6;
+    int  tri_i = gl_VertexID % 6;
+
+    Polyline pl = polyline[find_polyline(seg)];
+    uint n = pl.num_points;
+    uint i = seg - pl.first_segment;
+
+    // Closed polylines wrap around; open ones get butt ends by reusing
+    // the segment direction where there is no predecessor or successor.
+    bool closed   = pl.closed != 0;
+    bool has_pred = closed || i > 0;
+    bool has_succ = closed || i + 2 < n;
+
+    vec4 va[4];
+    va[1] = screen[pl.first_point + i];
+    va[2] = screen[pl.first_point + (i + 1) % n];
+    va[0] = has_pred ? screen[pl.first_point + (i + n - 1) % n] : va[1];
+    va[3] = has_succ ? screen[pl.first_point + (i + 2) % n] : va[2];
+
+    vec2 v_line  = normalize(va[2].xy - va[1].xy);
+    vec2 nv_line = vec2(-v_line.y, v_line.x);
+
+    vec4 pos;
+    if (tri_i == 0 || tri_i == 1 || tri_i == 3)
+    {
+        vec2 v_pred  = has_pred ? normalize(va[1].xy - va[0].xy) : v_line;
+        vec2 v_miter = normalize(nv_line + vec2(-v_pred.y, v_pred.x));
+
+        pos = va[1];
+        pos.xy += v_miter * pl.thickness * (tri_i == 1 ? -0.5 : 0.5) / dot(v_miter, nv_line);
+    }
+    else
+    {
+        vec2 v_succ  = has_succ ? normalize(va[3].xy - va[2].xy) : v_line;
+        vec2 v_miter = normalize(nv_line + vec2(-v_succ.y, v_succ.x));
+
+        pos = va[2];
+        pos.xy += v_miter * pl.thickness * (tri_i == 5 ? 0.5 : -0.5) / dot(v_miter, nv_line);
+    }
+
+    pos.xy = pos.xy / u_resolution * 2.0 - 1.0;
+    pos.xyz *= pos.w;
+    gl_Position = pos;
+    varying_color = pl.color;
+}
@@ -2,6 +2,7 @@
 #include <filesystem>
 #include <fmt/core.h>
 #include <GLFW/glfw3.h>
+#include "gltrace.h"
 #include "shader.h"
 #include "utils.h"
 
@@ -159,6 +160,7 @@ int main()
 
     glfwMakeContextCurrent(window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    start_gl_trace(); // to the file named by GLTRACE, if set
     glfwSwapInterval(1); // vsync on
 
     print_info();
@@ -210,6 +212,7 @@ int main()
         process_gamepad(window);
         render(window, glfwGetTime());
         glfwSwapBuffers(window);
+        trace_frame();
         glfwPollEvents();
     }
 
@@ -219,6 +222,7 @@ int main()
     glDeleteBuffers(1, &colors_vbo);
     glDeleteProgram(program);
 
+    stop_gl_trace();
     glfwDestroyWindow(window);
     glfwTerminate();
 
@@ -3,6 +3,7 @@
 #include <fmt/core.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
+#include "gltrace.h"
 #include "shader.h"
 #include "utils.h"
 
@@ -175,6 +176,7 @@ int main()
 
     glfwMakeContextCurrent(window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    start_gl_trace(); // to the file named by GLTRACE, if set
     glfwSwapInterval(1); // vsync on
 
     print_info();
@@ -231,6 +233,7 @@ int main()
         process_gamepad(window);
         render(window, glfwGetTime());
         glfwSwapBuffers(window);
+        trace_frame();
         glfwPollEvents();
     }
 
@@ -239,6 +242,7 @@ int main()
     glDeleteBuffers(1, &vbo);
     glDeleteProgram(program);
 
+    stop_gl_trace();
     glfwDestroyWindow(window);
     glfwTerminate();
 
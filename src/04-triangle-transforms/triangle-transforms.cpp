@@ -5,7 +5,10 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "gltrace.h"
+#include "replay.h"
 #include "shader.h"
+#include "timestep.h"
 #include "utils.h"
 
 // Global variables
@@ -14,6 +17,7 @@ static GLFWcursor* hand_cursor{};
 static float scale{1.0f};
 static float rotate_x{0.0f};
 static float translate_x{0.0f}, translate_y{0.0f};
+static FixedTimestep timestep{};
 
 static std::string window_title()
 {
@@ -71,7 +75,7 @@ static void set_callbacks(GLFWwindow* window)
         window,
         [](GLFWwindow* window, int button, int action, int mods) {
             double xpos{}, ypos{};
-            glfwGetCursorPos(window, &xpos, &ypos);
+            get_cursor_pos(window, &xpos, &ypos);
             if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
                 fmt::print("mouse down {}, {}\n", xpos, ypos);
             }
@@ -85,7 +89,7 @@ static void set_callbacks(GLFWwindow* window)
         [](GLFWwindow* window, double xpos, double ypos) {
             const bool hit = hit_test(window, xpos, ypos, 0.5, -0.5);
             glfwSetCursor(window, hit ? hand_cursor : nullptr);
-            const int state = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT);
+            const int state = get_mouse_button(window, GLFW_MOUSE_BUTTON_LEFT);
             if (state == GLFW_PRESS) {
                 fmt::print("{}, {}\n", xpos, ypos);
             }
@@ -179,7 +183,7 @@ static void render(GLFWwindow* window, double currentTime)
     glDrawArrays(GL_TRIANGLES, 0, 3);
 }
 
-int main()
+int main(int argc, char* argv[])
 {
     glfwSetErrorCallback(
         [](int error, const char* description) {
@@ -191,6 +195,12 @@ int main()
         exit(EXIT_FAILURE);
     }
 
+    // Record with --record <file>, replay with --replay <file>. A replay
+    // animates by whole frames, however long they take to draw.
+    if (start_input_log(argc, argv) == REPLAY_PLAY) {
+        set_deterministic(timestep, REPLAY_FRAME_TIME);
+    }
+
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -204,11 +214,13 @@ int main()
 
     glfwMakeContextCurrent(window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    start_gl_trace(); // to the file named by GLTRACE, if set
     glfwSwapInterval(1); // vsync on
 
     print_info();
     hand_cursor = glfwCreateStandardCursor(GLFW_HAND_CURSOR);
     set_callbacks(window);
+    attach_input_log(window);
 
     program = create_program();
     glUseProgram(program);
@@ -258,16 +270,23 @@ int main()
 
     while (!glfwWindowShouldClose(window)) {
         process_gamepad(window);
-        render(window, glfwGetTime());
+        // The animation is a function of time alone, so the ticks only advance it
+        begin_timestep(timestep, glfwGetTime());
+        while (next_tick(timestep)) {
+        }
+        render(window, timestep_time(timestep));
         glfwSwapBuffers(window);
-        glfwPollEvents();
+        trace_frame();
+        poll_input(window);
     }
+    stop_input_log();
 
     // Shutting down from here onwards
     glDeleteVertexArrays(1, &vao);
     glDeleteBuffers(1, &vbo);
     glDeleteProgram(program);
 
+    stop_gl_trace();
     glfwDestroyWindow(window);
     glfwTerminate();
 
@@ -6,6 +6,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "gltrace.h"
 #include "shader.h"
 #include "utils.h"
 
@@ -202,6 +203,7 @@ int main()
 
     glfwMakeContextCurrent(window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    start_gl_trace(); // to the file named by GLTRACE, if set
     glfwSwapInterval(1); // vsync on
 
     print_info();
@@ -309,6 +311,7 @@ int main()
         process_gamepad(window);
         render(window, glfwGetTime());
         glfwSwapBuffers(window);
+        trace_frame();
         glfwPollEvents();
     }
 
@@ -318,6 +321,7 @@ int main()
     glDeleteBuffers(1, &vbo);
     glDeleteProgram(program);
 
+    stop_gl_trace();
     glfwDestroyWindow(window);
     glfwTerminate();
 
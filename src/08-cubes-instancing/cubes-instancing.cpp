@@ -1,23 +1,82 @@
 #include "glad.h"
+#include <algorithm>
 #include <cmath>
+#include <cstdlib>
 #include <filesystem>
 #include <fmt/core.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <iterator>
+#include <vector>
+#include "cubecull.h"
+#include "framegraph.h"
+#include "frustum.h"
+#include "gltrace.h"
+#include "hiz.h"
+#include "lod.h"
+#include "picking.h"
 #include "shader.h"
 #include "utils.h"
 
 // Global variables
 static GLuint program{};
+static GLuint cull_program{};
+static GLuint id_program{};
+static GLuint matrix_ssbo{};
+static GLuint visible_ssbo{};
+static LodGroup lods{}; // camera-facing quad, then cube
+static GLuint visibility_ssbo{};
+static GLuint stats_buffer{};
+static FrameGraph graph{};
+static FrameGraphStats graph_stats{}; // of the last frame
+static HiZ hiz{};
+static IdPicker picker{};
+static bool pick_requested{};
+static glm::ivec2 pick_pixel{}; // framebuffer pixel to pick, origin at the bottom left
+static GLuint num_instances{24};
+static float spread{8.0f};       // how far cubes move from the center
+static bool cpu_fallback{false}; // cull and compute the matrices on the CPU
+static double cpu_cull_ms{};     // of the last frame culled on the CPU
+static bool fly_camera{false};   // fly through the cubes instead of looking at them
+static bool occlusion_culling{true};
+static float crossfade{0.2f}; // relative width of the LOD crossfade band
+static std::vector<glm::mat4> matrices;
+static std::vector<GLuint> visible_ids;
+
+// Culling phases of shader/cubes-cull.comp, also the sets of LOD buckets
+enum CullPhase : GLuint { EARLY, LATE };
+
+// Matches struct TStats in shader/cubes-cull.comp
+struct CullStats {
+    GLuint frustum_culled{};
+    GLuint occlusion_culled{};
+};
 
 static GLuint create_program()
 {
     namespace fs = std::filesystem;
     return compile_shaders({
         fs::canonical(dirname() / ".." / "shader" / "cubes-instancing.vert").c_str(),
-        fs::canonical(dirname() / ".." / "shader" / "basic.frag").c_str(),
+        fs::canonical(dirname() / ".." / "shader" / "lod.frag").c_str(),
+    });
+}
+
+static GLuint create_id_program()
+{
+    namespace fs = std::filesystem;
+    return compile_shaders({
+        fs::canonical(dirname() / ".." / "shader" / "cubes-instancing.vert").c_str(),
+        fs::canonical(dirname() / ".." / "shader" / "id.frag").c_str(),
+    });
+}
+
+static GLuint create_cull_program()
+{
+    namespace fs = std::filesystem;
+    return compile_shaders({
+        fs::canonical(dirname() / ".." / "shader" / "cubes-cull.comp").c_str(),
     });
 }
 
@@ -27,6 +86,7 @@ static void set_callbacks(GLFWwindow* window)
         window,
         [](GLFWwindow* window, int width, int height) {
             glViewport(0, 0, width, height);
+            resize_hiz(hiz, width, height);
         }
     );
     glfwSetKeyCallback(
@@ -38,8 +98,35 @@ static void set_callbacks(GLFWwindow* window)
             else if (key == GLFW_KEY_F5 && action == GLFW_PRESS) {
                 // Press F5 to reload shaders
                 glDeleteProgram(program);
+                glDeleteProgram(cull_program);
+                glDeleteProgram(id_program);
                 program = create_program();
-                glUseProgram(program);
+                cull_program = create_cull_program();
+                id_program = create_id_program();
+                reload_hiz(hiz);
+            }
+            else if (key == GLFW_KEY_C && action == GLFW_PRESS) {
+                cpu_fallback = !cpu_fallback;
+                fmt::print("Culling on the {}\n", cpu_fallback ? "CPU" : "GPU");
+            }
+            else if (key == GLFW_KEY_K && action == GLFW_PRESS) {
+                // The next kernel this CPU supports, after the last back to scalar
+                CullKernel kernel = cull_kernel();
+                do {
+                    kernel = kernel == CULL_AVX2 ? CULL_SCALAR : static_cast<CullKernel>(kernel + 1);
+                } while (!set_cull_kernel(kernel));
+                fmt::print("Culling on the CPU with the {} kernel\n", cull_kernel_name(kernel));
+            }
+            else if (key == GLFW_KEY_V && action == GLFW_PRESS) {
+                fly_camera = !fly_camera;
+            }
+            else if (key == GLFW_KEY_O && action == GLFW_PRESS) {
+                occlusion_culling = !occlusion_culling;
+                fmt::print("Occlusion culling {}\n", occlusion_culling ? "on" : "off");
+            }
+            else if (key == GLFW_KEY_X && action == GLFW_PRESS) {
+                lods.crossfade = lods.crossfade > 0.0f ? 0.0f : crossfade;
+                fmt::print("LOD crossfade {}\n", lods.crossfade > 0.0f ? "on" : "off");
             }
         }
     );
@@ -50,6 +137,17 @@ static void set_callbacks(GLFWwindow* window)
             glfwGetCursorPos(window, &xpos, &ypos);
             if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
                 fmt::print("mouse down {}, {}\n", xpos, ypos);
+
+                // The next frame draws the ids and reads back the pixel under the cursor
+                int width{}, height{}, fb_width{}, fb_height{};
+                glfwGetWindowSize(window, &width, &height);
+                glfwGetFramebufferSize(window, &fb_width, &fb_height);
+                if (width > 0 && height > 0) {
+                    const int x = static_cast<int>(xpos * fb_width / width);
+                    const int y = fb_height - 1 - static_cast<int>(ypos * fb_height / height);
+                    pick_pixel = glm::clamp(glm::ivec2{x, y}, glm::ivec2{0, 0}, glm::ivec2{fb_width - 1, fb_height - 1});
+                    pick_requested = true;
+                }
             }
             else if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE) {
                 fmt::print("mouse up {}, {}\n", xpos, ypos);
@@ -90,6 +188,13 @@ static void print_info()
     else {
         fmt::print("Gamepad: none\n");
     }
+
+    fmt::print("Press C to toggle culling on the CPU.\n");
+    fmt::print("Press K to cycle the SIMD kernels of culling on the CPU.\n");
+    fmt::print("Press V to toggle flying through the cubes.\n");
+    fmt::print("Press O to toggle occlusion culling.\n");
+    fmt::print("Press X to toggle the dithered LOD crossfade.\n");
+    fmt::print("Press the left mouse button on a cube to pick it.\n");
 }
 
 static void process_gamepad(GLFWwindow* window)
@@ -103,11 +208,147 @@ static void process_gamepad(GLFWwindow* window)
     }
 }
 
+// Resets the indirect draw commands and the stats, which the culling passes increment
+static void reset_culling()
+{
+    reset_lod_commands(lods);
+
+    const CullStats stats{};
+    glNamedBufferSubData(stats_buffer, 0, sizeof(stats), &stats);
+}
+
+/**
+ * Runs one phase of shader/cubes-cull.comp, which appends the ids of the cubes
+ * to draw to the LOD buckets of `phase` in `visible_ssbo`, counts them in the
+ * bucket's draw command, and writes their model-view-projection matrices to
+ * `matrix_ssbo`. The cost of the matrices and of the draw tracks the visible
+ * cubes rather than all of them. The late phase samples the Hi-Z pyramid
+ * built from the early phase's depth. The frame graph issues the barrier
+ * for the draw that reads what this writes.
+ * `pixel_scale` specifies the pixels per world unit at distance 1.
+ */
+static void cull_cubes(const glm::mat4& view_proj, float pixel_scale, float time, CullPhase phase)
+{
+    const Frustum frustum = extract_frustum(view_proj);
+
+    const GLuint local_size_x{256}; // must match shader/cubes-cull.comp
+    glUseProgram(cull_program);
+    glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(view_proj));
+    glUniform1f(1, time);
+    glUniform1ui(2, num_instances);
+    glUniform1f(3, spread);
+    glUniform4fv(4, 6, glm::value_ptr(frustum.planes[0]));
+    glUniform1ui(10, phase);
+    glUniform1i(11, occlusion_culling);
+    glUniform1f(12, pixel_scale);
+    glUniform3fv(13, 1, glm::value_ptr(lods.lod_radius));
+    glUniform1ui(14, static_cast<GLuint>(lods.meshes.size()));
+    glUniform1f(15, lods.crossfade);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, matrix_ssbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, visible_ssbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, lods.command_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, visibility_ssbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, stats_buffer);
+    glBindTextureUnit(0, hiz.texture);
+    glDispatchCompute((num_instances + local_size_x - 1) / local_size_x, 1, 1);
+}
+
+// Frustum culling only, with every visible cube in the early bucket of the finest LOD
+static void cull_cubes_cpu(const glm::mat4& view_proj, float time)
+{
+    const double start = glfwGetTime();
+    const GLuint count = frustum_cull_cubes(num_instances, spread, view_proj, time, visible_ids.data(), matrices.data());
+    for (GLuint i{}; i < count; i++) {
+        visible_ids[i] |= LOD_OPAQUE;
+    }
+    cpu_cull_ms = (glfwGetTime() - start) * 1000.0;
+
+    const GLuint bucket = static_cast<GLuint>(lods.meshes.size()) - 1;
+    set_lod_instance_count(lods, bucket, count);
+    glNamedBufferSubData(visible_ssbo, bucket*num_instances*sizeof(GLuint), count*sizeof(GLuint), visible_ids.data());
+    glNamedBufferSubData(matrix_ssbo, 0, num_instances*sizeof(glm::mat4), matrices.data());
+}
+
+static void draw_cubes(const glm::mat4& proj_matrix, CullPhase phase, GLuint draw_program = program)
+{
+    glUseProgram(draw_program);
+    glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(proj_matrix));
+    glUniform1i(1, 1); // the quad of LOD 0 faces the camera
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, matrix_ssbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, visible_ssbo);
+    draw_lod_group(lods, phase);
+}
+
+/**
+ * Draws the ids of the cubes that the draw passes drew into `pixel` of the
+ * id target, with a depth target of its own. The scissor leaves the rest
+ * of the targets alone, so that the pass costs little more than the vertex
+ * work. Cubes in a crossfade are in both LODs, with the same id.
+ */
+static void draw_cube_ids(const glm::mat4& proj_matrix, glm::ivec2 pixel)
+{
+    const GLuint no_id{0};
+    const GLfloat far{1.0f};
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(pixel.x, pixel.y, 1, 1);
+    glClearBufferuiv(GL_COLOR, 0, &no_id);
+    glClearBufferfv(GL_DEPTH, 0, &far);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    draw_cubes(proj_matrix, EARLY, id_program);
+    draw_cubes(proj_matrix, LATE, id_program);
+    glDisable(GL_SCISSOR_TEST);
+}
+
+// Prints the picks whose read back is done, at most one per frame so
+// that their latency counts frames
+static void print_picks()
+{
+    PickResult pick{};
+    if (poll_id(picker, pick)) {
+        if (pick.id) {
+            fmt::print("picked cube {} at {}, {} after {} frames\n", pick.id - 1, pick.x, pick.y, pick.frames);
+        }
+        else {
+            fmt::print("picked nothing at {}, {} after {} frames\n", pick.x, pick.y, pick.frames);
+        }
+    }
+}
+
+// Prints what each stage culled and drew, and what the frame graph did
+// last frame. Reading the counters back waits for the GPU, so render()
+// only adds the pass that calls this once per second.
+static void print_stats()
+{
+    CullStats stats{};
+    glGetNamedBufferSubData(stats_buffer, 0, sizeof(stats), &stats);
+    const std::vector<GLuint> counts = read_lod_instance_counts(lods);
+    fmt::print("cubes: {}, frustum culled: {}, occlusion culled: {}, "
+        "drawn early: {} quads + {} cubes, drawn late: {} quads + {} cubes\n",
+        num_instances, stats.frustum_culled, stats.occlusion_culled,
+        counts[0], counts[1], counts[2], counts[3]);
+    if (cpu_fallback) {
+        fmt::print("culled on the CPU in {:.2f} ms with the {} kernel\n", cpu_cull_ms, cull_kernel_name(cull_kernel()));
+    }
+    fmt::print("passes: {} ({} culled), barriers: {}, render targets: {} for {} transient textures\n",
+        graph_stats.passes, graph_stats.culled, graph_stats.barriers,
+        graph_stats.pooled_textures, graph_stats.transient_textures);
+}
+
 static void render(GLFWwindow* window, double current_time)
 {
-    // Build view matrix
-    const glm::vec3 camera{0.0f, 0.0f, 32.0f};
-    const glm::vec3 center{0.0f, 0.0f, 0.0f};
+    print_picks();
+
+    // Build view matrix, backing off as the cubes spread out, or flying
+    // around a circle through them while looking ahead
+    const float tf = static_cast<float>(current_time);
+    glm::vec3 camera{0.0f, 0.0f, 4.0f * spread};
+    glm::vec3 center{0.0f, 0.0f, 0.0f};
+    if (fly_camera) {
+        const float angle = 0.05f * tf;
+        camera = 0.5f * spread * glm::vec3{std::sin(angle), 0.0f, std::cos(angle)};
+        center = 0.5f * spread * glm::vec3{std::sin(angle + 0.1f), 0.0f, std::cos(angle + 0.1f)};
+    }
     const glm::vec3 up{0.0f, 1.0f, 0.0f};
     const glm::mat4 view_matrix = glm::lookAt(camera, center, up);
 
@@ -116,23 +357,139 @@ static void render(GLFWwindow* window, double current_time)
     int width{}, height{};
     glfwGetFramebufferSize(window, &width, &height);
     const float aspect = static_cast<float>(width) / static_cast<float>(height);
-    const glm::mat4 proj_matrix = glm::perspective(fovy, aspect, 0.1f, 1000.0f);
+    const glm::mat4 proj_matrix = glm::perspective(fovy, aspect, 0.1f, 1000.0f + 8.0f * spread);
+
+    const glm::mat4 view_proj = proj_matrix * view_matrix;
+
+    // Resources of this frame. The render targets are transient, so the
+    // graph allocates them from its pool and frees them after a resize.
+    const GLsizei target_width = std::max(width, 1), target_height = std::max(height, 1);
+    const GLuint color = create_transient_texture(graph, "color", {GL_RGBA8, target_width, target_height});
+    const GLuint depth = create_transient_texture(graph, "depth", {GL_DEPTH_COMPONENT32F, target_width, target_height});
+    const GLuint commands = import_buffer(graph, "commands", lods.command_buffer);
+    const GLuint visible = import_buffer(graph, "visible", visible_ssbo);
+    const GLuint matrix = import_buffer(graph, "matrices", matrix_ssbo);
+    const GLuint visibility = import_buffer(graph, "visibility", visibility_ssbo);
+    const GLuint stats = import_buffer(graph, "stats", stats_buffer);
+    const GLuint pyramid = import_texture(graph, "hiz", hiz.texture);
+
+    const GLuint reset = add_pass(graph, "reset", reset_culling);
+    write_resource(graph, reset, commands, ACCESS_TRANSFER);
+    write_resource(graph, reset, stats, ACCESS_TRANSFER);
+
+    const float pixel_scale = proj_matrix[1][1] * 0.5f * height;
+    const auto add_cull_pass = [&](const char* name, CullPhase phase) {
+        const GLuint pass = add_pass(graph, name,
+            [=] { cull_cubes(view_proj, pixel_scale, tf, phase); });
+        for (const GLuint buffer : {commands, visibility, stats}) {
+            read_resource(graph, pass, buffer, ACCESS_STORAGE);
+            write_resource(graph, pass, buffer, ACCESS_STORAGE);
+        }
+        write_resource(graph, pass, visible, ACCESS_STORAGE);
+        write_resource(graph, pass, matrix, ACCESS_STORAGE);
+        if (phase == LATE && occlusion_culling) {
+            read_resource(graph, pass, pyramid, ACCESS_SAMPLED);
+        }
+    };
 
-    // Copy to uniform variables
-    glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(view_matrix));
-    glUniformMatrix4fv(1, 1, GL_FALSE, glm::value_ptr(proj_matrix));
-    glUniform1f(2, static_cast<float>(current_time));
+    // Draws tumbling cubes with instancing, the first draw clearing the targets
+    const auto add_draw_pass = [&](const char* name, CullPhase phase, bool clear) {
+        const GLuint pass = add_pass(graph, name,
+            [=] {
+                if (clear) {
+                    glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+                    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                    glEnable(GL_DEPTH_TEST);
+                    glDepthFunc(GL_LESS);
+                }
+                draw_cubes(proj_matrix, phase);
+            });
+        read_resource(graph, pass, commands, ACCESS_INDIRECT);
+        read_resource(graph, pass, visible, ACCESS_STORAGE);
+        read_resource(graph, pass, matrix, ACCESS_STORAGE);
+        for (const GLuint target : {color, depth}) {
+            if (!clear) {
+                read_resource(graph, pass, target, ACCESS_ATTACHMENT);
+            }
+            write_resource(graph, pass, target, ACCESS_ATTACHMENT);
+        }
+    };
 
-    // Draw 24 tumbling cubes with instancing
-    glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
-    glDrawElementsInstanced(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0, 24);
+    if (cpu_fallback) {
+        // Rewrites the instance count of one LOD only, over the commands reset zeroed
+        const GLuint cull = add_pass(graph, "cull on the CPU", [=] { cull_cubes_cpu(view_proj, tf); });
+        read_resource(graph, cull, commands, ACCESS_TRANSFER);
+        write_resource(graph, cull, commands, ACCESS_TRANSFER);
+        write_resource(graph, cull, visible, ACCESS_TRANSFER);
+        write_resource(graph, cull, matrix, ACCESS_TRANSFER);
+        add_draw_pass("draw", EARLY, true);
+    }
+    else {
+        // Draw the cubes visible last frame, build the Hi-Z pyramid from
+        // their depth, then draw the cubes it shows to be visible now. The
+        // graph culls the Hi-Z pass when occlusion culling is off.
+        add_cull_pass("cull early", EARLY);
+        add_draw_pass("draw early", EARLY, true);
+        const GLuint build = add_pass(graph, "build hiz", [depth] { build_hiz(hiz, frame_graph_texture(graph, depth)); });
+        read_resource(graph, build, depth, ACCESS_SAMPLED);
+        write_resource(graph, build, pyramid, ACCESS_IMAGE);
+        add_cull_pass("cull late", LATE);
+        add_draw_pass("draw late", LATE, false);
+    }
+
+    // Copies the color target to the window
+    GLuint present{};
+    present = add_pass(graph, "present",
+        [&present, width, height] {
+            glBlitNamedFramebuffer(frame_graph_framebuffer(graph, present), 0,
+                0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        });
+    read_resource(graph, present, color, ACCESS_ATTACHMENT);
+    set_side_effect(graph, present);
+
+    // On a click, draws the ids of the cubes to an R32UI target and queues
+    // the read back of the pixel under the cursor, which print_picks()
+    // resolves a frame or two later without waiting for the GPU
+    if (pick_requested) {
+        pick_requested = false;
+        const glm::ivec2 pixel = glm::min(pick_pixel, glm::ivec2{target_width - 1, target_height - 1});
+        const GLuint ids = create_transient_texture(graph, "ids", {GL_R32UI, target_width, target_height});
+        const GLuint id_depth = create_transient_texture(graph, "id depth", {GL_DEPTH_COMPONENT32F, target_width, target_height});
+        const GLuint draw_ids = add_pass(graph, "draw ids", [=] { draw_cube_ids(proj_matrix, pixel); });
+        read_resource(graph, draw_ids, commands, ACCESS_INDIRECT);
+        read_resource(graph, draw_ids, visible, ACCESS_STORAGE);
+        read_resource(graph, draw_ids, matrix, ACCESS_STORAGE);
+        write_resource(graph, draw_ids, ids, ACCESS_ATTACHMENT);
+        write_resource(graph, draw_ids, id_depth, ACCESS_ATTACHMENT);
+
+        GLuint pick{};
+        pick = add_pass(graph, "read id",
+            [&pick, pixel] { read_id(picker, frame_graph_framebuffer(graph, pick), pixel.x, pixel.y); });
+        read_resource(graph, pick, ids, ACCESS_ATTACHMENT);
+        set_side_effect(graph, pick);
+    }
+
+    static double last_stats_time{};
+    if (current_time - last_stats_time >= 1.0) {
+        last_stats_time = current_time;
+        const GLuint readback = add_pass(graph, "print stats", print_stats);
+        read_resource(graph, readback, stats, ACCESS_TRANSFER);
+        read_resource(graph, readback, commands, ACCESS_TRANSFER);
+        set_side_effect(graph, readback);
+    }
+
+    graph_stats = execute_frame_graph(graph);
 }
 
-int main()
+int main(int argc, char* argv[])
 {
+    // The number of cubes, from 24 to 1M. They fill a volume that grows with
+    // their number, so that the spacing between them stays the same.
+    if (argc > 1) {
+        num_instances = glm::clamp(std::atoi(argv[1]), 24, 1'000'000);
+    }
+    spread = 8.0f * std::cbrt(num_instances / 24.0f);
+
     glfwSetErrorCallback(
         [](int error, const char* description) {
             fmt::print(stderr, "ERROR: {}\n",  description);
@@ -156,13 +513,34 @@ int main()
 
     glfwMakeContextCurrent(window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    start_gl_trace(); // to the file named by GLTRACE, if set
     glfwSwapInterval(1); // vsync on
 
     print_info();
     set_callbacks(window);
 
     program = create_program();
-    glUseProgram(program);
+    cull_program = create_cull_program();
+    id_program = create_id_program();
+    create_id_picker(picker);
+
+    // One model-view-projection matrix per cube, the ids of the cubes to draw
+    // in each phase and their indirect draw commands, all written every frame
+    matrices.resize(num_instances);
+    visible_ids.resize(num_instances);
+    glCreateBuffers(1, &matrix_ssbo);
+    glNamedBufferStorage(matrix_ssbo, num_instances*sizeof(glm::mat4), nullptr, GL_DYNAMIC_STORAGE_BIT);
+    glCreateBuffers(1, &stats_buffer);
+    glNamedBufferStorage(stats_buffer, sizeof(CullStats), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+    // Whether each cube was visible last frame, initially none
+    const std::vector<GLuint> visibility(num_instances, 0);
+    glCreateBuffers(1, &visibility_ssbo);
+    glNamedBufferStorage(visibility_ssbo, num_instances*sizeof(GLuint), visibility.data(), 0);
+
+    int width{}, height{};
+    glfwGetFramebufferSize(window, &width, &height);
+    create_hiz(hiz, width, height);
 
     // Define the vertices of our cube
     const GLfloat vertices[]{
@@ -217,44 +595,32 @@ int main()
         22, 23, 20,
     };
 
-    // Create and populate interleaved vertex buffer using
-    // DSA (Direct State Access) API in OpenGL 4.5.
-    GLuint vbo{};
-    glCreateBuffers(1, &vbo);
-    glNamedBufferStorage(vbo, sizeof(vertices), vertices, 0);
-
-    // Create and populate element buffer using DSA API in OpenGL 4.5
-    GLuint ebo{};
-    glCreateBuffers(1, &ebo);
-    glNamedBufferStorage(ebo, sizeof(indices), indices, 0);
-
-    // Create VAO
-    GLuint vao{};
-    glCreateVertexArrays(1, &vao);
-
-    // Bind the element buffer to the VAO
-    glVertexArrayElementBuffer(vao, ebo);
-
-    // Bind the vertex buffer to the VAO's vertex buffer binding point
-    const GLuint binding_index{0}; // [0..GL_MAX_VERTEX_ATTRIB_BINDINGS)
-    glVertexArrayVertexBuffer(vao, binding_index, vbo, 0, sizeof(GLfloat)*6);
-
-    // Enable vertex attribute locations 0 and 1
-    glEnableVertexArrayAttrib(vao, 0);
-    glEnableVertexArrayAttrib(vao, 1);
-
-    // Specify the data format for each vertex attribute location
-    glVertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, 0);
-    glVertexArrayAttribFormat(vao, 1, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*3);
-
-    // Tell OpenGL to read the data for vertex attribute locations 0 and 1
-    // from the buffer, which is attached to vertex buffer binding point 0.
-    glVertexArrayAttribBinding(vao, 0, binding_index);
-    glVertexArrayAttribBinding(vao, 1, binding_index);
-
-    // This shows that we do not have to bind the VAO before
-    // calling the above functions.
-    glBindVertexArray(vao);
+    // A quad for cubes a few pixels across, colored like the faces facing
+    // the camera at rest, then the cube itself
+    const GLfloat quad_vertices[]{
+        -1.2f, -1.2f, 0.0f, 1.0f, 0.0f, 0.0f,
+         1.2f, -1.2f, 0.0f, 0.0f, 1.0f, 0.0f,
+         1.2f,  1.2f, 0.0f, 0.0f, 0.0f, 1.0f,
+        -1.2f,  1.2f, 0.0f, 1.0f, 0.0f, 0.0f,
+    };
+    const GLuint quad_indices[]{
+        0, 1, 2,
+        2, 3, 0,
+    };
+    lods.attribute_sizes = {3, 3}; // position, color
+    lods.lod_radius = glm::vec3{3.0f, 0.0f, 0.0f};
+    lods.crossfade = crossfade;
+    add_lod_mesh(lods,
+        std::vector<GLfloat>(std::begin(quad_vertices), std::end(quad_vertices)),
+        std::vector<GLuint>(std::begin(quad_indices), std::end(quad_indices)));
+    add_lod_mesh(lods,
+        std::vector<GLfloat>(std::begin(vertices), std::end(vertices)),
+        std::vector<GLuint>(std::begin(indices), std::end(indices)));
+
+    // One set of LOD buckets per culling phase, and their instance lists
+    upload_lod_group(lods, num_instances, 2);
+    glCreateBuffers(1, &visible_ssbo);
+    glNamedBufferStorage(visible_ssbo, lod_list_size(lods)*sizeof(GLuint), nullptr, GL_DYNAMIC_STORAGE_BIT);
 
     // Uncomment this call to draw in wireframe polygons
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -263,15 +629,24 @@ int main()
         process_gamepad(window);
         render(window, glfwGetTime());
         glfwSwapBuffers(window);
+        trace_frame();
         glfwPollEvents();
     }
 
     // Shutting down from here onwards
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &ebo);
-    glDeleteBuffers(1, &vbo);
+    delete_lod_group(lods);
+    delete_id_picker(picker);
+    delete_hiz(hiz);
+    delete_frame_graph(graph);
+    glDeleteBuffers(1, &visibility_ssbo);
+    glDeleteBuffers(1, &stats_buffer);
+    glDeleteBuffers(1, &visible_ssbo);
+    glDeleteBuffers(1, &matrix_ssbo);
+    glDeleteProgram(id_program);
+    glDeleteProgram(cull_program);
     glDeleteProgram(program);
 
+    stop_gl_trace();
     glfwDestroyWindow(window);
     glfwTerminate();
 
@@ -7,11 +7,14 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <vector>
+#include "gltrace.h"
+#include "scheduler.h"
 #include "shader.h"
 #include "utils.h"
 
 // Global variables
 static GLuint program{};
+static FrameScheduler scheduler{};
 static bool wireframe{};
 
 static GLuint create_program()
@@ -29,11 +32,13 @@ static void set_callbacks(GLFWwindow* window)
         window,
         [](GLFWwindow* window, int width, int height) {
             glViewport(0, 0, width, height);
+            request_redraw(scheduler);
         }
     );
     glfwSetKeyCallback(
         window,
         [](GLFWwindow* window, int key, int scancode, int action, int mods) {
+            request_redraw(scheduler);
             if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
                 glfwSetWindowShouldClose(window, GLFW_TRUE);
             }
@@ -47,6 +52,10 @@ static void set_callbacks(GLFWwindow* window)
                 wireframe = !wireframe;
                 glPolygonMode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
             }
+            else if (key == GLFW_KEY_R && action == GLFW_PRESS) {
+                scheduler.policy = scheduler.policy == FRAME_CONTINUOUS ? FRAME_ON_DEMAND : FRAME_CONTINUOUS;
+                fmt::print("Rendering {}\n", frame_policy_name(scheduler.policy));
+            }
         }
     );
     glfwSetMouseButtonCallback(
@@ -66,6 +75,7 @@ static void set_callbacks(GLFWwindow* window)
         window,
         [](GLFWwindow* window, int focused) {
             //fmt::print("focused {}\n", focused);
+            set_window_focused(scheduler, focused);
         }
     );
 }
@@ -98,6 +108,7 @@ static void print_info()
     }
 
     fmt::print("Press spacebar to toggle filled and wireframe mode.\n");
+    fmt::print("Press R to toggle rendering continuously or on demand.\n");
 }
 
 static void process_gamepad(GLFWwindow* window)
@@ -192,10 +203,12 @@ int main()
 
     glfwMakeContextCurrent(window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    start_gl_trace(); // to the file named by GLTRACE, if set
     glfwSwapInterval(1); // vsync on
 
     print_info();
     set_callbacks(window);
+    set_scheduler_callbacks(scheduler, window);
 
     program = create_program();
     glUseProgram(program);
@@ -234,18 +247,23 @@ int main()
     // Draw filled or wireframe polygons
     glPolygonMode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
 
+    // Renders only when something changed, see src/common/scheduler.h
     while (!glfwWindowShouldClose(window)) {
         process_gamepad(window);
-        render(window, glfwGetTime(), vertices.size());
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        if (wait_for_frame(scheduler)) {
+            render(window, glfwGetTime(), vertices.size());
+            glfwSwapBuffers(window);
+            trace_frame();
+        }
     }
+    fmt::print("{} frames rendered in {:.1f} s\n", scheduler.frames, glfwGetTime());
 
     // Shutting down from here onwards
     glDeleteVertexArrays(1, &vao);
     glDeleteBuffers(1, &vbo);
     glDeleteProgram(program);
 
+    stop_gl_trace();
     glfwDestroyWindow(window);
     glfwTerminate();
 
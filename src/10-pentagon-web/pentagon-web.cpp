@@ -7,11 +7,18 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <vector>
+#include "gltrace.h"
+#include "primitivebatch.h"
+#include "scheduler.h"
 #include "shader.h"
 #include "utils.h"
 
 // Global variables
 static GLuint program{};
+static FrameScheduler scheduler{};
+static PrimitiveBatch fill{GL_TRIANGLE_FAN};
+static PrimitiveBatch lines{GL_LINE_LOOP};
+static BatchSubmit submit{SUBMIT_RESTART};
 
 static GLuint create_program()
 {
@@ -28,11 +35,13 @@ static void set_callbacks(GLFWwindow* window)
         window,
         [](GLFWwindow* window, int width, int height) {
             glViewport(0, 0, width, height);
+            request_redraw(scheduler);
         }
     );
     glfwSetKeyCallback(
         window,
         [](GLFWwindow* window, int key, int scancode, int action, int mods) {
+            request_redraw(scheduler);
             if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
                 glfwSetWindowShouldClose(window, GLFW_TRUE);
             }
@@ -42,6 +51,18 @@ static void set_callbacks(GLFWwindow* window)
                 program = create_program();
                 glUseProgram(program);
             }
+            else if (key == GLFW_KEY_R && action == GLFW_PRESS) {
+                scheduler.policy = scheduler.policy == FRAME_CONTINUOUS ? FRAME_ON_DEMAND : FRAME_CONTINUOUS;
+                fmt::print("Rendering {}\n", frame_policy_name(scheduler.policy));
+            }
+            else if (key == GLFW_KEY_A && action == GLFW_PRESS) {
+                set_animating(scheduler, !scheduler.animating);
+            }
+            else if (key == GLFW_KEY_B && action == GLFW_PRESS) {
+                submit = static_cast<BatchSubmit>((submit + 1) % (SUBMIT_RESTART + 1));
+                fmt::print("Submitting {}, {} draw calls per frame\n", batch_submit_name(submit),
+                    (submit == SUBMIT_SEPARATE ? fill.counts.size() + lines.counts.size() : 2));
+            }
         }
     );
     glfwSetMouseButtonCallback(
@@ -61,6 +82,7 @@ static void set_callbacks(GLFWwindow* window)
         window,
         [](GLFWwindow* window, int focused) {
             //fmt::print("focused {}\n", focused);
+            set_window_focused(scheduler, focused);
         }
     );
 }
@@ -91,6 +113,10 @@ static void print_info()
     else {
         fmt::print("Gamepad: none\n");
     }
+
+    fmt::print("Press R to toggle rendering continuously or on demand.\n");
+    fmt::print("Press A to pause and resume the animation.\n");
+    fmt::print("Press B to cycle separate, multi-draw and restart submission.\n");
 }
 
 static void process_gamepad(GLFWwindow* window)
@@ -139,14 +165,11 @@ static void render(GLFWwindow* window, double current_time)
     // Draw filled pentagon
     glUniform3f(2, 0.47f, 0.52f, 0.035f);
     glUniform1i(3, 0);
-    glDrawArrays(GL_TRIANGLE_FAN, 0, 5);
+    draw_primitive_batch(fill, submit);
 
-    // Draw lines
+    // Draw the rings and spokes, all with one call unless submitted separately
     glUniform1i(3, 1);
-    for (GLint i{5}; i <= 25; i += 5) {
-        glDrawArrays(GL_LINE_LOOP, i, 5);
-    }
-    glDrawArrays(GL_LINES, 30, 10);
+    draw_primitive_batch(lines, submit);
 }
 
 static void add_vertex(std::vector<glm::vec2>& vertices, float radius, float degrees)
@@ -187,6 +210,22 @@ static std::vector<glm::vec2> gen_pentagon_web()
     return vertices;
 }
 
+/**
+ * Splits the pentagon web into the filled pentagon and the lines, each
+ * drawn with a single call. A spoke is a loop of 2 vertices, which draws
+ * the same line as GL_LINES would, so that spokes and rings share a mode.
+ */
+static void gen_pentagon_web_batches()
+{
+    add_part(fill, 0, 5);
+    for (GLint i{5}; i <= 25; i += 5) {
+        add_part(lines, i, 5);
+    }
+    for (GLint i{30}; i < 40; i += 2) {
+        add_part(lines, i, 2);
+    }
+}
+
 int main()
 {
     glfwSetErrorCallback(
@@ -213,10 +252,13 @@ int main()
 
     glfwMakeContextCurrent(window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    start_gl_trace(); // to the file named by GLTRACE, if set
     glfwSwapInterval(1); // vsync on
 
     print_info();
     set_callbacks(window);
+    set_scheduler_callbacks(scheduler, window);
+    set_animating(scheduler, true);
 
     program = create_program();
     glUseProgram(program);
@@ -248,22 +290,32 @@ int main()
     // from the buffer, which is attached to vertex buffer binding point 0.
     glVertexArrayAttribBinding(vao, 0, binding_index);
 
+    // Index the parts of the web, separated by the restart index
+    gen_pentagon_web_batches();
+    const GLuint ibo = upload_primitive_batches(vao, {&fill, &lines});
+
     // This shows that we do not have to bind the VAO before
     // calling the above functions.
     glBindVertexArray(vao);
 
+    // Renders only when something changed, see src/common/scheduler.h
     while (!glfwWindowShouldClose(window)) {
         process_gamepad(window);
-        render(window, glfwGetTime());
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        if (wait_for_frame(scheduler)) {
+            render(window, scheduler.animation_time);
+            glfwSwapBuffers(window);
+            trace_frame();
+        }
     }
+    fmt::print("{} frames rendered in {:.1f} s\n", scheduler.frames, glfwGetTime());
 
     // Shutting down from here onwards
     glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &ibo);
     glDeleteBuffers(1, &vbo);
     glDeleteProgram(program);
 
+    stop_gl_trace();
     glfwDestroyWindow(window);
     glfwTerminate();
 
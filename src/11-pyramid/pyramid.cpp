@@ -6,12 +6,16 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "gltrace.h"
+#include "replay.h"
 #include "shader.h"
+#include "timestep.h"
 #include "utils.h"
 
 // Global variables
 static GLuint program{};
 static float camera_y{2.0f};
+static FixedTimestep timestep{};
 
 static std::string window_title()
 {
@@ -53,7 +57,7 @@ static void set_callbacks(GLFWwindow* window)
         window,
         [](GLFWwindow* window, int button, int action, int mods) {
             double xpos{}, ypos{};
-            glfwGetCursorPos(window, &xpos, &ypos);
+            get_cursor_pos(window, &xpos, &ypos);
             if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
                 fmt::print("mouse down {}, {}\n", xpos, ypos);
             }
@@ -155,7 +159,7 @@ static void render(GLFWwindow* window, double current_time)
     glDrawElements(GL_TRIANGLES, 18, GL_UNSIGNED_INT, 0);
 }
 
-int main()
+int main(int argc, char* argv[])
 {
     glfwSetErrorCallback(
         [](int error, const char* description) {
@@ -167,6 +171,12 @@ int main()
         exit(EXIT_FAILURE);
     }
 
+    // Record with --record <file>, replay with --replay <file>. A replay
+    // animates by whole frames, however long they take to draw.
+    if (start_input_log(argc, argv) == REPLAY_PLAY) {
+        set_deterministic(timestep, REPLAY_FRAME_TIME);
+    }
+
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -180,10 +190,12 @@ int main()
 
     glfwMakeContextCurrent(window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    start_gl_trace(); // to the file named by GLTRACE, if set
     glfwSwapInterval(1); // vsync on
 
     print_info();
     set_callbacks(window);
+    attach_input_log(window);
 
     program = create_program();
     glUseProgram(program);
@@ -269,10 +281,16 @@ int main()
 
     while (!glfwWindowShouldClose(window)) {
         process_gamepad(window);
-        render(window, glfwGetTime());
+        // The animation is a function of time alone, so the ticks only advance it
+        begin_timestep(timestep, glfwGetTime());
+        while (next_tick(timestep)) {
+        }
+        render(window, timestep_time(timestep));
         glfwSwapBuffers(window);
-        glfwPollEvents();
+        trace_frame();
+        poll_input(window);
     }
+    stop_input_log();
 
     // Shutting down from here onwards
     glDeleteVertexArrays(1, &vao);
@@ -280,6 +298,7 @@ int main()
     glDeleteBuffers(1, &vbo);
     glDeleteProgram(program);
 
+    stop_gl_trace();
     glfwDestroyWindow(window);
     glfwTerminate();
 
@@ -1,28 +1,16 @@
 #include "glad.h"
 #include <cmath>
-#include <filesystem>
 #include <fmt/core.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
-#include <vector>
-#include "shader.h"
-#include "utils.h"
+#include "canvas.h"
+#include "gltrace.h"
 
 // Global variables
-static GLuint program{};
+static Canvas2D canvas;
 static bool wireframe{};
 
-static GLuint create_program()
-{
-    namespace fs = std::filesystem;
-    return compile_shaders({
-        fs::canonical(dirname() / ".." / "shader" / "mvp-color.vert").c_str(),
-        fs::canonical(dirname() / ".." / "shader" / "basic.frag").c_str(),
-    });
-}
-
 static void set_callbacks(GLFWwindow* window)
 {
     glfwSetFramebufferSizeCallback(
@@ -39,9 +27,7 @@ static void set_callbacks(GLFWwindow* window)
             }
             else if (key == GLFW_KEY_F5 && action == GLFW_PRESS) {
                 // Press F5 to reload shaders
-                glDeleteProgram(program);
-                program = create_program();
-                glUseProgram(program);
+                reload_canvas(canvas);
             }
             else if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
                 wireframe = !wireframe;
@@ -111,7 +97,7 @@ static void process_gamepad(GLFWwindow* window)
     }
 }
 
-static void render(GLFWwindow* window, double current_time, int num_vertices)
+static void render(GLFWwindow* window, double current_time)
 {
     const float tf = static_cast<float>(current_time);
     const glm::mat4 identity_matrix{1.0f};
@@ -127,82 +113,26 @@ static void render(GLFWwindow* window, double current_time, int num_vertices)
     const glm::mat4 proj_matrix = glm::ortho(
         -1.0f, 1.0f, -1.0f / aspect, 1.0f / aspect, -1000.0f, 1000.0f);
 
-    // Copy projection matrix to uniform variable
-    glUniformMatrix4fv(1, 1, GL_FALSE, glm::value_ptr(proj_matrix));
-
     // Set the background color
     const GLfloat background[]{0.2f, 0.2f, 0.2f, 1.0f};
     glClearBufferfv(GL_COLOR, 0, background);
 
-    // Build model matrix for each model
+    // The four half-discs, each turned a quarter from the last, go into
+    // one stream with their colors, and are drawn with a single call
     const float scale{0.25f};
-    glm::mat4 model_matrix;
-    glm::mat4 mv_matrix;
-
-    // Red pie
-    model_matrix = glm::translate(identity_matrix, glm::vec3{0.0f, scale, 0.0f});
-    model_matrix = glm::rotate(model_matrix, glm::radians(-90.0f), glm::vec3{0.0f, 0.0f, 1.0f});
-    model_matrix = glm::scale(model_matrix, glm::vec3{scale, scale, 1.0f});
-    mv_matrix = view_matrix * model_matrix;
-    glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(mv_matrix));
-    glUniform3f(2, 219.0f/255, 50.0f/255, 54.0f/255);
-    glDrawArrays(GL_TRIANGLE_FAN, 0, num_vertices);
-
-    // Green pie
-    model_matrix = glm::translate(identity_matrix, glm::vec3{0.0f, -scale, 0.0f});
-    model_matrix = glm::rotate(model_matrix, glm::radians(90.0f), glm::vec3{0.0f, 0.0f, 1.0f});
-    model_matrix = glm::scale(model_matrix, glm::vec3{scale, scale, 1.0f});
-    mv_matrix = view_matrix * model_matrix;
-    glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(mv_matrix));
-    glUniform3f(2, 60.0f/255, 186.0f/255, 84.0f/255);
-    glDrawArrays(GL_TRIANGLE_FAN, 0, num_vertices);
-
-    // Blue pie
-    model_matrix = glm::translate(identity_matrix, glm::vec3{scale, 0.0f, 0.0f});
-    model_matrix = glm::rotate(model_matrix, glm::radians(180.0f), glm::vec3{0.0f, 0.0f, 1.0f});
-    model_matrix = glm::scale(model_matrix, glm::vec3{scale, scale, 1.0f});
-    mv_matrix = view_matrix * model_matrix;
-    glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(mv_matrix));
-    glUniform3f(2, 72.0f/255, 133.0f/255, 237.0f/255);
-    glDrawArrays(GL_TRIANGLE_FAN, 0, num_vertices);
-
-    // Yellow pie
-    model_matrix = glm::translate(identity_matrix, glm::vec3{-scale, 0.0f, 0.0f});
-    model_matrix = glm::rotate(model_matrix, 0.0f, glm::vec3{0.0f, 0.0f, 1.0f});
-    model_matrix = glm::scale(model_matrix, glm::vec3{scale, scale, 1.0f});
-    mv_matrix = view_matrix * model_matrix;
-    glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(mv_matrix));
-    glUniform3f(2, 244.0f/255, 194.0f/255, 13.0f/255);
-    glDrawArrays(GL_TRIANGLE_FAN, 0, num_vertices);
-}
-
-/**
- * Generates a pie.
- * `start` specifies the starting angle in degrees.
- * `end` specifies the ending angle in degrees.
- * `num_vertices` specifies the number of vertices on the circumference of the pie.
- *     Does not include the center vertex. Must be >= 2.
- * Returns a vector of 2d vertices. The number of vertices returned is always `num_vertices` + 1.
- */
-static std::vector<glm::vec2> gen_pie(float start, float end, int num_vertices)
-{
-    start = glm::radians(start);
-    end = glm::radians(end);
-    const float angle = (end - start) / (num_vertices - 1);
-    std::vector<glm::vec2> vertices;
-    vertices.reserve(num_vertices + 1);
-
-    // Center vertex
-    vertices.emplace_back(glm::vec2{});
-
-    for (int i{}; i < num_vertices; i++) {
-        vertices.emplace_back(glm::vec2{
-            std::cos(angle * i + start),
-            std::sin(angle * i + start)
-        });
+    const glm::vec2 offsets[]{{0.0f, scale}, {0.0f, -scale}, {scale, 0.0f}, {-scale, 0.0f}};
+    const float angles[]{-90.0f, 90.0f, 180.0f, 0.0f};
+    const glm::vec4 colors[]{
+        {219.0f/255, 50.0f/255, 54.0f/255, 1.0f},  // red
+        {60.0f/255, 186.0f/255, 84.0f/255, 1.0f},  // green
+        {72.0f/255, 133.0f/255, 237.0f/255, 1.0f}, // blue
+        {244.0f/255, 194.0f/255, 13.0f/255, 1.0f}, // yellow
+    };
+    begin_canvas(canvas, proj_matrix * view_matrix, glm::vec2{width, height});
+    for (int i{}; i < 4; i++) {
+        fill_pie(canvas, offsets[i], scale, angles[i], angles[i] + 180.0f, colors[i]);
     }
-
-    return vertices;
+    end_canvas(canvas);
 }
 
 int main()
@@ -230,60 +160,27 @@ int main()
 
     glfwMakeContextCurrent(window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    start_gl_trace(); // to the file named by GLTRACE, if set
     glfwSwapInterval(1); // vsync on
 
     print_info();
     set_callbacks(window);
 
-    program = create_program();
-    glUseProgram(program);
-
-    // Generate the vertices of our pie
-    const std::vector<glm::vec2> vertices = gen_pie(0.0f, 180.0f, 20);
-
-    // Create and populate interleaved vertex buffer using
-    // DSA (Direct State Access) API in OpenGL 4.5.
-    GLuint vbo{};
-    glCreateBuffers(1, &vbo);
-    glNamedBufferStorage(vbo, sizeof(glm::vec2) * vertices.size(), vertices.data(), 0);
-
-    // Create VAO
-    GLuint vao{};
-    glCreateVertexArrays(1, &vao);
-
-    // Bind the vertex buffer to the VAO's vertex buffer binding point
-    const GLuint binding_index{0}; // [0..GL_MAX_VERTEX_ATTRIB_BINDINGS)
-    glVertexArrayVertexBuffer(vao, binding_index, vbo, 0, sizeof(glm::vec2));
-
-    // Enable vertex attribute location 0
-    glEnableVertexArrayAttrib(vao, 0);
-
-    // Specify the data format for each vertex attribute location
-    glVertexArrayAttribFormat(vao, 0, glm::vec2::length(), GL_FLOAT, GL_FALSE, 0);
-
-    // Tell OpenGL to read the data for vertex attribute location 0
-    // from the buffer, which is attached to vertex buffer binding point 0.
-    glVertexArrayAttribBinding(vao, 0, binding_index);
-
-    // This shows that we do not have to bind the VAO before
-    // calling the above functions.
-    glBindVertexArray(vao);
-
-    // Draw filled or wireframe polygons
-    glPolygonMode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
+    // Shapes are streamed into the canvas every frame, see src/common/canvas.h
+    create_canvas(canvas);
 
     while (!glfwWindowShouldClose(window)) {
         process_gamepad(window);
-        render(window, glfwGetTime(), vertices.size());
+        render(window, glfwGetTime());
         glfwSwapBuffers(window);
+        trace_frame();
         glfwPollEvents();
     }
 
     // Shutting down from here onwards
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
-    glDeleteProgram(program);
+    delete_canvas(canvas);
 
+    stop_gl_trace();
     glfwDestroyWindow(window);
     glfwTerminate();
 
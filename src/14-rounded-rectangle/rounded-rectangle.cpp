@@ -1,53 +1,49 @@
 #include "glad.h"
-#include <array>
 #include <cmath>
-#include <filesystem>
 #include <fmt/core.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
-#include <vector>
-#include "shader.h"
-#include "utils.h"
+#include "canvas.h"
+#include "gltrace.h"
+#include "scheduler.h"
 
 // Global variables
-static GLuint program{};
+static Canvas2D canvas;
+static FrameScheduler scheduler{};
 static bool wireframe{};
 
-static GLuint create_program()
-{
-    namespace fs = std::filesystem;
-    return compile_shaders({
-        fs::canonical(dirname() / ".." / "shader" / "mvp-color.vert").c_str(),
-        fs::canonical(dirname() / ".." / "shader" / "basic.frag").c_str(),
-    });
-}
-
 static void set_callbacks(GLFWwindow* window)
 {
     glfwSetFramebufferSizeCallback(
         window,
         [](GLFWwindow* window, int width, int height) {
             glViewport(0, 0, width, height);
+            request_redraw(scheduler);
         }
     );
     glfwSetKeyCallback(
         window,
         [](GLFWwindow* window, int key, int scancode, int action, int mods) {
+            request_redraw(scheduler);
             if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
                 glfwSetWindowShouldClose(window, GLFW_TRUE);
             }
             else if (key == GLFW_KEY_F5 && action == GLFW_PRESS) {
                 // Press F5 to reload shaders
-                glDeleteProgram(program);
-                program = create_program();
-                glUseProgram(program);
+                reload_canvas(canvas);
             }
             else if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
                 wireframe = !wireframe;
                 glPolygonMode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
             }
+            else if (key == GLFW_KEY_R && action == GLFW_PRESS) {
+                scheduler.policy = scheduler.policy == FRAME_CONTINUOUS ? FRAME_ON_DEMAND : FRAME_CONTINUOUS;
+                fmt::print("Rendering {}\n", frame_policy_name(scheduler.policy));
+            }
+            else if (key == GLFW_KEY_A && action == GLFW_PRESS) {
+                set_animating(scheduler, !scheduler.animating);
+            }
         }
     );
     glfwSetMouseButtonCallback(
@@ -67,6 +63,7 @@ static void set_callbacks(GLFWwindow* window)
         window,
         [](GLFWwindow* window, int focused) {
             //fmt::print("focused {}\n", focused);
+            set_window_focused(scheduler, focused);
         }
     );
 }
@@ -99,6 +96,8 @@ static void print_info()
     }
 
     fmt::print("Press spacebar to toggle filled and wireframe mode.\n");
+    fmt::print("Press R to toggle rendering continuously or on demand.\n");
+    fmt::print("Press A to pause and resume the animation.\n");
 }
 
 static void process_gamepad(GLFWwindow* window)
@@ -136,104 +135,14 @@ static void render(GLFWwindow* window, double current_time)
     const glm::mat4 proj_matrix = glm::ortho(
         -1.0f, 1.0f, -1.0f / aspect, 1.0f / aspect, -1000.0f, 1000.0f);
 
-    // Copy model-view and projection matrices to uniform variables
-    glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(mv_matrix));
-    glUniformMatrix4fv(1, 1, GL_FALSE, glm::value_ptr(proj_matrix));
-
     // Set the background color
     const GLfloat background[]{0.2f, 0.2f, 0.2f, 1.0f};
     glClearBufferfv(GL_COLOR, 0, background);
 
-    // Set the color of our rectangle to gold
-    glUniform3f(2, 0.83f, 0.68f, 0.21f);
-
-    // Draw rounded rectangle
-    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-    glDrawArrays(GL_TRIANGLE_FAN, 4, 4);
-    glDrawArrays(GL_TRIANGLE_FAN, 8, 4);
-    glDrawArrays(GL_TRIANGLE_FAN, 12, 10);
-    glDrawArrays(GL_TRIANGLE_FAN, 22, 10);
-    glDrawArrays(GL_TRIANGLE_FAN, 32, 10);
-    glDrawArrays(GL_TRIANGLE_FAN, 42, 10);
-}
-
-/**
- * Generates a pie.
- * `cx` specifies the x coordinate of the center of the pie.
- * `cy` specifies the y coordinate of the center of the pie.
- * `radius` specifies the radius of the pie.
- * `start` specifies the starting angle in degrees.
- * `end` specifies the ending angle in degrees.
- * `triangles` specifies the number of triangles that make up the pie. Must be >= 1.
- * Returns a vector of 2d vertices. The number of vertices returned is `triangles` + 2.
- */
-static std::vector<glm::vec2> gen_pie(
-    float cx, float cy, float radius, float start, float end, int triangles)
-{
-    start = glm::radians(start);
-    end = glm::radians(end);
-    const float angle = (end - start) / triangles;
-    std::vector<glm::vec2> vertices;
-    vertices.reserve(triangles + 2);
-
-    // Center vertex
-    vertices.emplace_back(glm::vec2{cx, cy});
-
-    for (int i{}; i < triangles + 1; i++) {
-        vertices.emplace_back(glm::vec2{
-            cx + radius * std::cos(angle * i + start),
-            cy + radius * std::sin(angle * i + start)
-        });
-    }
-
-    return vertices;
-}
-
-/**
- * Generates a rounded rectangle centered at the origin.
- * `width` specifies the width of the rectangle in the x axis.
- * `height` specifies the height of the rectangle in the y axis.
- * `radius` specifies the radius of the corners.
- */
-static std::vector<glm::vec2> gen_rectangle(float width, float height, float radius)
-{
-    const float w{width / 2}; // half width
-    const float h{height / 2}; // half height
-    const float& r{radius};
-    std::vector<glm::vec2> vertices;
-    vertices.reserve(52);
-
-    // Top rectangle
-    vertices.emplace_back(glm::vec2{+w - r, +h});
-    vertices.emplace_back(glm::vec2{-w + r, +h});
-    vertices.emplace_back(glm::vec2{-w + r, +h - r});
-    vertices.emplace_back(glm::vec2{+w - r, +h - r});
-
-    // Middle rectangle
-    vertices.emplace_back(glm::vec2{+w, +h - r});
-    vertices.emplace_back(glm::vec2{-w, +h - r});
-    vertices.emplace_back(glm::vec2{-w, -h + r});
-    vertices.emplace_back(glm::vec2{+w, -h + r});
-
-    // Bottom rectangle
-    vertices.emplace_back(glm::vec2{+w - r, -h + r});
-    vertices.emplace_back(glm::vec2{-w + r, -h + r});
-    vertices.emplace_back(glm::vec2{-w + r, -h});
-    vertices.emplace_back(glm::vec2{+w - r, -h});
-
-    // Generate pies counter-clockwise, starting from the top-right corner
-    const std::array pies{
-        gen_pie(+w - r, +h - r, r, 0.0f, 90.0f, 8),
-        gen_pie(-w + r, +h - r, r, 90.0f, 180.0f, 8),
-        gen_pie(-w + r, -h + r, r, 180.0f, 270.0f, 8),
-        gen_pie(+w - r, -h + r, r, 270.0f, 360.0f, 8)
-    };
-
-    for (const auto& pie : pies) {
-        vertices.insert(vertices.end(), pie.begin(), pie.end());
-    }
-
-    return vertices;
+    // Draw a gold rounded rectangle, as one fan around its center
+    begin_canvas(canvas, proj_matrix * mv_matrix, glm::vec2{width, height});
+    fill_rounded_rect(canvas, glm::vec2{}, glm::vec2{1.3f, 0.4f}, 0.1f, glm::vec4{0.83f, 0.68f, 0.21f, 1.0f});
+    end_canvas(canvas);
 }
 
 int main()
@@ -261,60 +170,35 @@ int main()
 
     glfwMakeContextCurrent(window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    start_gl_trace(); // to the file named by GLTRACE, if set
     glfwSwapInterval(1); // vsync on
 
     print_info();
     set_callbacks(window);
+    set_scheduler_callbacks(scheduler, window);
+    set_animating(scheduler, true);
 
-    program = create_program();
-    glUseProgram(program);
-
-    // Generate the vertices of our rounded rectangle
-    const std::vector<glm::vec2> vertices = gen_rectangle(1.3f, 0.4f, 0.1f);
-
-    // Create and populate interleaved vertex buffer using
-    // DSA (Direct State Access) API in OpenGL 4.5.
-    GLuint vbo{};
-    glCreateBuffers(1, &vbo);
-    glNamedBufferStorage(vbo, sizeof(glm::vec2) * vertices.size(), vertices.data(), 0);
-
-    // Create VAO
-    GLuint vao{};
-    glCreateVertexArrays(1, &vao);
-
-    // Bind the vertex buffer to the VAO's vertex buffer binding point
-    const GLuint binding_index{0}; // [0..GL_MAX_VERTEX_ATTRIB_BINDINGS)
-    glVertexArrayVertexBuffer(vao, binding_index, vbo, 0, sizeof(glm::vec2));
-
-    // Enable vertex attribute location 0
-    glEnableVertexArrayAttrib(vao, 0);
-
-    // Specify the data format for each vertex attribute location
-    glVertexArrayAttribFormat(vao, 0, glm::vec2::length(), GL_FLOAT, GL_FALSE, 0);
-
-    // Tell OpenGL to read the data for vertex attribute location 0
-    // from the buffer, which is attached to vertex buffer binding point 0.
-    glVertexArrayAttribBinding(vao, 0, binding_index);
-
-    // This shows that we do not have to bind the VAO before
-    // calling the above functions.
-    glBindVertexArray(vao);
+    // Shapes are streamed into the canvas every frame, see src/common/canvas.h
+    create_canvas(canvas);
 
     // Draw filled or wireframe polygons
     glPolygonMode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
 
+    // Renders only when something changed, see src/common/scheduler.h
     while (!glfwWindowShouldClose(window)) {
         process_gamepad(window);
-        render(window, glfwGetTime());
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        if (wait_for_frame(scheduler)) {
+            render(window, scheduler.animation_time);
+            glfwSwapBuffers(window);
+            trace_frame();
+        }
     }
+    fmt::print("{} frames rendered in {:.1f} s\n", scheduler.frames, glfwGetTime());
 
     // Shutting down from here onwards
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
-    glDeleteProgram(program);
+    delete_canvas(canvas);
 
+    stop_gl_trace();
     glfwDestroyWindow(window);
     glfwTerminate();
 
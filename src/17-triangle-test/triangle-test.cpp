@@ -1,4 +1,7 @@
 #include "glad.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <filesystem>
 #include <fmt/core.h>
 #include <GLFW/glfw3.h>
@@ -6,20 +9,87 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/vector_angle.hpp>
+#include <atomic>
+#include <deque>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "gltrace.h"
+#include "handoff.h"
+#include "input.h"
+#include "latency.h"
+#include "replay.h"
 #include "shader.h"
+#include "spatial.h"
 #include "utils.h"
 
-// Global variables
+// Where a shape is, as edited with the mouse
+struct Placement {
+    glm::vec2 translation{0.0f, 0.0f};
+    float rotation{0.0f};
+    float scaling{1.0f};
+};
+
+// World-space position and color of the 3 vertices of a shape, as in the vertex buffer
+struct ShapeVertices {
+    GLfloat data[3*6];
+};
+
+enum RenderEventType : int { SHAPE_MOVED, RELOAD_SHADERS };
+
+// What the render thread must not miss, sent through `render_events`
+struct RenderEvent {
+    RenderEventType type{};
+    int shape{};
+    ShapeVertices vertices{};
+};
+
+// What the render thread draws the latest of, sent through `snapshots`
+struct SceneSnapshot {
+    int width{};      // of the framebuffer
+    int height{};
+    int selected{-1};
+    long long input_sequence{}; // of the last input that changed the scene
+    double input_time{-1.0};    // of the oldest such input not yet presented, -1 if none
+    long long frame{};          // snapshots published up to this one
+};
+
+// Global variables. The main thread handles the window and input and owns
+// the scene, the render thread owns the GL context.
 static GLuint program{};
 static GLFWcursor* crosshair_cursor{};
-static glm::mat4 view_matrix{};
-static glm::mat4 proj_matrix{};
-static float scaling{1.0f};
+static float scaling{1.0f};                 // placement of the selected shape
 static float rotation{0.0f};
 static glm::vec2 translation{0.0f, 0.0f};
 static bool moving{};
 static bool rotating{};
-static bool selected{};
+static int selected{-1};
+static int num_shapes{1};
+static std::vector<Placement> placements;
+static SpatialIndex shape_index;            // shapes in world space, for picking
+static GLuint vbo{};                        // world-space vertices of every shape
+static SpscQueue<RenderEvent, 1024> render_events;
+static std::unordered_map<int, ShapeVertices> unsent_shapes; // moves that did not fit in the queue
+static bool unsent_reload{};
+static TripleBuffer<SceneSnapshot> snapshots;
+static std::atomic<bool> quitting{};
+static InputCoalescer input;
+static glm::vec2 trans{};                   // from the cursor to the translation while moving
+static float rot{};                         // from the cursor angle to the rotation while rotating
+static glm::dvec2 handled_cursor{};         // last cursor position handled
+static bool scene_changed{};                // by the input being handled
+static long long input_sequence{};          // input frames that changed the scene
+static std::deque<std::pair<long long, double>> unpresented_inputs; // their sequence and time
+static long long published_frames{};        // snapshots published
+static std::atomic<long long> presented_frame{}; // frame of the last snapshot presented
+static std::atomic<long long> presented_sequence{};
+static LatencyTracker latency;              // of the render thread
+
+// The triangle every shape is a copy of.
+// Note that the winding order is counter-clockwise.
+static const glm::vec2 triangle[3]{{-0.5f, -0.5f}, {0.5f, -0.5f}, {0.0f, 0.5f}};
+static const glm::vec3 triangle_colors[3]{{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}};
 
 static std::string window_title()
 {
@@ -36,6 +106,21 @@ static GLuint create_program()
     });
 }
 
+static glm::mat4 build_view_matrix()
+{
+    const glm::vec3 camera{0.0f, 0.0f, 5.0f};
+    const glm::vec3 center{0.0f, 0.0f, 0.0f};
+    const glm::vec3 up{0.0f, 1.0f, 0.0f};
+    return glm::lookAt(camera, center, up);
+}
+
+// Orthographic projection of a framebuffer of `width` x `height` pixels
+static glm::mat4 build_proj_matrix(int width, int height)
+{
+    const float aspect = static_cast<float>(width) / static_cast<float>(std::max(height, 1));
+    return glm::ortho(-aspect, aspect, -1.0f, 1.0f, -10.0f, 10.0f);
+}
+
 // Unproject window coordinates to world coordinates
 static glm::vec3 window_to_world(
     GLFWwindow* window,
@@ -46,51 +131,101 @@ static glm::vec3 window_to_world(
     glfwGetFramebufferSize(window, &width, &height);
     const glm::vec3 window_coords{win.x, height - win.y - 1, 0.0f};
     const glm::vec4 viewport{0, 0, width, height};
-    const glm::vec3 world_coords = glm::unProject(window_coords, view_matrix, proj_matrix, viewport);
+    const glm::vec3 world_coords = glm::unProject(window_coords, build_view_matrix(), build_proj_matrix(width, height), viewport);
     return world_coords;
 }
 
-static float sign(glm::vec2 p1, glm::vec2 p2, glm::vec2 p3)
+// The first shape is at the origin, the others are scattered and sized to
+// fill the view without covering each other much
+static Placement initial_placement(int shape)
 {
-    return (p1.x - p3.x) * (p2.y - p3.y) - (p2.x - p3.x) * (p1.y - p3.y);
+    if (num_shapes == 1) {
+        return Placement{};
+    }
+    std::mt19937 rng(shape);
+    std::uniform_real_distribution<float> position{-1.0f, 1.0f};
+    std::uniform_real_distribution<float> angle{0.0f, glm::two_pi<float>()};
+    return Placement{
+        glm::vec2{position(rng), position(rng)}, angle(rng), 2.0f / std::sqrt(static_cast<float>(num_shapes))};
 }
 
-static bool point_in_triangle(
-    glm::vec2 p,
-    glm::vec2 p1,
-    glm::vec2 p2,
-    glm::vec2 p3)
+/**
+ * Transforms the triangle to world space at `placement` once, into `world`
+ * for the spatial index, and returns the vertices for the vertex buffer, so
+ * neither picking nor drawing needs a matrix per shape.
+ */
+static ShapeVertices transform_shape(const Placement& placement, glm::vec2 (&world)[3])
 {
     glm::mat4 model_matrix{1.0f};
-    model_matrix = glm::translate(model_matrix, glm::vec3{translation, 0.0f});
-    model_matrix = glm::rotate(model_matrix, rotation, glm::vec3{0.0f, 0.0f, 1.0f});
-    model_matrix = glm::scale(model_matrix, glm::vec3{scaling, scaling, 0.0f});
+    model_matrix = glm::translate(model_matrix, glm::vec3{placement.translation, 0.0f});
+    model_matrix = glm::rotate(model_matrix, placement.rotation, glm::vec3{0.0f, 0.0f, 1.0f});
+    model_matrix = glm::scale(model_matrix, glm::vec3{placement.scaling, placement.scaling, 0.0f});
+
+    ShapeVertices vertices{};
+    for (int i{}; i < 3; i++) {
+        world[i] = model_matrix * glm::vec4{triangle[i], 0.0f, 1.0f};
+        const GLfloat vertex[]{world[i].x, world[i].y, 0.0f, triangle_colors[i].x, triangle_colors[i].y, triangle_colors[i].z};
+        std::copy(std::begin(vertex), std::end(vertex), vertices.data + 6*i);
+    }
+    return vertices;
+}
 
-    p1 = model_matrix * glm::vec4{p1, 0.0f, 1.0f};
-    p2 = model_matrix * glm::vec4{p2, 0.0f, 1.0f};
-    p3 = model_matrix * glm::vec4{p3, 0.0f, 1.0f};
+// Moves `shape` to `placement`, updates the spatial index with it and
+// returns its new vertices
+static ShapeVertices place_shape(int shape, const Placement& placement)
+{
+    placements[shape] = placement;
+    glm::vec2 world[3];
+    const ShapeVertices vertices = transform_shape(placement, world);
+    update_shape(shape_index, shape, world);
+    return vertices;
+}
 
-    const float d1 = sign(p, p1, p2);
-    const float d2 = sign(p, p2, p3);
-    const float d3 = sign(p, p3, p1);
+// Sends what did not fit in the render thread's queue before, the newest move of each shape only
+static void send_unsent_events()
+{
+    if (unsent_reload && try_push(render_events, RenderEvent{RELOAD_SHADERS})) {
+        unsent_reload = false;
+    }
+    for (auto it = unsent_shapes.begin(); it != unsent_shapes.end(); ) {
+        if (!try_push(render_events, RenderEvent{SHAPE_MOVED, it->first, it->second})) {
+            break;
+        }
+        it = unsent_shapes.erase(it);
+    }
+}
 
-    const bool has_neg = (d1 < 0) || (d2 < 0) || (d3 < 0);
-    const bool has_pos = (d1 > 0) || (d2 > 0) || (d3 > 0);
+// Stores the edited placement of the selected shape, and sends its new
+// vertices to the render thread, never waiting for it
+static void place_selected()
+{
+    if (selected < 0) {
+        return;
+    }
+    const ShapeVertices vertices = place_shape(selected, Placement{translation, rotation, scaling});
+    scene_changed = true;
+    const auto unsent = unsent_shapes.find(selected);
+    if (unsent != unsent_shapes.end()) {
+        unsent->second = vertices;
+    }
+    else if (!try_push(render_events, RenderEvent{SHAPE_MOVED, selected, vertices})) {
+        unsent_shapes.emplace(selected, vertices);
+    }
+}
 
-    return !(has_neg && has_pos);
+static void select_shape(int shape)
+{
+    scene_changed |= shape != selected;
+    selected = shape;
+    if (selected >= 0) {
+        translation = placements[selected].translation;
+        rotation = placements[selected].rotation;
+        scaling = placements[selected].scaling;
+    }
 }
 
 static void set_callbacks(GLFWwindow* window)
 {
-    static glm::vec2 trans{};
-    static float rot{};
-
-    glfwSetFramebufferSizeCallback(
-        window,
-        [](GLFWwindow* window, int width, int height) {
-            glViewport(0, 0, width, height);
-        }
-    );
     glfwSetKeyCallback(
         window,
         [](GLFWwindow* window, int key, int scancode, int action, int mods) {
@@ -99,14 +234,16 @@ static void set_callbacks(GLFWwindow* window)
             }
             else if (key == GLFW_KEY_F5 && action == GLFW_PRESS) {
                 // Press F5 to reload shaders
-                glDeleteProgram(program);
-                program = create_program();
-                glUseProgram(program);
+                unsent_reload = true;
+                send_unsent_events();
             }
             else if (key == GLFW_KEY_HOME && action == GLFW_PRESS) {
-                scaling = 1.0f;
-                rotation = 0.0f;
-                translation.x = translation.y = 0.0f;
+                select_shape(selected >= 0 ? selected : 0);
+                const Placement initial = initial_placement(selected);
+                scaling = initial.scaling;
+                rotation = initial.rotation;
+                translation = initial.translation;
+                place_selected();
                 moving = rotating = false;
                 glfwSetCursor(window, nullptr);
                 glfwSetWindowTitle(window, window_title().c_str());
@@ -116,64 +253,19 @@ static void set_callbacks(GLFWwindow* window)
     glfwSetMouseButtonCallback(
         window,
         [](GLFWwindow* window, int button, int action, int mods) {
-            double xpos{}, ypos{};
-            glfwGetCursorPos(window, &xpos, &ypos);
-
-            if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
-                const glm::vec2 world = window_to_world(window, glm::vec2{xpos, ypos});
-                selected = point_in_triangle(world,
-                    glm::vec2{-0.5f, -0.5f}, glm::vec2{0.5f, -0.5f}, glm::vec2{0.0f, 0.5f});
-                if (selected) {
-                    moving = true;
-                    trans = world - translation;
-                }
-            }
-            else if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE) {
-                moving = false;
-            }
-            else if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS) {
-                if (selected) {
-                    rotating = true;
-                    const glm::vec2 origin{translation};
-                    const glm::vec2 world = window_to_world(window, glm::vec2{xpos, ypos});
-                    const glm::vec2 a{1.0f, 0.0f};
-                    const glm::vec2 b = glm::normalize(world - origin);
-                    const float r = glm::orientedAngle(a, b);
-                    rot = r - rotation;
-                }
-            }
-            else if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_RELEASE) {
-                rotating = false;
-            }
-
-            glfwSetCursor(window, moving || rotating ? crosshair_cursor : nullptr);
+            add_button_event(input, button, action, mods, glfwGetTime());
         }
     );
     glfwSetCursorPosCallback(
         window,
         [](GLFWwindow* window, double xpos, double ypos) {
-            if (moving) {
-                const glm::vec2 world = window_to_world(window, glm::vec2{xpos, ypos});
-                translation = world - trans;
-            }
-            else if (rotating) {
-                const glm::vec2 origin{translation};
-                const glm::vec2 world = window_to_world(window, glm::vec2{xpos, ypos});
-                const glm::vec2 a{1.0f, 0.0f};
-                const glm::vec2 b = glm::normalize(world - origin);
-                const float r = glm::orientedAngle(a, b);
-                rotation = r - rot;
-                glfwSetWindowTitle(window, window_title().c_str());
-            }
+            add_cursor_event(input, xpos, ypos, glfwGetTime());
         }
     );
     glfwSetScrollCallback(
         window,
         [](GLFWwindow* window, double xoffset, double yoffset) {
-            if (selected) {
-                scaling += -yoffset * 0.05f;
-                scaling = glm::clamp(scaling, 0.3f, 3.0f);
-            }
+            add_scroll_event(input, xoffset, yoffset, glfwGetTime());
         }
     );
     glfwSetWindowFocusCallback(
@@ -184,6 +276,110 @@ static void set_callbacks(GLFWwindow* window)
     );
 }
 
+static void handle_button(GLFWwindow* window, const ButtonEdge& edge)
+{
+    const int button = edge.button;
+    const int action = edge.action;
+    const double xpos = edge.cursor.x, ypos = edge.cursor.y;
+
+    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
+        const glm::vec2 world = window_to_world(window, glm::vec2{xpos, ypos});
+        const auto start = std::chrono::steady_clock::now();
+        const int picked = pick_shape(shape_index, world);
+        const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        if (num_shapes > 1) {
+            fmt::print("picked shape {} of {} in {:.1f} us\n", picked, num_shapes, elapsed.count());
+        }
+        select_shape(picked);
+        if (selected >= 0) {
+            moving = true;
+            trans = world - translation;
+        }
+    }
+    else if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE) {
+        moving = false;
+    }
+    else if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS) {
+        if (selected >= 0) {
+            rotating = true;
+            const glm::vec2 origin{translation};
+            const glm::vec2 world = window_to_world(window, glm::vec2{xpos, ypos});
+            const glm::vec2 a{1.0f, 0.0f};
+            const glm::vec2 b = glm::normalize(world - origin);
+            const float r = glm::orientedAngle(a, b);
+            rot = r - rotation;
+        }
+    }
+    else if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_RELEASE) {
+        rotating = false;
+    }
+
+    glfwSetCursor(window, moving || rotating ? crosshair_cursor : nullptr);
+}
+
+// Drags to `cursor`, unless it is where the last drag went
+static void handle_cursor(GLFWwindow* window, glm::dvec2 cursor)
+{
+    if (cursor == handled_cursor) {
+        return;
+    }
+    handled_cursor = cursor;
+    const double xpos = cursor.x, ypos = cursor.y;
+
+    if (moving) {
+        const glm::vec2 world = window_to_world(window, glm::vec2{xpos, ypos});
+        translation = world - trans;
+        place_selected();
+    }
+    else if (rotating) {
+        const glm::vec2 origin{translation};
+        const glm::vec2 world = window_to_world(window, glm::vec2{xpos, ypos});
+        const glm::vec2 a{1.0f, 0.0f};
+        const glm::vec2 b = glm::normalize(world - origin);
+        const float r = glm::orientedAngle(a, b);
+        rotation = r - rot;
+        place_selected();
+        glfwSetWindowTitle(window, window_title().c_str());
+    }
+}
+
+static void handle_scroll(double yoffset)
+{
+    if (selected >= 0) {
+        const float initial = initial_placement(selected).scaling;
+        scaling += -yoffset * 0.05f * initial;
+        scaling = glm::clamp(scaling, 0.3f * initial, 3.0f * initial);
+        place_selected();
+    }
+}
+
+/**
+ * Handles the input since the last call. However many cursor events came
+ * in, a drag handles the position at each button edge and the latest one,
+ * so the world position, the shape and the title are updated at most once
+ * per edge and once more. Input that changes the scene is timestamped by
+ * its oldest event for the latency measurement of the render thread.
+ */
+static void process_input(GLFWwindow* window)
+{
+    InputFrame frame;
+    if (!take_input_frame(input, frame)) {
+        return;
+    }
+    scene_changed = false;
+    for (const ButtonEdge& edge : frame.edges) {
+        handle_cursor(window, edge.cursor);
+        handle_button(window, edge);
+    }
+    handle_cursor(window, frame.cursor);
+    if (frame.scroll.y != 0.0) {
+        handle_scroll(frame.scroll.y);
+    }
+    if (scene_changed) {
+        unpresented_inputs.emplace_back(++input_sequence, frame.first_time);
+    }
+}
+
 static void print_info()
 {
     fmt::print("GLFW version: {}\n", glfwGetVersionString());
@@ -211,11 +407,11 @@ static void print_info()
         fmt::print("Gamepad: none\n");
     }
 
-    fmt::print("Press the left mouse button inside/outside the triangle to select/unselect.\n");
+    fmt::print("Press the left mouse button inside/outside a triangle to select/unselect.\n");
     fmt::print("To scale, scroll the mouse wheel.\n");
     fmt::print("To rotate, press and hold the right mouse button anywhere and then move the mouse.\n");
     fmt::print("To translate, press and hold the left mouse button inside the triangle and then move the mouse.\n");
-    fmt::print("Press 'home' to return the triangle to the default size, rotation and position.\n");
+    fmt::print("Press 'home' to return the selected triangle to the default size, rotation and position.\n");
 }
 
 static void process_gamepad(GLFWwindow* window)
@@ -229,28 +425,13 @@ static void process_gamepad(GLFWwindow* window)
     }
 }
 
-static void render(GLFWwindow* window, double current_time)
+static void render(const SceneSnapshot& scene)
 {
-    // Build model matrix
-    glm::mat4 model_matrix{1.0f};
-    model_matrix = glm::translate(model_matrix, glm::vec3{translation, 0.0f});
-    model_matrix = glm::rotate(model_matrix, rotation, glm::vec3{0.0f, 0.0f, 1.0f});
-    model_matrix = glm::scale(model_matrix, glm::vec3{scaling, scaling, 0.0f});
-
-    // Build view matrix
-    const glm::vec3 camera{0.0f, 0.0f, 5.0f};
-    const glm::vec3 center{0.0f, 0.0f, 0.0f};
-    const glm::vec3 up{0.0f, 1.0f, 0.0f};
-    view_matrix = glm::lookAt(camera, center, up);
+    glViewport(0, 0, scene.width, scene.height);
 
-    // Build model-view matrix
-    const glm::mat4 mv_matrix = view_matrix * model_matrix;
-
-    // Build orthographic projection matrix
-    int width{}, height{};
-    glfwGetFramebufferSize(window, &width, &height);
-    const float aspect = static_cast<float>(width) / static_cast<float>(height);
-    proj_matrix = glm::ortho(-aspect, aspect, -1.0f, 1.0f, -10.0f, 10.0f);
+    // The vertices are in world space, so the model-view matrix is the view matrix
+    const glm::mat4 mv_matrix = build_view_matrix();
+    const glm::mat4 proj_matrix = build_proj_matrix(scene.width, scene.height);
 
     // Copy model-view and projection matrices to uniform variables
     glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(mv_matrix));
@@ -260,20 +441,90 @@ static void render(GLFWwindow* window, double current_time)
     const GLfloat background[]{0.2f, 0.2f, 0.2f, 1.0f};
     glClearBufferfv(GL_COLOR, 0, background);
 
-    // Draw triangle
+    // Draw triangles, later ones on top
     glUniform1i(2, 0);
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glDrawArrays(GL_TRIANGLES, 0, 3*num_shapes);
 
-    if (selected) {
+    if (scene.selected >= 0) {
         // Draw wireframe
         glUniform1i(2, 1);
         glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glDrawArrays(GL_TRIANGLES, 3*scene.selected, 3);
+    }
+}
+
+static void handle_render_event(const RenderEvent& event)
+{
+    if (event.type == SHAPE_MOVED) {
+        glNamedBufferSubData(vbo, event.shape*sizeof(ShapeVertices), sizeof(ShapeVertices), event.vertices.data);
+    }
+    else if (event.type == RELOAD_SHADERS) {
+        glDeleteProgram(program);
+        program = create_program();
+        glUseProgram(program);
+    }
+}
+
+/**
+ * Runs on the render thread, which owns the GL context: applies the events
+ * the main thread queued, then draws the newest scene snapshot. A long
+ * frame delays neither the main thread's input handling nor the events,
+ * which queue up until the next frame.
+ */
+static void render_loop(GLFWwindow* window)
+{
+    glfwMakeContextCurrent(window);
+    create_latency_tracker(latency);
+    long long last_sequence{};
+    double last_print{glfwGetTime()};
+    while (!quitting.load(std::memory_order_acquire)) {
+        RenderEvent event;
+        while (try_pop(render_events, event)) {
+            handle_render_event(event);
+        }
+        take_latest(snapshots);
+        const SceneSnapshot& scene = front_buffer(snapshots);
+        render(scene);
+        glfwSwapBuffers(window);
+        trace_frame();
+        presented_frame.store(scene.frame, std::memory_order_release);
+
+        // Measure the latency of the first frame that shows new input
+        if (scene.input_sequence != last_sequence) {
+            last_sequence = scene.input_sequence;
+            mark_present(latency, scene.input_time);
+            presented_sequence.store(scene.input_sequence, std::memory_order_release);
+        }
+        collect_latencies(latency);
+        if (glfwGetTime() - last_print >= 1.0) {
+            last_print = glfwGetTime();
+            print_latencies(latency);
+        }
+    }
+    delete_latency_tracker(latency);
+    glfwMakeContextCurrent(nullptr);
+}
+
+// Publishes the state of the scene that the render thread draws
+static void publish_snapshot(GLFWwindow* window)
+{
+    // Forget the inputs that the render thread has presented
+    const long long presented = presented_sequence.load(std::memory_order_acquire);
+    while (!unpresented_inputs.empty() && unpresented_inputs.front().first <= presented) {
+        unpresented_inputs.pop_front();
     }
+
+    SceneSnapshot& scene = back_buffer(snapshots);
+    glfwGetFramebufferSize(window, &scene.width, &scene.height);
+    scene.selected = selected;
+    scene.input_sequence = input_sequence;
+    scene.input_time = unpresented_inputs.empty() ? -1.0 : unpresented_inputs.front().second;
+    scene.frame = ++published_frames;
+    publish(snapshots);
 }
 
-int main()
+int main(int argc, char* argv[])
 {
     glfwSetErrorCallback(
         [](int error, const char* description) {
@@ -285,6 +536,14 @@ int main()
         exit(EXIT_FAILURE);
     }
 
+    // Record with --record <file>, replay with --replay <file>
+    start_input_log(argc, argv);
+
+    // The number of triangles, e.g. 1000000 to test picking among many
+    if (argc > 1) {
+        num_shapes = std::max(std::atoi(argv[1]), 1);
+    }
+
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -299,29 +558,33 @@ int main()
 
     glfwMakeContextCurrent(window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    start_gl_trace(); // to the file named by GLTRACE, if set
     glfwSwapInterval(1); // vsync on
 
     print_info();
     crosshair_cursor = glfwCreateStandardCursor(GLFW_CROSSHAIR_CURSOR);
     set_callbacks(window);
+    attach_input_log(window);
 
     program = create_program();
     glUseProgram(program);
 
-    // Define the vertices of our triangle.
-    // Note that the winding order is counter-clockwise.
-    const GLfloat vertices[]{
-        // position         color
-        -0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 0.0f,
-         0.5f, -0.5f, 0.0f, 0.0f, 1.0f, 0.0f,
-         0.0f,  0.5f, 0.0f, 0.0f, 0.0f, 1.0f,
-    };
-
-    // Create and populate interleaved vertex buffer using
-    // DSA (Direct State Access) API in OpenGL 4.5.
-    GLuint vbo{};
+    // Place every shape and insert it into the spatial index once, at its
+    // initial world-space vertices
+    placements.resize(num_shapes);
+    std::vector<ShapeVertices> vertices(num_shapes);
+    for (int shape{}; shape < num_shapes; shape++) {
+        placements[shape] = initial_placement(shape);
+        glm::vec2 world[3];
+        vertices[shape] = transform_shape(placements[shape], world);
+        insert_shape(shape_index, world);
+    }
+
+    // Create and populate the interleaved vertex buffer using DSA (Direct
+    // State Access) API in OpenGL 4.5, with position and color for 3
+    // vertices per shape
     glCreateBuffers(1, &vbo);
-    glNamedBufferStorage(vbo, sizeof(vertices), vertices, 0);
+    glNamedBufferStorage(vbo, num_shapes*sizeof(ShapeVertices), vertices.data(), GL_DYNAMIC_STORAGE_BIT);
 
     // Create VAO
     GLuint vao{};
@@ -348,21 +611,40 @@ int main()
     // calling the above functions.
     glBindVertexArray(vao);
 
+    // Hand the context over to the render thread. From here on, this thread
+    // only waits for events, handles them, and passes the results on.
+    publish_snapshot(window);
+    glfwMakeContextCurrent(nullptr);
+    std::thread render_thread(render_loop, window);
+
     while (!glfwWindowShouldClose(window)) {
         process_gamepad(window);
-        render(window, glfwGetTime());
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        poll_input(window, 0.1);
+        process_input(window);
+        send_unsent_events();
+        publish_snapshot(window);
+        if (input_log_mode() == REPLAY_PLAY) {
+            // Replay a frame per frame presented, as the recording saw them
+            while (presented_frame.load(std::memory_order_acquire) < published_frames) {
+                std::this_thread::yield();
+            }
+        }
     }
+    stop_input_log();
+    quitting.store(true, std::memory_order_release);
+    render_thread.join();
+    glfwMakeContextCurrent(window);
 
     // Shutting down from here onwards
     glDeleteVertexArrays(1, &vao);
     glDeleteBuffers(1, &vbo);
     glDeleteProgram(program);
 
+    stop_gl_trace();
     glfwDestroyWindow(window);
     glfwTerminate();
 
+    fmt::print("{} cursor events handled in {} input frames\n", input.cursor_events, input.frames);
     fmt::print("Bye.\n");
     return 0;
 }
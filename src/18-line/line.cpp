@@ -6,12 +6,17 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <vector>
+#include "gltrace.h"
+#include "polyline.h"
+#include "renderqueue.h"
 #include "shader.h"
 #include "utils.h"
 
 // Global variables
 static GLuint program{};
+static GLuint transform_program{};
 static glm::mat4 proj_matrix{};
+static glm::vec2 resolution{};
 
 static GLuint create_program()
 {
@@ -31,6 +36,7 @@ static void set_viewport(GLFWwindow* window)
     const float w = width, h = height;
     const float aspect = w / h;
     proj_matrix = glm::ortho(-aspect, aspect, -1.0f, 1.0f, -10.0f, 10.0f);
+    resolution = glm::vec2{w, h};
     const GLint loc_res = glGetUniformLocation(program, "u_resolution");
     glUniform2f(loc_res, w, h);
 }
@@ -52,7 +58,9 @@ static void set_callbacks(GLFWwindow* window)
             else if (key == GLFW_KEY_F5 && action == GLFW_PRESS) {
                 // Press F5 to reload shaders
                 glDeleteProgram(program);
+                glDeleteProgram(transform_program);
                 program = create_program();
+                transform_program = create_polyline_transform_program();
                 glUseProgram(program);
             }
         }
@@ -150,17 +158,18 @@ int main()
 
     glfwMakeContextCurrent(window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    start_gl_trace(); // to the file named by GLTRACE, if set
     glfwSwapInterval(1); // vsync on
 
     print_info();
     set_callbacks(window);
 
     program = create_program();
+    transform_program = create_polyline_transform_program();
     glUseProgram(program);
 
     // https://stackoverflow.com/questions/60440682/drawing-a-line-in-modern-opengl
 
-    const GLint loc_mvp = glGetUniformLocation(program, "u_mvp");
     const GLint loc_thi = glGetUniformLocation(program, "u_thickness");
 
     glUniform1f(loc_thi, 20.0f);
@@ -182,45 +191,64 @@ int main()
     varray.emplace_back(glm::vec4{1.0f, -1.0f, 0.0f, 1.0f});
     varray.emplace_back(glm::vec4{1.0f, 0.0f, 0.0f, 1.0f});
     const GLuint ssbo = create_ssbo(varray);
+    const GLsizei num_points = static_cast<GLsizei>(varray.size());
+
+    // One window-space copy of the points per pass, written by the transform pre-pass
+    GLuint screen_ssbo[2]{};
+    glCreateBuffers(2, screen_ssbo);
+    for (GLuint buffer : screen_ssbo) {
+        glNamedBufferStorage(buffer, varray.size()*sizeof(*varray.data()), nullptr, 0);
+    }
 
     GLuint vao{};
     glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
     const GLsizei N = static_cast<GLsizei>(varray.size()) - 2;
 
     glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
 
+    // Pass 0 draws filled polygons and pass 1 outlined polygons. Each pass
+    // reads its own window-space points, bound by its material.
+    RenderQueue queue;
+    set_pass_state(queue, 0, {GL_FILL});
+    set_pass_state(queue, 1, {GL_LINE});
+    const GLuint pass_points[2]{
+        add_material(queue, [&screen_ssbo] { glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, screen_ssbo[0]); }),
+        add_material(queue, [&screen_ssbo] { glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, screen_ssbo[1]); }),
+    };
+    const float offsets[2]{-0.6f, 0.6f};
+
     set_viewport(window);
     while (!glfwWindowShouldClose(window)) {
         glClear(GL_COLOR_BUFFER_BIT);
 
-        // Draw filled polygons
-        {
+        // Transform the points of both passes before any draw, so that the
+        // queue submits the draws without switching programs in between.
+        // The transforms bind their program through the queue's GlState,
+        // which then only has to switch programs once per frame.
+        for (GLuint i{}; i < 2; i++) {
             glm::mat4 mv_matrix{1.0f};
-            mv_matrix = glm::translate(mv_matrix, glm::vec3{-0.6f, 0.0f, 0.0f});
+            mv_matrix = glm::translate(mv_matrix, glm::vec3{offsets[i], 0.0f, 0.0f});
             mv_matrix = glm::scale(mv_matrix, glm::vec3{0.5f, 0.5f, 1.0f});
             const glm::mat4 mvp_matrix = proj_matrix * mv_matrix;
 
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-            glUniformMatrix4fv(loc_mvp, 1, GL_FALSE, glm::value_ptr(mvp_matrix));
-            glDrawArrays(GL_TRIANGLES, 0, 6*(N-1));
-        }
+            transform_polyline(queue.state, transform_program, ssbo, screen_ssbo[i], num_points, mvp_matrix, resolution);
 
-        // Draw outlined polygons
-        {
-            glm::mat4 mv_matrix{1.0f};
-            mv_matrix = glm::translate(mv_matrix, glm::vec3{0.6f, 0.0f, 0.0f});
-            mv_matrix = glm::scale(mv_matrix, glm::vec3{0.5f, 0.5f, 1.0f});
-            const glm::mat4 mvp_matrix = proj_matrix * mv_matrix;
-
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-            glUniformMatrix4fv(loc_mvp, 1, GL_FALSE, glm::value_ptr(mvp_matrix));
-            glDrawArrays(GL_TRIANGLES, 0, 6*(N-1));
+            DrawPacket line;
+            line.pass = i;
+            line.program = program;
+            line.vao = vao;
+            line.material = pass_points[i];
+            line.count = 6*(N-1);
+            push_draw(queue, line);
         }
 
+        submit_render_queue(queue);
+
         glfwSwapBuffers(window);
+        trace_frame();
         glfwPollEvents();
     }
+    stop_gl_trace();
     glfwTerminate();
 
     fmt::print("Bye.\n");
@@ -1,44 +1,21 @@
 #include "glad.h"
-#include <filesystem>
 #include <fmt/core.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <string_view>
 #include <vector>
-#include "shader.h"
-#include "utils.h"
+#include "dashed.h"
+#include "gltrace.h"
+#include "replay.h"
+#include "timestep.h"
 
 // Global variables
-static GLuint program{};
+static DashedPolyline dashed{};
 static glm::mat4 proj_matrix{};
-
-static GLuint create_program()
-{
-    namespace fs = std::filesystem;
-    return compile_shaders({
-        fs::canonical(dirname() / ".." / "shader" / "dashed-line.vert").c_str(),
-        fs::canonical(dirname() / ".." / "shader" / "dashed-line.frag").c_str(),
-    });
-}
-
-static void reload_program(GLFWwindow* window)
-{
-    glDeleteProgram(program);
-    program = create_program();
-    glUseProgram(program);
-
-    int width{}, height{};
-    glfwGetFramebufferSize(window, &width, &height);
-
-    const GLint loc_dash = glGetUniformLocation(program, "u_dashSize");
-    const GLint loc_gap  = glGetUniformLocation(program, "u_gapSize");
-    const GLint loc_res  = glGetUniformLocation(program, "u_resolution");
-
-    glUniform1f(loc_dash, 10.0f);
-    glUniform1f(loc_gap, 10.0f);
-    glUniform2f(loc_res, width, height);
-}
+static glm::vec2 resolution{};
+static FixedTimestep timestep{};
 
 static void set_viewport(GLFWwindow* window)
 {
@@ -48,8 +25,7 @@ static void set_viewport(GLFWwindow* window)
 
     const float w = width, h = height;
     proj_matrix = glm::perspective(glm::radians(90.0f), w/h, 0.1f, 10.0f);
-    const GLint loc_res = glGetUniformLocation(program, "u_resolution");
-    glUniform2f(loc_res, w, h);
+    resolution = glm::vec2{w, h};
 }
 
 static void set_callbacks(GLFWwindow* window)
@@ -67,7 +43,8 @@ static void set_callbacks(GLFWwindow* window)
                 glfwSetWindowShouldClose(window, GLFW_TRUE);
             }
             else if (key == GLFW_KEY_F5 && action == GLFW_PRESS) {
-                reload_program(window);
+                // Press F5 to reload shaders
+                reload_dashed_polyline(dashed);
             }
         }
     );
@@ -82,7 +59,7 @@ static void print_info()
     fmt::print("GL_SHADING_LANGUAGE_VERSION: {}\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
 }
 
-int main()
+int main(int argc, char* argv[])
 {
     glfwSetErrorCallback(
         [](int error, const char* description) {
@@ -94,6 +71,14 @@ int main()
         exit(EXIT_FAILURE);
     }
 
+    // Record with --record <file>, replay with --replay <file>. Advance
+    // 1/60 s per frame rather than by the clock in a replay or with
+    // --deterministic, so that frames are the same on any machine and frame cap.
+    if (start_input_log(argc, argv) == REPLAY_PLAY
+        || (argc > 1 && std::string_view{argv[1]} == "--deterministic")) {
+        set_deterministic(timestep, REPLAY_FRAME_TIME);
+    }
+
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -107,64 +92,71 @@ int main()
 
     glfwMakeContextCurrent(window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    start_gl_trace(); // to the file named by GLTRACE, if set
     glfwSwapInterval(1); // vsync on
 
     print_info();
     set_callbacks(window);
-
-    program = create_program();
-    glUseProgram(program);
+    attach_input_log(window);
 
     // https://stackoverflow.com/questions/52928678/dashed-line-in-opengl3
 
-    const GLint loc_mvp  = glGetUniformLocation(program, "u_mvp");
-    const GLint loc_dash = glGetUniformLocation(program, "u_dashSize");
-    const GLint loc_gap  = glGetUniformLocation(program, "u_gapSize");
-
-    glUniform1f(loc_dash, 10.0f);
-    glUniform1f(loc_gap, 10.0f);
-
-    const std::vector<GLfloat> varray{
-        -1, -1, -1,   1, -1, -1,   1, 1, -1,   -1, 1, -1,
-        -1, -1,  1,   1, -1,  1,   1, 1,  1,   -1, 1,  1
+    // The 12 edges of a cube as polylines: the front and back faces as
+    // closed loops, then the 4 edges that join them. A point with w == 0
+    // separates two polylines.
+    const glm::vec4 v[]{
+        {-1, -1, -1, 1},   {1, -1, -1, 1},   {1, 1, -1, 1},   {-1, 1, -1, 1},
+        {-1, -1,  1, 1},   {1, -1,  1, 1},   {1, 1,  1, 1},   {-1, 1,  1, 1}
     };
-    const std::vector<GLuint> iarray{
-        0, 1, 1, 2, 2, 3, 3, 0,
-        4, 5, 5, 6, 6, 7, 7, 4,
-        0, 4, 1, 5, 2, 6, 3, 7
+    const glm::vec4 brk{0.0f};
+    const std::vector<glm::vec4> varray{
+        v[0], v[1], v[2], v[3], v[0], brk,
+        v[4], v[5], v[6], v[7], v[4], brk,
+        v[0], v[4], brk,
+        v[1], v[5], brk,
+        v[2], v[6], brk,
+        v[3], v[7]
     };
+    create_dashed_polyline(dashed, varray, {10.0f, 10.0f});
 
-    GLuint bo[2]{}, vao{};
-    glGenBuffers(2, bo);
-    glGenVertexArrays(1, &vao);
+    GLuint vao{};
+    glCreateVertexArrays(1, &vao);
     glBindVertexArray(vao);
-    glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, bo[0]);
-    glBufferData(GL_ARRAY_BUFFER, varray.size()*sizeof(*varray.data()), varray.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bo[1]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, iarray.size()*sizeof(*iarray.data()), iarray.data(), GL_STATIC_DRAW);
 
     glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
 
     set_viewport(window);
+    float angle{1.0f};
+    float previous_angle{angle};
     while (!glfwWindowShouldClose(window)) {
-        static float angle{1.0f};
+        // Turn the cube 30 degrees per second in fixed ticks, and draw it
+        // between the last two
+        begin_timestep(timestep, glfwGetTime());
+        while (next_tick(timestep)) {
+            previous_angle = angle;
+            angle += 30.0f * static_cast<float>(timestep.tick);
+        }
+        const float frame_angle = glm::mix(previous_angle, angle, static_cast<float>(timestep_alpha(timestep)));
+
         glm::mat4 mv_matrix{1.0f};
         mv_matrix = glm::translate(mv_matrix, glm::vec3{0.0f, 0.0f, -3.0f});
-        mv_matrix = glm::rotate(mv_matrix, glm::radians(angle), glm::vec3{1.0f, 0.0f, 0.0f});
-        mv_matrix = glm::rotate(mv_matrix, glm::radians(angle/2), glm::vec3{0.0f, 1.0f, 0.0f});
-        angle += 0.5f;
+        mv_matrix = glm::rotate(mv_matrix, glm::radians(frame_angle), glm::vec3{1.0f, 0.0f, 0.0f});
+        mv_matrix = glm::rotate(mv_matrix, glm::radians(frame_angle/2), glm::vec3{0.0f, 1.0f, 0.0f});
 
         const glm::mat4 mvp_matrix = proj_matrix * mv_matrix;
-        glUniformMatrix4fv(loc_mvp, 1, GL_FALSE, glm::value_ptr(mvp_matrix));
+        const glm::vec4 color{0.0f, 0.8f, 0.0f, 1.0f};
 
         glClear(GL_COLOR_BUFFER_BIT);
-        glDrawElements(GL_LINES, (GLsizei)iarray.size(), GL_UNSIGNED_INT, nullptr);
+        draw_dashed_polyline(dashed, mvp_matrix, resolution, color, 0.0f);
 
         glfwSwapBuffers(window);
-        glfwPollEvents();
+        trace_frame();
+        poll_input(window);
     }
+    stop_input_log();
+    glDeleteVertexArrays(1, &vao);
+    delete_dashed_polyline(dashed);
+    stop_gl_trace();
     glfwTerminate();
 
     fmt::print("Bye.\n");
@@ -1,45 +1,22 @@
 #include "glad.h"
-#include <filesystem>
+#include <cmath>
 #include <fmt/core.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <string_view>
 #include <vector>
-#include "shader.h"
-#include "utils.h"
+#include "dashed.h"
+#include "gltrace.h"
+#include "replay.h"
+#include "timestep.h"
 
 // Global variables
-static GLuint program{};
+static DashedPolyline dashed{};
 static glm::mat4 proj_matrix{};
-static glm::mat4 window_matrix{};
-
-static GLuint create_program()
-{
-    namespace fs = std::filesystem;
-    return compile_shaders({
-        fs::canonical(dirname() / ".." / "shader" / "dashed-polygon.vert").c_str(),
-        fs::canonical(dirname() / ".." / "shader" / "dashed-polygon.frag").c_str(),
-    });
-}
-
-static void reload_program(GLFWwindow* window)
-{
-    glDeleteProgram(program);
-    program = create_program();
-    glUseProgram(program);
-
-    int width{}, height{};
-    glfwGetFramebufferSize(window, &width, &height);
-
-    const GLint loc_dash = glGetUniformLocation(program, "u_dashSize");
-    const GLint loc_gap  = glGetUniformLocation(program, "u_gapSize");
-    const GLint loc_res  = glGetUniformLocation(program, "u_resolution");
-
-    glUniform1f(loc_dash, 10.0f);
-    glUniform1f(loc_gap, 10.0f);
-    glUniform2f(loc_res, width, height);
-}
+static glm::vec2 resolution{};
+static FixedTimestep timestep{};
 
 static void set_viewport(GLFWwindow* window)
 {
@@ -49,10 +26,7 @@ static void set_viewport(GLFWwindow* window)
 
     const float w = width, h = height;
     proj_matrix = glm::perspective(glm::radians(90.0f), w/h, 0.1f, 10.0f);
-    const GLint loc_res = glGetUniformLocation(program, "u_resolution");
-    glUniform2f(loc_res, w, h);
-    window_matrix = glm::scale(glm::mat4{1.0f}, glm::vec3{w/2, h/2, 1.0f});
-    window_matrix = glm::translate(window_matrix, glm::vec3{1.0f, 1.0f, 0.0f});
+    resolution = glm::vec2{w, h};
 }
 
 static void set_callbacks(GLFWwindow* window)
@@ -70,7 +44,8 @@ static void set_callbacks(GLFWwindow* window)
                 glfwSetWindowShouldClose(window, GLFW_TRUE);
             }
             else if (key == GLFW_KEY_F5 && action == GLFW_PRESS) {
-                reload_program(window);
+                // Press F5 to reload shaders
+                reload_dashed_polyline(dashed);
             }
         }
     );
@@ -85,7 +60,7 @@ static void print_info()
     fmt::print("GL_SHADING_LANGUAGE_VERSION: {}\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
 }
 
-int main()
+int main(int argc, char* argv[])
 {
     glfwSetErrorCallback(
         [](int error, const char* description) {
@@ -97,6 +72,14 @@ int main()
         exit(EXIT_FAILURE);
     }
 
+    // Record with --record <file>, replay with --replay <file>. Advance
+    // 1/60 s per frame rather than by the clock in a replay or with
+    // --deterministic, so that frames are the same on any machine and frame cap.
+    if (start_input_log(argc, argv) == REPLAY_PLAY
+        || (argc > 1 && std::string_view{argv[1]} == "--deterministic")) {
+        set_deterministic(timestep, REPLAY_FRAME_TIME);
+    }
+
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -110,77 +93,66 @@ int main()
 
     glfwMakeContextCurrent(window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    start_gl_trace(); // to the file named by GLTRACE, if set
     glfwSwapInterval(1); // vsync on
 
     print_info();
     set_callbacks(window);
-
-    program = create_program();
-    glUseProgram(program);
+    attach_input_log(window);
 
     // https://stackoverflow.com/questions/52928678/dashed-line-in-opengl3
 
-    const GLint loc_mvp  = glGetUniformLocation(program, "u_mvp");
-    const GLint loc_dash = glGetUniformLocation(program, "u_dashSize");
-    const GLint loc_gap  = glGetUniformLocation(program, "u_gapSize");
-
-    glUniform1f(loc_dash, 10.0f);
-    glUniform1f(loc_gap, 10.0f);
-
-    std::vector<glm::vec3> varray;
+    std::vector<glm::vec4> varray;
     for (int u{}; u <= 360; ++u) {
         const float a = glm::radians(static_cast<float>(u));
         const float c = std::cos(a), s = std::sin(a);
-        varray.emplace_back(glm::vec3{c, s, 0.0f});
+        varray.emplace_back(glm::vec4{c, s, 0.0f, 1.0f});
     }
-    std::vector<float> darray(varray.size(), 0.0f);
 
-    GLuint bo[2]{}, vao{};
-    glGenBuffers(2, bo);
-    glGenVertexArrays(1, &vao);
+    // Dash-dot pattern, continuous around the whole polygon
+    create_dashed_polyline(dashed, varray, {20.0f, 6.0f, 4.0f, 6.0f});
+
+    GLuint vao{};
+    glCreateVertexArrays(1, &vao);
     glBindVertexArray(vao);
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glBindBuffer(GL_ARRAY_BUFFER, bo[0]);
-    glBufferData(GL_ARRAY_BUFFER, varray.size()*sizeof(*varray.data()), varray.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, bo[1] );
-    glBufferData(GL_ARRAY_BUFFER, darray.size()*sizeof(*darray.data()), darray.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, 0, 0);
 
     glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
 
     set_viewport(window);
+    float angle{1.0f};
+    float previous_angle{angle};
     while (!glfwWindowShouldClose(window)) {
-        static float angle{1.0f};
+        // Turn the polygon 30 degrees per second in fixed ticks, and draw it
+        // between the last two
+        begin_timestep(timestep, glfwGetTime());
+        while (next_tick(timestep)) {
+            previous_angle = angle;
+            angle += 30.0f * static_cast<float>(timestep.tick);
+        }
+        const float frame_angle = glm::mix(previous_angle, angle, static_cast<float>(timestep_alpha(timestep)));
+
         glm::mat4 mv_matrix{1.0f};
         mv_matrix = glm::translate(mv_matrix, glm::vec3{0.0f, 0.0f, -2.0f});
-        mv_matrix = glm::rotate(mv_matrix, glm::radians(angle), glm::vec3{1.0f, 0.0f, 0.0f});
-        mv_matrix = glm::rotate(mv_matrix, glm::radians(angle/2), glm::vec3{0.0f, 1.0f, 0.0f});
-        angle += 0.5f;
+        mv_matrix = glm::rotate(mv_matrix, glm::radians(frame_angle), glm::vec3{1.0f, 0.0f, 0.0f});
+        mv_matrix = glm::rotate(mv_matrix, glm::radians(frame_angle/2), glm::vec3{0.0f, 1.0f, 0.0f});
 
         const glm::mat4 mvp_matrix = proj_matrix * mv_matrix;
-        glUniformMatrix4fv(loc_mvp, 1, GL_FALSE, glm::value_ptr(mvp_matrix));
-
-        glm::vec2 vpPt{0.0f, 0.0f};
-        float dist{0.0f};
-        for (size_t i{}; i < varray.size(); ++i) {
-            darray[i] = dist;
-            const glm::vec4 clip = mvp_matrix * glm::vec4{varray[i], 1.0f};
-            const glm::vec4 ndc  = clip / clip.w;
-            const glm::vec4 vpC  = window_matrix * ndc;
-            const float len = i==0 ? 0.0f : glm::length(vpPt - glm::vec2{vpC});
-            vpPt = glm::vec2(vpC);
-            dist += len;
-        }
-        glBufferSubData(GL_ARRAY_BUFFER, 0, darray.size()*sizeof(*darray.data()), darray.data());
+        const glm::vec4 color{0.0f, 0.8f, 0.0f, 1.0f};
+
+        // March the dashes along the polygon at 30 pixels per second
+        const float phase = -30.0f * static_cast<float>(timestep_time(timestep));
 
         glClear(GL_COLOR_BUFFER_BIT);
-        glDrawArrays(GL_LINE_STRIP, 0, (GLsizei)varray.size());
+        draw_dashed_polyline(dashed, mvp_matrix, resolution, color, phase);
 
         glfwSwapBuffers(window);
-        glfwPollEvents();
+        trace_frame();
+        poll_input(window);
     }
+    stop_input_log();
+    glDeleteVertexArrays(1, &vao);
+    delete_dashed_polyline(dashed);
+    stop_gl_trace();
     glfwTerminate();
 
     fmt::print("Bye.\n");
@@ -1,26 +1,45 @@
 #include "glad.h"
 #include <cmath>
-#include <filesystem>
+#include <cstdlib>
 #include <fmt/core.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
+#include <random>
 #include <vector>
-#include "shader.h"
-#include "utils.h"
+#include "dots.h"
+#include "gltrace.h"
+#include "replay.h"
 
 // Global variables
-static GLuint program{};
+static DotRenderer renderer{};
+static std::vector<Dot> dots;
+static std::vector<int> clusters; // cluster of every dot, which picks its color
 static int first_color_index{};
-
-static GLuint create_program()
+static float zoom{1.0f};
+static glm::vec2 pan{};
+
+// Selected CSS colors - https://www.w3schools.com/cssref/css_colors.php
+static const glm::vec3 colors[10]{
+    {1.0f, 0.0f, 0.0f},                   // red
+    {0.0f, 1.0f, 0.0f},                   // green
+    {0.0f, 0.0f, 1.0f},                   // blue
+    {1.0f, 215.0f/255, 0.0f},             // gold
+    {0.5f, 0.5f, 0.5f},                   // medium gray
+    {128.0f/255, 128.0f/255, 0.0f},       // olive
+    {100.0f/255, 149.0f/255, 237.0f/255}, // cornflower blue
+    {1.0f, 105.0f/255, 180.0f/255},       // hot pink
+    {138.0f/255, 43.0f/255, 226.0f/255},  // blue violet
+    {1.0f, 1.0f, 1.0f},                   // white
+};
+
+static void update_colors()
 {
-    namespace fs = std::filesystem;
-    return compile_shaders({
-        fs::canonical(dirname() / ".." / "shader" / "dots-instancing.vert").c_str(),
-        fs::canonical(dirname() / ".." / "shader" / "basic.frag").c_str(),
-    });
+    for (size_t i{}; i < dots.size(); i++) {
+        const glm::vec3& color = colors[(first_color_index + clusters[i]) % 10];
+        dots[i].color = pack_color(glm::vec4{color, 1.0f});
+    }
+    update_dots(renderer, dots);
 }
 
 static void set_callbacks(GLFWwindow* window)
@@ -34,25 +53,52 @@ static void set_callbacks(GLFWwindow* window)
     glfwSetKeyCallback(
         window,
         [](GLFWwindow* window, int key, int scancode, int action, int mods) {
+            const float step = 0.1f / zoom;
             if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
                 glfwSetWindowShouldClose(window, GLFW_TRUE);
             }
             else if (key == GLFW_KEY_F5 && action == GLFW_PRESS) {
                 // Press F5 to reload shaders
-                glDeleteProgram(program);
-                program = create_program();
-                glUseProgram(program);
+                reload_dot_renderer(renderer);
+            }
+            else if (key == GLFW_KEY_X && action == GLFW_PRESS) {
+                renderer.lods.crossfade = renderer.lods.crossfade > 0.0f ? 0.0f : 0.2f;
+                fmt::print("LOD crossfade {}\n", renderer.lods.crossfade > 0.0f ? "on" : "off");
+            }
+            else if (key == GLFW_KEY_HOME && action == GLFW_PRESS) {
+                zoom = 1.0f;
+                pan = glm::vec2{};
+            }
+            else if (key == GLFW_KEY_LEFT && action != GLFW_RELEASE) {
+                pan.x -= step;
+            }
+            else if (key == GLFW_KEY_RIGHT && action != GLFW_RELEASE) {
+                pan.x += step;
+            }
+            else if (key == GLFW_KEY_DOWN && action != GLFW_RELEASE) {
+                pan.y -= step;
+            }
+            else if (key == GLFW_KEY_UP && action != GLFW_RELEASE) {
+                pan.y += step;
             }
         }
     );
+    glfwSetScrollCallback(
+        window,
+        [](GLFWwindow* window, double xoffset, double yoffset) {
+            zoom = glm::clamp(zoom * std::pow(1.2f, static_cast<float>(yoffset)), 0.1f, 1000.0f);
+        }
+    );
     glfwSetMouseButtonCallback(
         window,
         [](GLFWwindow* window, int button, int action, int mods) {
             if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
                 first_color_index = (first_color_index + 1) % 10;
+                update_colors();
             }
             else if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS) {
                 first_color_index = (first_color_index + 9) % 10;
+                update_colors();
             }
         }
     );
@@ -66,95 +112,57 @@ static void print_info()
     fmt::print("GL_VERSION: {}\n", glGetString(GL_VERSION));
     fmt::print("GL_SHADING_LANGUAGE_VERSION: {}\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
 
-    GLint max_vertex_attribs{};
-    glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &max_vertex_attribs);
-    fmt::print("GL_MAX_VERTEX_ATTRIBS: {}\n", max_vertex_attribs);
-
-    GLint max_vertex_attrib_bindings{};
-    glGetIntegerv(GL_MAX_VERTEX_ATTRIB_BINDINGS, &max_vertex_attrib_bindings);
-    fmt::print("GL_MAX_VERTEX_ATTRIB_BINDINGS: {}\n", max_vertex_attrib_bindings);
-
-    GLint max_uniform_locations{};
-    glGetIntegerv(GL_MAX_UNIFORM_LOCATIONS, &max_uniform_locations);
-    fmt::print("GL_MAX_UNIFORM_LOCATIONS: {}\n", max_uniform_locations);
+    GLint max_ssbo_size{};
+    glGetIntegerv(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &max_ssbo_size);
+    fmt::print("GL_MAX_SHADER_STORAGE_BLOCK_SIZE: {}\n", max_ssbo_size);
 
     fmt::print("Press left and right mouse buttons to rotate colors.\n");
+    fmt::print("Scroll to zoom, press the arrow keys to pan and Home to reset the view.\n");
+    fmt::print("Press X to toggle the dithered LOD crossfade.\n");
 }
 
-static void render(GLFWwindow* window, double current_time, int num_vertices)
+static void render(GLFWwindow* window)
 {
-    // Build view matrix
-    const glm::vec3 camera{0.0f, 0.0f, 5.0f};
-    const glm::vec3 center{0.0f, 0.0f, 0.0f};
-    const glm::vec3 up{0.0f, 1.0f, 0.0f};
-    const glm::mat4 view_matrix = glm::lookAt(camera, center, up);
-
-    // Build orthographic projection matrix
+    // Build orthographic projection matrix, zoomed and panned
     int width{}, height{};
     glfwGetFramebufferSize(window, &width, &height);
     const float aspect = static_cast<float>(width) / static_cast<float>(height);
     const glm::mat4 proj_matrix = glm::ortho(-aspect, aspect, -1.0f, 1.0f, -10.0f, 10.0f);
+    const glm::mat4 view_matrix = glm::translate(
+        glm::scale(glm::mat4{1.0f}, glm::vec3{zoom, zoom, 1.0f}),
+        glm::vec3{-pan, 0.0f});
 
-    // Build scale matrix
-    const float tf = static_cast<float>(current_time);
-    const float sf = 0.045f * std::sin(tf * 2) + 0.055f; // [0.01..0.1]
-    const glm::mat4 scale_matrix = glm::scale(glm::mat4{1.0f}, glm::vec3{sf, sf, 1.0f});
-
-    // Get uniform locations
-    const GLint loc_view_matrix = glGetUniformLocation(program, "u_view_matrix");
-    const GLint loc_proj_matrix = glGetUniformLocation(program, "u_proj_matrix");
-    const GLint loc_scale_matrix = glGetUniformLocation(program, "u_scale_matrix");
-
-    // Copy to uniform variables
-    glUniformMatrix4fv(loc_view_matrix, 1, GL_FALSE, glm::value_ptr(view_matrix));
-    glUniformMatrix4fv(loc_proj_matrix, 1, GL_FALSE, glm::value_ptr(proj_matrix));
-    glUniformMatrix4fv(loc_scale_matrix, 1, GL_FALSE, glm::value_ptr(scale_matrix));
-
-    // Selected CSS colors - https://www.w3schools.com/cssref/css_colors.php
-    static const glm::vec3 colors[10]{
-        {1.0f, 0.0f, 0.0f},                   // red
-        {0.0f, 1.0f, 0.0f},                   // green
-        {0.0f, 0.0f, 1.0f},                   // blue
-        {1.0f, 215.0f/255, 0.0f},             // gold
-        {0.5f, 0.5f, 0.5f},                   // medium gray
-        {128.0f/255, 128.0f/255, 0.0f},       // olive
-        {100.0f/255, 149.0f/255, 237.0f/255}, // cornflower blue
-        {1.0f, 105.0f/255, 180.0f/255},       // hot pink
-        {138.0f/255, 43.0f/255, 226.0f/255},  // blue violet
-        {1.0f, 1.0f, 1.0f},                   // white
-    };
-    for (int i{}; i < 10; i++) {
-        const std::string str = fmt::format("u_colors[{}]", i);
-        const GLint loc = glGetUniformLocation(program, str.c_str());
-        glUniform3fv(loc, 1, glm::value_ptr(colors[(first_color_index + i) % 10]));
-    }
-
-    // Draw 60 dots with instancing
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
-    glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, num_vertices, 60); // 6 rows by 10 columns
+    glClear(GL_COLOR_BUFFER_BIT);
+    draw_dots(renderer, proj_matrix * view_matrix, glm::vec2{width, height});
 }
 
-// https://stackoverflow.com/questions/59468388/how-to-use-gl-triangle-fan-to-draw-a-circle-in-opengl
-static std::vector<glm::vec2> gen_circle(int num_vertices)
+// A scatter plot of `n` dots in 10 Gaussian clusters
+static void gen_dots(int n)
 {
-    const float angle{glm::two_pi<float>() / num_vertices};
-    std::vector<glm::vec2> vertices;
-    vertices.reserve(num_vertices);
-
-    // We don't need a center point. Since a circle is a convex shape,
-    // we can simply use one of the points on the circle as the central
-    // vertex of our triangle fan.
-    for (int i{}; i < num_vertices; i++) {
-        vertices.emplace_back(glm::vec2{std::cos(angle * i), std::sin(angle * i)});
+    std::mt19937 rng{42};
+    std::uniform_real_distribution<float> uniform{-1.5f, 1.5f};
+    std::uniform_real_distribution<float> size{0.001f, 0.01f};
+    std::normal_distribution<float> normal{0.0f, 1.0f};
+
+    glm::vec2 centers[10];
+    float spreads[10];
+    for (int i{}; i < 10; i++) {
+        centers[i] = glm::vec2{uniform(rng), uniform(rng) / 1.5f};
+        spreads[i] = 0.05f + 0.25f * std::abs(normal(rng));
     }
 
-    return vertices;
+    dots.resize(n);
+    clusters.resize(n);
+    for (int i{}; i < n; i++) {
+        const int c = i % 10;
+        dots[i].position = centers[c] + spreads[c] * glm::vec2{normal(rng), normal(rng)};
+        dots[i].radius = size(rng);
+        clusters[i] = c;
+    }
 }
 
-int main()
+int main(int argc, char* argv[])
 {
     glfwSetErrorCallback(
         [](int error, const char* description) {
@@ -166,6 +174,10 @@ int main()
         exit(EXIT_FAILURE);
     }
 
+    // Record with --record <file>, replay with --replay <file>
+    start_input_log(argc, argv);
+    const int num_dots = argc > 1 ? std::atoi(argv[1]) : 1'000'000;
+
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -179,56 +191,31 @@ int main()
 
     glfwMakeContextCurrent(window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    start_gl_trace(); // to the file named by GLTRACE, if set
     glfwSwapInterval(1); // vsync on
 
     print_info();
     set_callbacks(window);
+    attach_input_log(window);
 
-    program = create_program();
-    glUseProgram(program);
-
-    // Generate the vertices of our circle
-    const std::vector<glm::vec2> vertices = gen_circle(30);
-
-    // Create and populate interleaved vertex buffer using
-    // DSA (Direct State Access) API in OpenGL 4.5.
-    GLuint vbo{};
-    glCreateBuffers(1, &vbo);
-    glNamedBufferStorage(vbo, sizeof(glm::vec2) * vertices.size(), vertices.data(), 0);
-
-    // Create VAO
-    GLuint vao{};
-    glCreateVertexArrays(1, &vao);
-
-    // Bind the vertex buffer to the VAO's vertex buffer binding point
-    const GLuint binding_index{0}; // [0..GL_MAX_VERTEX_ATTRIB_BINDINGS)
-    glVertexArrayVertexBuffer(vao, binding_index, vbo, 0, sizeof(glm::vec2));
-
-    // Enable vertex attribute location 0
-    glEnableVertexArrayAttrib(vao, 0);
-
-    // Specify the data format for each vertex attribute location
-    glVertexArrayAttribFormat(vao, 0, glm::vec2::length(), GL_FLOAT, GL_FALSE, 0);
-
-    // Tell OpenGL to read the data for vertex attribute location 0
-    // from the buffer, which is attached to vertex buffer binding point 0.
-    glVertexArrayAttribBinding(vao, 0, binding_index);
-
-    // This shows that we do not have to bind the VAO before
-    // calling the above functions.
-    glBindVertexArray(vao);
+    // Per-instance position, radius and color live in an SSBO
+    gen_dots(num_dots);
+    create_dot_renderer(renderer, dots);
+    update_colors();
+    fmt::print("Drawing {} dots.\n", renderer.num_dots);
 
     while (!glfwWindowShouldClose(window)) {
-        render(window, glfwGetTime(), vertices.size());
+        render(window);
         glfwSwapBuffers(window);
-        glfwPollEvents();
+        trace_frame();
+        poll_input(window);
     }
+    stop_input_log();
 
     // Shutting down from here onwards
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
-    glDeleteProgram(program);
+    delete_dot_renderer(renderer);
 
+    stop_gl_trace();
     glfwDestroyWindow(window);
     glfwTerminate();
 
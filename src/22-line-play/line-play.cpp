@@ -7,12 +7,16 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <vector>
+#include "gltrace.h"
+#include "polyline.h"
 #include "shader.h"
 #include "utils.h"
 
 // Global variables
 static GLuint program{};
+static GLuint transform_program{};
 static glm::mat4 proj_matrix{};
+static glm::vec2 resolution{};
 
 static GLuint create_program()
 {
@@ -32,6 +36,7 @@ static void set_viewport(GLFWwindow* window)
     const float w = width, h = height;
     const float aspect = w / h;
     proj_matrix = glm::ortho(-aspect, aspect, -1.0f, 1.0f, -10.0f, 10.0f);
+    resolution = glm::vec2{w, h};
     const GLint loc_res = glGetUniformLocation(program, "u_resolution");
     glUniform2f(loc_res, w, h);
 }
@@ -53,7 +58,9 @@ static void set_callbacks(GLFWwindow* window)
             else if (key == GLFW_KEY_F5 && action == GLFW_PRESS) {
                 // Press F5 to reload shaders
                 glDeleteProgram(program);
+                glDeleteProgram(transform_program);
                 program = create_program();
+                transform_program = create_polyline_transform_program();
                 glUseProgram(program);
             }
         }
@@ -126,9 +133,29 @@ static GLuint create_ssbo(const std::vector<glm::vec4>& varray)
     return ssbo;
 }
 
+// Mirrors shader/polyline-transform.comp
+std::vector<glm::vec4> compute_shader_main(
+    const std::vector<glm::vec4>& vertex,
+    const glm::mat4& u_mvp, const glm::vec2& u_resolution)
+{
+    using glm::vec4;
+
+    std::vector<vec4> screen(vertex.size());
+    for (size_t i{}; i < vertex.size(); i++)
+    {
+        vec4 v = u_mvp * vertex[i];
+        v = vec4{v.xyz() / v.w, v.w};
+        v = vec4{(v.xy() + 1.0f) * 0.5f * u_resolution, v.z, v.w};
+        screen[i] = v;
+        fmt::print("screen[{}] = {} {} {} {}\n", i, v.x, v.y, v.z, v.w);
+    }
+    return screen;
+}
+
+// Mirrors shader/line.vert
 void vertex_shader_main(
-    const std::vector<glm::vec4>& vertex, GLsizei count,
-    const glm::mat4& u_mvp, const glm::vec2& u_resolution, float u_thickness)
+    const std::vector<glm::vec4>& screen, GLsizei count,
+    const glm::vec2& u_resolution, float u_thickness)
 {
     using glm::vec4;
     using glm::vec2;
@@ -143,9 +170,7 @@ void vertex_shader_main(
         vec4 va[4];
         for (int i=0; i<4; ++i)
         {
-            va[i] = u_mvp * vertex[line_i+i];
-            va[i] = vec4{va[i].xyz() / va[i].w, va[i].w};
-            va[i] = vec4{(va[i].xy() + 1.0f) * 0.5f * u_resolution, va[i].z, va[i].w};
+            va[i] = screen[line_i+i];
             fmt::print("va[{}] = {} {} {} {}\n", i, va[i].x, va[i].y, va[i].z, va[i].w);
         }
 
@@ -214,17 +239,18 @@ int main()
 
     glfwMakeContextCurrent(window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    start_gl_trace(); // to the file named by GLTRACE, if set
     glfwSwapInterval(1); // vsync on
 
     print_info();
     set_callbacks(window);
 
     program = create_program();
+    transform_program = create_polyline_transform_program();
     glUseProgram(program);
 
     // https://stackoverflow.com/questions/60440682/drawing-a-line-in-modern-opengl
 
-    const GLint loc_mvp = glGetUniformLocation(program, "u_mvp");
     const GLint loc_thi = glGetUniformLocation(program, "u_thickness");
 
     glUniform1f(loc_thi, 20.0f);
@@ -237,6 +263,14 @@ int main()
         {+1.0f, 0.0f, 0.0f, 1.0f},
     };
     const GLuint ssbo = create_ssbo(varray);
+    const GLsizei num_points = static_cast<GLsizei>(varray.size());
+
+    // One window-space copy of the points per pass, written by the transform pre-pass
+    GLuint screen_ssbo[2]{};
+    glCreateBuffers(2, screen_ssbo);
+    for (GLuint buffer : screen_ssbo) {
+        glNamedBufferStorage(buffer, varray.size()*sizeof(*varray.data()), nullptr, 0);
+    }
 
     GLuint vao{};
     glGenVertexArrays(1, &vao);
@@ -257,15 +291,19 @@ int main()
             mv_matrix = glm::scale(mv_matrix, glm::vec3{0.5f, 0.5f, 1.0f});
             const glm::mat4 mvp_matrix = proj_matrix * mv_matrix;
 
+            transform_polyline(transform_program, ssbo, screen_ssbo[0], num_points, mvp_matrix, resolution);
+            glUseProgram(program);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, screen_ssbo[0]);
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-            glUniformMatrix4fv(loc_mvp, 1, GL_FALSE, glm::value_ptr(mvp_matrix));
             glDrawArrays(GL_TRIANGLES, 0, vertices);
 
             static bool print_debug{true};
             if (print_debug) {
                 int width{}, height{};
                 glfwGetFramebufferSize(window, &width, &height);
-                vertex_shader_main(varray, vertices, mvp_matrix, glm::vec2{width, height}, 20.0f);
+                const glm::vec2 res{width, height};
+                const std::vector<glm::vec4> screen = compute_shader_main(varray, mvp_matrix, res);
+                vertex_shader_main(screen, vertices, res, 20.0f);
                 print_debug = false;
             }
         }
@@ -277,14 +315,18 @@ int main()
             mv_matrix = glm::scale(mv_matrix, glm::vec3{0.5f, 0.5f, 1.0f});
             const glm::mat4 mvp_matrix = proj_matrix * mv_matrix;
 
+            transform_polyline(transform_program, ssbo, screen_ssbo[1], num_points, mvp_matrix, resolution);
+            glUseProgram(program);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, screen_ssbo[1]);
             glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-            glUniformMatrix4fv(loc_mvp, 1, GL_FALSE, glm::value_ptr(mvp_matrix));
             glDrawArrays(GL_TRIANGLES, 0, vertices);
         }
 
         glfwSwapBuffers(window);
+        trace_frame();
         glfwPollEvents();
     }
+    stop_gl_trace();
     glfwTerminate();
 
     fmt::print("Bye.\n");
@@ -1,13 +1,21 @@
 #include "glad.h"
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdlib>
 #include <filesystem>
 #include <fmt/core.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <thread>
 #include <vector>
+#include "commandbuffer.h"
+#include "gltrace.h"
+#include "jobs.h"
 #include "shader.h"
+#include "upload.h"
 #include "utils.h"
 
 // Global variables
@@ -16,6 +24,21 @@ static bool wireframe{};
 static std::vector<glm::vec2> all;
 static std::vector<GLint> count;
 static std::vector<GLint> first;
+static int num_shapes{12};
+static bool multithreaded{true}; // record the draws on all cores
+static std::vector<CommandBuffer> command_buffers; // one per worker
+static JobSystem jobs;
+static GLuint vbo{};
+static GLuint vao{};
+
+// The vertices stream into the vertex buffer in chunks of shapes while
+// rendering runs, and each chunk is drawn once its upload is visible
+constexpr int SHAPES_PER_CHUNK{4096};
+static UploadService uploads;
+static std::vector<std::uint64_t> chunk_tickets;
+static std::atomic<int> queued_chunks{}; // chunks with a ticket
+static std::atomic<bool> quitting{};
+static int ready_chunks{};                // chunks the render context sees
 
 static GLuint create_program()
 {
@@ -50,6 +73,10 @@ static void set_callbacks(GLFWwindow* window)
                 wireframe = !wireframe;
                 glPolygonMode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
             }
+            else if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+                multithreaded = !multithreaded;
+                fmt::print("Recording on {} thread(s)\n", multithreaded ? command_buffers.size() : 1);
+            }
         }
     );
 }
@@ -75,6 +102,57 @@ static void print_info()
     fmt::print("GL_MAX_UNIFORM_LOCATIONS: {}\n", max_uniform_locations);
 
     fmt::print("Press spacebar to toggle filled and wireframe mode.\n");
+    fmt::print("Press T to toggle recording the draws on one or all threads.\n");
+}
+
+/**
+ * Records the model-view matrix and the draw of the shapes from `begin` up to
+ * `end`. The shapes fill a grid that keeps the layout of the first 12 when
+ * there are no more.
+ */
+static void record_shapes(CommandBuffer& buffer, const glm::mat4& view_matrix, int begin, int end)
+{
+    const int cols = static_cast<int>(std::ceil(std::sqrt(num_shapes * 4.0f / 3.0f)));
+    const int rows = (num_shapes + cols - 1) / cols;
+    const float cell = 2.4f / cols;
+
+    reset_command_buffer(buffer);
+    for (int n{begin}; n < end; n++) {
+        const int polygon = n % 12;
+        const float tx = n % cols * cell - (cols - 1) * cell / 2;
+        const float ty = -(n / cols) * cell + (rows - 1) * cell / 2;
+        glm::mat4 model_matrix{1.0f};
+        model_matrix = glm::translate(model_matrix, glm::vec3{tx, ty, 0.0f});
+        if (polygon % 2) {
+            const float rotation = glm::pi<float>() / (polygon+3);
+            model_matrix = glm::rotate(model_matrix, rotation, glm::vec3{0.0f, 0.0f, 1.0f});
+        }
+        const float scale = 0.25f * cell / 0.6f;
+        model_matrix = glm::scale(model_matrix, glm::vec3{scale, scale, 1.0f});
+
+        record_uniform(buffer, 0, view_matrix * model_matrix);
+        record_draw_arrays(buffer, GL_TRIANGLES, first[n], count[n]);
+    }
+}
+
+// Prints how long recording and replaying took, averaged over a second
+static void print_stats(double current_time, double record_time, double replay_time)
+{
+    static double last_time{}, total_record{}, total_replay{};
+    static int frames{};
+    total_record += record_time;
+    total_replay += replay_time;
+    frames++;
+    if (current_time - last_time < 1.0) {
+        return;
+    }
+
+    fmt::print("shapes: {}, threads: {}, record: {:.2f} ms, replay: {:.2f} ms\n",
+        num_shapes, multithreaded ? command_buffers.size() : 1,
+        1000.0 * total_record / frames, 1000.0 * total_replay / frames);
+    last_time = current_time;
+    total_record = total_replay = 0.0;
+    frames = 0;
 }
 
 static void render(GLFWwindow* window, double current_time)
@@ -101,68 +179,81 @@ static void render(GLFWwindow* window, double current_time)
     // Set the color of our polygons to gold
     glUniform3f(2, 0.82f, 0.65f, 0.17f);
 
-    // Draw polygons
-    for (int n{}; n < 12; n++) {
-        const float tx = n % 4 * 0.6f - 0.9f;
-        const float ty = -n / 4 * 0.6f + 0.6f;
-        glm::mat4 model_matrix{1.0f};
-        model_matrix = glm::translate(model_matrix, glm::vec3{tx, ty, 0.0f});
-        if (n % 2) {
-            const float rotation = glm::pi<float>() / (n+3);
-            model_matrix = glm::rotate(model_matrix, rotation, glm::vec3{0.0f, 0.0f, 1.0f});
-        }
-        model_matrix = glm::scale(model_matrix, glm::vec3{0.25f, 0.25f, 1.0f});
-
-        const glm::mat4 mv_matrix = view_matrix * model_matrix;
-        glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(mv_matrix));
+    // Let the GPU wait for the chunks uploaded since the last frame, and
+    // attach the vertex buffer again so that this context sees their data
+    sync_uploads(uploads);
+    const int ready_before = ready_chunks;
+    const int queued = queued_chunks.load(std::memory_order_acquire);
+    while (ready_chunks < queued && upload_visible(uploads, chunk_tickets[ready_chunks])) {
+        ready_chunks++;
+    }
+    if (ready_chunks != ready_before) {
+        glVertexArrayVertexBuffer(vao, 0, vbo, 0, sizeof(glm::vec2));
+    }
+    const int ready_shapes = std::min(ready_chunks * SHAPES_PER_CHUNK, num_shapes);
+
+    // Record the draws of contiguous ranges of shapes on the workers,
+    // then replay them in order here, where the context is current
+    const double record_start = glfwGetTime();
+    const int num_threads = multithreaded ? static_cast<int>(command_buffers.size()) : 1;
+    parallel_for(jobs, num_threads, 1,
+        [num_threads, ready_shapes, &view_matrix](size_t begin, size_t end) {
+            for (size_t i{begin}; i < end; i++) {
+                const int t = static_cast<int>(i);
+                record_shapes(command_buffers[t], view_matrix,
+                    ready_shapes * t / num_threads, ready_shapes * (t+1) / num_threads);
+            }
+        });
 
-        glDrawArrays(GL_TRIANGLES, first[n], count[n]);
+    const double replay_start = glfwGetTime();
+    for (int i{}; i < num_threads; i++) {
+        replay_command_buffer(command_buffers[i]);
     }
+    print_stats(current_time, replay_start - record_start, glfwGetTime() - replay_start);
 }
 
 /**
  * Generates a pie.
+ * `out` specifies where to write the vertices.
  * `x` specifies the x coordinate of the center of the pie.
  * `y` specifies the y coordinate of the center of the pie.
  * `radius` specifies the radius of the pie.
  * `start` specifies the starting angle in radians.
  * `end` specifies the ending angle in radians.
  * `triangles` specifies the number of triangles that make up the pie. Must be >= 1.
- * Returns a vector of 2d vertices. The number of vertices returned is `triangles` * 3.
+ * Writes `triangles` * 3 2d vertices and returns the end of them.
  */
-static std::vector<glm::vec2> gen_pie(
-    float x, float y, float radius, float start, float end, int triangles)
+static glm::vec2* gen_pie(
+    glm::vec2* out, float x, float y, float radius, float start, float end, int triangles)
 {
     const float angle = (end - start) / triangles;
 
-    std::vector<glm::vec2> vertices;
-    vertices.reserve(triangles * 3);
-
     for (int i{}; i < triangles; i++) {
-        vertices.emplace_back(glm::vec2{x, y}); // center vertex
-        vertices.emplace_back(glm::vec2{
+        *out++ = glm::vec2{x, y}; // center vertex
+        *out++ = glm::vec2{
             x + radius * std::cos(i * angle + start),
             y + radius * std::sin(i * angle + start)
-        });
-        vertices.emplace_back(glm::vec2{
+        };
+        *out++ = glm::vec2{
             x + radius * std::cos((i+1) * angle + start),
             y + radius * std::sin((i+1) * angle + start)
-        });
+        };
     }
 
-    return vertices;
+    return out;
 }
 
 /**
  * Generates a rectangle that lies on the external side of a regular polygon.
+ * `out` specifies where to write the vertices.
  * `n` specifies the number of sides of the regular polygon. Must be >=3.
  * `ri` specifies the circumradius of the regular polygon.
  * `rc` specifies the radius of the corners.
  * `angle` specifies the rotation angle in radians.
  *     For the bottom rectangle, the angle is zero.
- * Returns a vector of six 2d vertices.
+ * Writes six 2d vertices and returns the end of them.
  */
-static std::vector<glm::vec2> gen_rect(int n, float ri, float rc, float angle)
+static glm::vec2* gen_rect(glm::vec2* out, int n, float ri, float rc, float angle)
 {
     // Find the side length and apothem of a regular polygon.
     // https://en.wikipedia.org/wiki/Regular_polygon#Circumradius
@@ -178,50 +269,52 @@ static std::vector<glm::vec2> gen_rect(int n, float ri, float rc, float angle)
     tm = glm::rotate(tm, angle, glm::vec3{0.0, 0.0f, 1.0f});
     tm = glm::translate(tm, glm::vec3{0.0f, -(apothem + rc / 2), 0.0f});
 
-    // Return vertices of rectangle
-    return {
-        tm * glm::vec4{-w, +h, 0.0f, 1.0f}, // top left vertex
-        tm * glm::vec4{-w, -h, 0.0f, 1.0f}, // bottom left vertex
-        tm * glm::vec4{+w, -h, 0.0f, 1.0f}, // bottom right vertex
-        tm * glm::vec4{-w, +h, 0.0f, 1.0f}, // top left vertex
-        tm * glm::vec4{+w, -h, 0.0f, 1.0f}, // bottom right vertex
-        tm * glm::vec4{+w, +h, 0.0f, 1.0f}, // top right vertex
-    };
+    // Write vertices of rectangle
+    *out++ = tm * glm::vec4{-w, +h, 0.0f, 1.0f}; // top left vertex
+    *out++ = tm * glm::vec4{-w, -h, 0.0f, 1.0f}; // bottom left vertex
+    *out++ = tm * glm::vec4{+w, -h, 0.0f, 1.0f}; // bottom right vertex
+    *out++ = tm * glm::vec4{-w, +h, 0.0f, 1.0f}; // top left vertex
+    *out++ = tm * glm::vec4{+w, -h, 0.0f, 1.0f}; // bottom right vertex
+    *out++ = tm * glm::vec4{+w, +h, 0.0f, 1.0f}; // top right vertex
+    return out;
+}
+
+// Returns the number of vertices that gen_polygon() writes for `n` sides
+static GLint polygon_size(int n)
+{
+    return 3*n + 6*n + 8*3*n;
 }
 
 /**
  * Generates a rounded polygon centered at the origin.
+ * `out` specifies where to write the polygon_size(`n`) vertices.
  * `n` specifies the number of sides of the regular polygon. Must be >=3.
  * `ri` specifies the circumradius of the regular polygon.
  * `rc` specifies the radius of the corners.
  */
-static std::vector<glm::vec2> gen_polygon(int n, float ri, float rc)
+static void gen_polygon(glm::vec2* out, int n, float ri, float rc)
 {
     const float first = glm::radians(n % 2 ? 90.0f : 90.0f - 180.0f / n);
     const float angle = glm::two_pi<float>() / n;
 
-    std::vector<glm::vec2> vertices;
-    vertices.reserve(3*n + 6*n + 8*3*n);
-
     // Regular polygon
     for (int i{}; i < n; i++) {
-        vertices.emplace_back(glm::vec2{}); // origin
+        *out++ = glm::vec2{}; // origin
 
         float x{}, y{};
 
         x = ri * std::cos(i * angle + first);
         y = ri * std::sin(i * angle + first);
-        vertices.emplace_back(glm::vec2{x, y});
+        *out++ = glm::vec2{x, y};
 
         x = ri * std::cos((i+1) * angle + first);
         y = ri * std::sin((i+1) * angle + first);
-        vertices.emplace_back(glm::vec2{x, y});
+        *out++ = glm::vec2{x, y};
     }
 
     // Rectangles
     for (int i{}; i < n; i++) {
-        const auto v = gen_rect(n, ri, rc, i * angle);
-        vertices.insert(vertices.end(), v.begin(), v.end());
+        out = gen_rect(out, n, ri, rc, i * angle);
     }
 
     // Pies (rounded corners)
@@ -229,29 +322,60 @@ static std::vector<glm::vec2> gen_polygon(int n, float ri, float rc)
         const float a = i * angle + first;
         const float x = ri * std::cos(a);
         const float y = ri * std::sin(a);
-        const auto v = gen_pie(x, y, rc, a - angle/2, a + angle/2, 8);
-        vertices.insert(vertices.end(), v.begin(), v.end());
+        out = gen_pie(out, x, y, rc, a - angle/2, a + angle/2, 8);
     }
-
-    return vertices;
 }
 
+/**
+ * Generates one rounded polygon per shape, cycling through 3 to 14 sides.
+ * Shapes after the first 12 get corner radii of their own, so that every
+ * shape has its own geometry. A first task lays out the shapes in `all`,
+ * then the shapes are generated in parallel into their ranges.
+ */
 static void gen_polygons()
 {
-    GLint sum{};
-
-    for (int n{3}; n <= 14; n++) {
-        const auto v = gen_polygon(n, 0.8f, 0.2f);
-        all.insert(all.end(), v.begin(), v.end());
+    const auto sides = [](int shape) { return 3 + shape % 12; };
+    const auto corner_radius = [](int shape) {
+        return shape < 12 ? 0.2f : 0.1f + 0.1f * glm::fract(0.618034f * shape);
+    };
 
-        count.emplace_back(v.size());
-        first.emplace_back(sum);
-        sum += v.size();
-    }
+    TaskGraph graph;
+    const size_t layout = add_task(graph,
+        [&sides] {
+            count.resize(num_shapes);
+            first.resize(num_shapes);
+            GLint sum{};
+            for (int shape{}; shape < num_shapes; shape++) {
+                count[shape] = polygon_size(sides(shape));
+                first[shape] = sum;
+                sum += count[shape];
+            }
+            all.resize(sum);
+        });
+    const size_t generate = add_task(graph,
+        [&sides, &corner_radius] {
+            parallel_for(jobs, num_shapes, 64,
+                [&sides, &corner_radius](size_t begin, size_t end) {
+                    for (size_t shape{begin}; shape < end; shape++) {
+                        const int n = static_cast<int>(shape);
+                        gen_polygon(&all[first[n]], sides(n), 0.8f, corner_radius(n));
+                    }
+                });
+        });
+    add_dependency(graph, layout, generate);
+    run_task_graph(jobs, graph);
 }
 
-int main()
+int main(int argc, char* argv[])
 {
+    // The number of shapes, e.g. 50000 for a scene where recording the
+    // draws takes longer than a frame on one core
+    if (argc > 1) {
+        num_shapes = std::max(std::atoi(argv[1]), 1);
+    }
+    create_job_system(jobs);
+    command_buffers.resize(num_workers(jobs));
+
     glfwSetErrorCallback(
         [](int error, const char* description) {
             fmt::print(stderr, "ERROR: {}\n",  description);
@@ -276,6 +400,7 @@ int main()
 
     glfwMakeContextCurrent(window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    start_gl_trace(); // to the file named by GLTRACE, if set
     glfwSwapInterval(1); // vsync on
 
     print_info();
@@ -285,16 +410,36 @@ int main()
     glUseProgram(program);
 
     // Generate the vertices of our rounded polygons
+    reset_job_stats(jobs);
     gen_polygons();
+    fmt::print("Generated {} shapes, {} vertices\n", num_shapes, all.size());
+    print_job_stats(jobs);
 
-    // Create and populate interleaved vertex buffer using
-    // DSA (Direct State Access) API in OpenGL 4.5.
-    GLuint vbo{};
+    // Create the vertex buffer using DSA (Direct State Access) API in
+    // OpenGL 4.5. The upload thread fills it, so the first frame does
+    // not wait for the vertices of every shape.
     glCreateBuffers(1, &vbo);
-    glNamedBufferStorage(vbo, sizeof(glm::vec2) * all.size(), all.data(), 0);
+    glNamedBufferStorage(vbo, sizeof(glm::vec2) * all.size(), nullptr, 0);
+
+    // Copy the vertices chunk by chunk through the staging memory of the
+    // upload service, from a thread that never touches GL
+    create_upload_service(uploads, window);
+    const int num_chunks = (num_shapes + SHAPES_PER_CHUNK - 1) / SHAPES_PER_CHUNK;
+    chunk_tickets.resize(num_chunks);
+    std::thread loader{
+        [num_chunks] {
+            for (int c{}; c < num_chunks && !quitting; c++) {
+                const int begin = c * SHAPES_PER_CHUNK;
+                const int end = std::min(begin + SHAPES_PER_CHUNK, num_shapes);
+                const GLint size = first[end-1] + count[end-1] - first[begin];
+                chunk_tickets[c] = upload_buffer_data(uploads, vbo,
+                    first[begin] * sizeof(glm::vec2), &all[first[begin]], size * sizeof(glm::vec2));
+                queued_chunks.store(c + 1, std::memory_order_release);
+            }
+        }
+    };
 
     // Create VAO
-    GLuint vao{};
     glCreateVertexArrays(1, &vao);
 
     // Bind the vertex buffer to the VAO's vertex buffer binding point
@@ -321,14 +466,20 @@ int main()
     while (!glfwWindowShouldClose(window)) {
         render(window, glfwGetTime());
         glfwSwapBuffers(window);
+        trace_frame();
         glfwPollEvents();
     }
 
     // Shutting down from here onwards
+    quitting = true;
+    loader.join();
+    delete_upload_service(uploads);
     glDeleteVertexArrays(1, &vao);
     glDeleteBuffers(1, &vbo);
     glDeleteProgram(program);
+    delete_job_system(jobs);
 
+    stop_gl_trace();
     glfwDestroyWindow(window);
     glfwTerminate();
 
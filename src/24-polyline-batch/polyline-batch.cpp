@@ -0,0 +1,197 @@
+#include "glad.h"
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fmt/core.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iterator>
+#include <vector>
+#include "gltrace.h"
+#include "polyline.h"
+#include "shader.h"
+#include "utils.h"
+
+// Global variables
+static GLuint program{};
+static GLuint transform_program{};
+static glm::mat4 proj_matrix{};
+static glm::vec2 resolution{};
+
+static void set_viewport(GLFWwindow* window)
+{
+    int width{}, height{};
+    glfwGetFramebufferSize(window, &width, &height);
+    glViewport(0, 0, width, height);
+
+    const float w = width, h = height;
+    const float aspect = w / h;
+    proj_matrix = glm::ortho(-aspect, aspect, -1.0f, 1.0f, -10.0f, 10.0f);
+    resolution = glm::vec2{w, h};
+}
+
+static void set_callbacks(GLFWwindow* window)
+{
+    glfwSetFramebufferSizeCallback(
+        window,
+        [](GLFWwindow* window, int width, int height) {
+            set_viewport(window);
+        }
+    );
+    glfwSetKeyCallback(
+        window,
+        [](GLFWwindow* window, int key, int scancode, int action, int mods) {
+            if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
+                glfwSetWindowShouldClose(window, GLFW_TRUE);
+            }
+            else if (key == GLFW_KEY_F5 && action == GLFW_PRESS) {
+                // Press F5 to reload shaders
+                glDeleteProgram(program);
+                glDeleteProgram(transform_program);
+                program = create_polyline_batch_program();
+                transform_program = create_polyline_transform_program();
+            }
+        }
+    );
+}
+
+static void print_info(const PolylineBatch& batch)
+{
+    fmt::print("GLFW version: {}\n", glfwGetVersionString());
+    fmt::print("GL_VENDOR: {}\n", glGetString(GL_VENDOR));
+    fmt::print("GL_RENDERER: {}\n", glGetString(GL_RENDERER));
+    fmt::print("GL_VERSION: {}\n", glGetString(GL_VERSION));
+    fmt::print("GL_SHADING_LANGUAGE_VERSION: {}\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
+
+    fmt::print("Polylines: {}, points: {}, segments: {}, draw calls: 1\n",
+        batch.descs.size(), batch.points.size(), batch.num_segments);
+    fmt::print("Usage: 24-polyline-batch [number of polylines]\n");
+}
+
+/**
+ * Generates `count` chart lines and closed outlines into `batch`.
+ * Even polylines are open sine-like series, odd ones closed regular polygons.
+ */
+static void gen_polylines(PolylineBatch& batch, int count)
+{
+    // Selected CSS colors - https://www.w3schools.com/cssref/css_colors.php
+    const glm::vec4 colors[]{
+        {1.0f, 0.0f, 0.0f, 1.0f},                   // red
+        {0.0f, 1.0f, 0.0f, 1.0f},                   // green
+        {100.0f/255, 149.0f/255, 237.0f/255, 1.0f}, // cornflower blue
+        {1.0f, 215.0f/255, 0.0f, 1.0f},             // gold
+        {1.0f, 105.0f/255, 180.0f/255, 1.0f},       // hot pink
+        {1.0f, 1.0f, 1.0f, 1.0f},                   // white
+    };
+
+    std::vector<glm::vec4> points;
+    for (int k{}; k < count; k++) {
+        const glm::vec4& color = colors[k % std::size(colors)];
+        const float t = static_cast<float>(k) / count;
+        points.clear();
+
+        if (k % 2 == 0) {
+            // Chart line with 200 samples
+            const float phase = t * glm::two_pi<float>() * 7.0f;
+            const float y0 = 1.8f * t - 0.9f;
+            for (int i{}; i < 200; i++) {
+                const float x = i / 199.0f * 2.6f - 1.3f;
+                const float y = y0 + 0.05f * std::sin(x * 6.0f + phase);
+                points.emplace_back(glm::vec4{x, y, 0.0f, 1.0f});
+            }
+            add_polyline(batch, points, color, 1.0f + k % 3, false);
+        }
+        else {
+            // Outline of a regular polygon with 3 to 10 sides
+            const int sides = 3 + k % 8;
+            const glm::vec2 center{
+                1.2f * std::cos(t * 97.0f), 0.8f * std::sin(t * 61.0f)};
+            const float radius = 0.03f + 0.02f * (k % 5);
+            for (int i{}; i < sides; i++) {
+                const float a = glm::two_pi<float>() * i / sides;
+                points.emplace_back(glm::vec4{
+                    center.x + radius * std::cos(a),
+                    center.y + radius * std::sin(a), 0.0f, 1.0f});
+            }
+            add_polyline(batch, points, color, 2.0f, true);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int count = argc > 1 ? std::atoi(argv[1]) : 1000;
+
+    glfwSetErrorCallback(
+        [](int error, const char* description) {
+            fmt::print(stderr, "ERROR: {}\n",  description);
+        }
+    );
+
+    if (!glfwInit()) {
+        exit(EXIT_FAILURE);
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    GLFWwindow* window = glfwCreateWindow(800, 600, "24-polyline-batch", nullptr, nullptr);
+    if (!window) {
+        glfwTerminate();
+        exit(EXIT_FAILURE);
+    }
+
+    glfwMakeContextCurrent(window);
+    gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    start_gl_trace(); // to the file named by GLTRACE, if set
+    glfwSwapInterval(1); // vsync on
+
+    set_callbacks(window);
+
+    program = create_polyline_batch_program();
+    transform_program = create_polyline_transform_program();
+
+    // Pack all polylines into one batch
+    PolylineBatch batch;
+    gen_polylines(batch, count);
+    upload_polyline_batch(batch);
+    print_info(batch);
+
+    GLuint vao{};
+    glCreateVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+
+    set_viewport(window);
+    while (!glfwWindowShouldClose(window)) {
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        const float tf = static_cast<float>(glfwGetTime());
+        glm::mat4 mv_matrix{1.0f};
+        mv_matrix = glm::scale(mv_matrix, glm::vec3{1.0f + 0.1f * std::sin(tf), 1.0f, 1.0f});
+        const glm::mat4 mvp_matrix = proj_matrix * mv_matrix;
+
+        draw_polyline_batch(batch, transform_program, program, mvp_matrix, resolution);
+
+        glfwSwapBuffers(window);
+        trace_frame();
+        glfwPollEvents();
+    }
+
+    // Shutting down from here onwards
+    glDeleteVertexArrays(1, &vao);
+    delete_polyline_batch(batch);
+    glDeleteProgram(transform_program);
+    glDeleteProgram(program);
+
+    stop_gl_trace();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+
+    fmt::print("Bye.\n");
+    return 0;
+}
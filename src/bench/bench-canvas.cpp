@@ -0,0 +1,117 @@
+#include "glad.h"
+#include <cstdlib>
+#include <fmt/core.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "canvas.h"
+
+// Compares drawing every shape of a canvas as soon as it is appended, as the
+// 2D demos did with a draw call per piece, against batching all of them into
+// as few draws as the stream regions allow, for [shapes] mixed shapes.
+// Usage: bench-canvas [shapes] [frames]
+
+// What to draw, generated once so that both runs append the same shapes
+struct Shape {
+    int kind{};
+    glm::vec2 position{};
+    float size{};
+    glm::vec4 color{};
+};
+
+static std::vector<Shape> gen_shapes(int n, glm::vec2 viewport)
+{
+    std::mt19937 rng{42};
+    std::uniform_real_distribution<float> x{0.0f, viewport.x};
+    std::uniform_real_distribution<float> y{0.0f, viewport.y};
+    std::exponential_distribution<float> size{0.1f};
+    std::uniform_real_distribution<float> channel{0.2f, 1.0f};
+
+    std::vector<Shape> shapes(n);
+    for (int i{}; i < n; i++) {
+        shapes[i].kind = i % 6;
+        shapes[i].position = glm::vec2{x(rng), y(rng)};
+        shapes[i].size = 2.0f + size(rng);
+        shapes[i].color = glm::vec4{channel(rng), channel(rng), channel(rng), 1.0f};
+    }
+    return shapes;
+}
+
+static void append_shape(Canvas2D& canvas, const Shape& shape)
+{
+    const glm::vec2 p = shape.position;
+    const float r = shape.size;
+    switch (shape.kind) {
+    case 0:
+        fill_circle(canvas, p, r, shape.color);
+        break;
+    case 1:
+        fill_rounded_rect(canvas, p, glm::vec2{2.0f * r, r}, r / 4.0f, shape.color);
+        break;
+    case 2:
+        fill_polygon(canvas, {p, p + glm::vec2{r, 0.0f}, p + glm::vec2{r, r}, p + glm::vec2{0.0f, r}}, shape.color);
+        break;
+    case 3:
+        stroke_polyline(canvas, {p, p + glm::vec2{r, 0.0f}, p + glm::vec2{r, r}, p + glm::vec2{0.0f, 2.0f * r}},
+            2.0f, shape.color);
+        break;
+    case 4:
+        fill_ring(canvas, p, r / 2.0f, r, shape.color);
+        break;
+    default:
+        fill_pie(canvas, p, r, 30.0f, 300.0f, shape.color);
+        break;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int num_shapes = argc > 1 ? std::atoi(argv[1]) : 50'000;
+    const int frames = argc > 2 ? std::atoi(argv[2]) : 100;
+    const int width{1920}, height{1080};
+
+    GLFWwindow* window = create_bench_window("bench-canvas", width, height);
+
+    // Canvas units are pixels, with the origin at the bottom left
+    const glm::vec2 viewport{width, height};
+    const glm::mat4 transform = glm::ortho(0.0f, viewport.x, 0.0f, viewport.y, -1.0f, 1.0f);
+    const std::vector<Shape> shapes = gen_shapes(num_shapes, viewport);
+
+    Canvas2D canvas;
+    create_canvas(canvas);
+
+    print_bench_header();
+
+    const BenchResult separate = run_bench(frames, [&]() {
+        glClear(GL_COLOR_BUFFER_BIT);
+        begin_canvas(canvas, transform, viewport);
+        for (const Shape& shape : shapes) {
+            append_shape(canvas, shape);
+            flush_canvas(canvas);
+        }
+        end_canvas(canvas);
+    });
+    print_bench_result("canvas: draw per shape", num_shapes, separate);
+    const long long separate_draws = canvas.draws;
+
+    const BenchResult batched = run_bench(frames, [&]() {
+        glClear(GL_COLOR_BUFFER_BIT);
+        begin_canvas(canvas, transform, viewport);
+        for (const Shape& shape : shapes) {
+            append_shape(canvas, shape);
+        }
+        end_canvas(canvas);
+    });
+    print_bench_result("canvas: batched", num_shapes, batched);
+
+    fmt::print("draw calls per frame: {} per shape, {} batched\n", separate_draws, canvas.draws);
+    fmt::print("waits for a region: {}\n", canvas.waits);
+    fmt::print("speedup (cpu): {:.2f}x\n", separate.cpu_ms / batched.cpu_ms);
+
+    delete_canvas(canvas);
+    destroy_bench_window(window);
+    return 0;
+}
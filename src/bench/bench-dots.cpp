@@ -0,0 +1,68 @@
+#include "glad.h"
+#include <cstdlib>
+#include <fmt/core.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "dots.h"
+
+// Compares drawing every dot with a 30-segment fan against the compute cull
+// pass of shader/dots-cull.comp, which drops off-screen and sub-pixel dots and
+// picks a fan LOD per dot, for 1k dots up to [max_dots] in steps of 10x.
+// Usage: bench-dots [max_dots] [frames]
+
+// `n` dots scattered over twice the visible area, from sub-pixel to large
+static std::vector<Dot> gen_dots(int n)
+{
+    std::mt19937 rng{42};
+    std::uniform_real_distribution<float> uniform{-2.0f, 2.0f};
+    std::exponential_distribution<float> size{200.0f};
+
+    std::vector<Dot> dots(n);
+    for (Dot& dot : dots) {
+        dot.position = glm::vec2{uniform(rng), uniform(rng)};
+        dot.radius = size(rng);
+        dot.color = pack_color(glm::vec4{1.0f});
+    }
+    return dots;
+}
+
+int main(int argc, char* argv[])
+{
+    const int max_dots = argc > 1 ? std::atoi(argv[1]) : 10'000'000;
+    const int frames = argc > 2 ? std::atoi(argv[2]) : 100;
+    const int width{1920}, height{1080};
+
+    GLFWwindow* window = create_bench_window("bench-dots", width, height);
+
+    const float aspect = static_cast<float>(width) / static_cast<float>(height);
+    const glm::mat4 mvp_matrix = glm::ortho(-aspect, aspect, -1.0f, 1.0f, -10.0f, 10.0f);
+    const glm::vec2 resolution{width, height};
+
+    print_bench_header();
+
+    for (int n{1000}; n <= max_dots; n *= 10) {
+        DotRenderer renderer{};
+        create_dot_renderer(renderer, gen_dots(n));
+
+        const BenchResult all = run_bench(frames, [&]() {
+            glClear(GL_COLOR_BUFFER_BIT);
+            draw_dots_unculled(renderer, mvp_matrix);
+        });
+        print_bench_result("dots: draw all", renderer.num_dots, all);
+
+        const BenchResult culled = run_bench(frames, [&]() {
+            glClear(GL_COLOR_BUFFER_BIT);
+            draw_dots(renderer, mvp_matrix, resolution);
+        });
+        print_bench_result("dots: cull + LOD", renderer.num_dots, culled);
+
+        delete_dot_renderer(renderer);
+    }
+
+    destroy_bench_window(window);
+    return 0;
+}
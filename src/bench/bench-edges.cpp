@@ -0,0 +1,100 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fmt/core.h>
+#include <glm/glm.hpp>
+#include <random>
+#include <vector>
+#include "edges.h"
+
+// Measures the triangles tested per second by each kernel of edges.h that
+// the CPU supports. "scan" tests points against every triangle, as a lasso
+// or selection rectangle does, with points outside all of them so that none
+// stops early. "candidates" tests points against 64 triangles picked at
+// random, as the leaves a spatial index finds. "hits" tests random points
+// and counts those inside a triangle, which should match between kernels
+// but for points within rounding of an edge.
+// Usage: bench-edges [triangles] [points]
+
+template <typename F>
+static double seconds(F f)
+{
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+static void print_rate(const char* kernel, const char* name, long long tests, double seconds)
+{
+    fmt::print("{:<8} {:<12} {:>14.3e} {:>12.3f}\n", kernel, name, tests / seconds, 1e9 * seconds / tests);
+}
+
+int main(int argc, char* argv[])
+{
+    const int num_triangles = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 4096;
+    const int num_points = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 100'000;
+
+    // Small triangles scattered over [-1, 1]^2, in both winding orders
+    std::mt19937 rng{42};
+    std::uniform_real_distribution<float> position{-1.0f, 1.0f};
+    const float size = 2.0f / std::sqrt(static_cast<float>(num_triangles));
+    std::uniform_real_distribution<float> offset{-size, size};
+    EdgeTriangles triangles;
+    for (int i{}; i < num_triangles; i++) {
+        const glm::vec2 center{position(rng), position(rng)};
+        glm::vec2 vertices[3];
+        for (glm::vec2& v : vertices) {
+            v = center + glm::vec2{offset(rng), offset(rng)};
+        }
+        add_edge_triangle(triangles, vertices);
+    }
+
+    std::vector<glm::vec2> outside(num_points);
+    std::vector<glm::vec2> inside(num_points);
+    for (int i{}; i < num_points; i++) {
+        outside[i] = glm::vec2{position(rng) + 4.0f, position(rng)};
+        inside[i] = glm::vec2{position(rng), position(rng)};
+    }
+
+    const int num_candidates{64};
+    std::uniform_int_distribution<int> triangle{0, num_triangles - 1};
+    std::vector<int> candidates(num_candidates * 256);
+    for (int& candidate : candidates) {
+        candidate = triangle(rng);
+    }
+
+    fmt::print("{} triangles, {} points\n", num_triangles, num_points);
+    fmt::print("{:<8} {:<12} {:>14} {:>12}\n", "kernel", "benchmark", "triangles/s", "ns/triangle");
+    std::vector<std::uint8_t> selected(num_points);
+    for (const EdgeKernel kernel : {EDGE_SCALAR, EDGE_SSE4, EDGE_AVX2}) {
+        if (!set_edge_kernel(kernel)) {
+            fmt::print("{:<8} not supported by this CPU\n", edge_kernel_name(kernel));
+            continue;
+        }
+        const char* name = edge_kernel_name(kernel);
+
+        const double scan = seconds([&] {
+            points_in_triangles(triangles, outside.data(), num_points, selected.data());
+        });
+        print_rate(name, "scan", static_cast<long long>(num_points) * num_triangles, scan);
+
+        int found{};
+        const double candidate = seconds([&] {
+            for (int i{}; i < num_points; i++) {
+                const int* list = candidates.data() + (i % 256) * num_candidates;
+                found += find_triangle(triangles, list, num_candidates, inside[i]) >= 0;
+            }
+        });
+        print_rate(name, "candidates", static_cast<long long>(num_points) * num_candidates, candidate);
+
+        points_in_triangles(triangles, inside.data(), num_points, selected.data());
+        int hits{};
+        for (const std::uint8_t s : selected) {
+            hits += s;
+        }
+        fmt::print("{:<8} {:<12} {:>14} {:>12}\n", name, "hits", hits, found);
+    }
+
+    return 0;
+}
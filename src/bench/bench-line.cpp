@@ -0,0 +1,103 @@
+#include "glad.h"
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fmt/core.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <vector>
+#include "bench.h"
+#include "polyline.h"
+#include "shader.h"
+#include "utils.h"
+
+// Compares the polyline extrusion of shader/line-direct.vert, which transforms
+// 4 points in every vertex invocation, against the transform pre-pass of
+// shader/polyline-transform.comp followed by shader/line.vert.
+// Usage: bench-line [points] [frames]
+
+static GLuint create_program(const char* vert)
+{
+    namespace fs = std::filesystem;
+    return compile_shaders({
+        fs::canonical(dirname() / ".." / "shader" / vert).c_str(),
+        fs::canonical(dirname() / ".." / "shader" / "line.frag").c_str(),
+    });
+}
+
+// A sine wave across the viewport, with `n` points
+static std::vector<glm::vec4> gen_wave(int n)
+{
+    std::vector<glm::vec4> vertices;
+    vertices.reserve(n);
+    for (int i{}; i < n; i++) {
+        const float x = 2.0f * i / (n - 1) - 1.0f;
+        vertices.emplace_back(glm::vec4{x, 0.8f * std::sin(x * 50.0f), 0.0f, 1.0f});
+    }
+    return vertices;
+}
+
+int main(int argc, char* argv[])
+{
+    const int num_points = argc > 1 ? std::atoi(argv[1]) : 1'000'000;
+    const int frames = argc > 2 ? std::atoi(argv[2]) : 100;
+    const int width{1920}, height{1080};
+
+    GLFWwindow* window = create_bench_window("bench-line", width, height);
+
+    const GLuint direct_program = create_program("line-direct.vert");
+    const GLuint pulled_program = create_program("line.vert");
+    const GLuint transform_program = create_polyline_transform_program();
+
+    const std::vector<glm::vec4> varray = gen_wave(num_points);
+    GLuint ssbo[2]{};
+    glCreateBuffers(2, ssbo);
+    glNamedBufferStorage(ssbo[0], varray.size()*sizeof(*varray.data()), varray.data(), 0);
+    glNamedBufferStorage(ssbo[1], varray.size()*sizeof(*varray.data()), nullptr, 0);
+
+    GLuint vao{};
+    glCreateVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    const glm::mat4 mvp_matrix = glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, -10.0f, 10.0f);
+    const glm::vec2 resolution{width, height};
+    const GLsizei vertices = 6 * (num_points - 3);
+
+    for (GLuint program : {direct_program, pulled_program}) {
+        glProgramUniform2f(program, glGetUniformLocation(program, "u_resolution"), resolution.x, resolution.y);
+        glProgramUniform1f(program, glGetUniformLocation(program, "u_thickness"), 2.0f);
+    }
+    glProgramUniformMatrix4fv(direct_program, glGetUniformLocation(direct_program, "u_mvp"),
+        1, GL_FALSE, glm::value_ptr(mvp_matrix));
+
+    print_bench_header();
+
+    const BenchResult direct = run_bench(frames, [&]() {
+        glClear(GL_COLOR_BUFFER_BIT);
+        glUseProgram(direct_program);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ssbo[0]);
+        glDrawArrays(GL_TRIANGLES, 0, vertices);
+    });
+    print_bench_result("line: transform per vertex", num_points, direct);
+
+    const BenchResult pulled = run_bench(frames, [&]() {
+        glClear(GL_COLOR_BUFFER_BIT);
+        transform_polyline(transform_program, ssbo[0], ssbo[1], num_points, mvp_matrix, resolution);
+        glUseProgram(pulled_program);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, ssbo[1]);
+        glDrawArrays(GL_TRIANGLES, 0, vertices);
+    });
+    print_bench_result("line: transform pre-pass", num_points, pulled);
+
+    fmt::print("speedup (gpu): {:.2f}x\n", direct.gpu_ms / pulled.gpu_ms);
+
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(2, ssbo);
+    glDeleteProgram(transform_program);
+    glDeleteProgram(pulled_program);
+    glDeleteProgram(direct_program);
+    destroy_bench_window(window);
+    return 0;
+}
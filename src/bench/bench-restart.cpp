@@ -0,0 +1,150 @@
+#include "glad.h"
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fmt/core.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <random>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "primitivebatch.h"
+#include "shader.h"
+#include "utils.h"
+
+// Compares submitting [shapes] rounded rectangles of 7 fans each and as many
+// pentagon webs of 10 line loops each with a draw call per part, as the
+// demos did, against one glMultiDrawArrays and one restart-indexed
+// glDrawElements per mode, and prints the draw calls per frame of each.
+// Usage: bench-restart [shapes] [frames]
+
+static GLuint create_program()
+{
+    namespace fs = std::filesystem;
+    return compile_shaders({
+        fs::canonical(dirname() / ".." / "shader" / "mvp-color.vert").c_str(),
+        fs::canonical(dirname() / ".." / "shader" / "basic.frag").c_str(),
+    });
+}
+
+// Appends a part of `points` to `batch`, and its points to `vertices`
+static void add_shape_part(
+    PrimitiveBatch& batch, std::vector<glm::vec2>& vertices, const std::vector<glm::vec2>& points)
+{
+    add_part(batch, static_cast<GLint>(vertices.size()), static_cast<GLsizei>(points.size()));
+    vertices.insert(vertices.end(), points.begin(), points.end());
+}
+
+// A pie of 8 triangles around `center`, from `start` degrees to a quarter turn further
+static std::vector<glm::vec2> gen_corner(glm::vec2 center, float radius, float start)
+{
+    std::vector<glm::vec2> points{center};
+    for (int i{}; i <= 8; i++) {
+        const float angle = glm::radians(start + 90.0f * i / 8);
+        points.emplace_back(center + radius * glm::vec2{std::cos(angle), std::sin(angle)});
+    }
+    return points;
+}
+
+// The rounded rectangle of 14-rounded-rectangle as it was drawn before
+// Canvas2D: three rectangles and four corners, each a fan
+static void add_rounded_rect(
+    PrimitiveBatch& fans, std::vector<glm::vec2>& vertices, glm::vec2 c, float w, float h, float r)
+{
+    add_shape_part(fans, vertices, {c + glm::vec2{+w - r, +h}, c + glm::vec2{-w + r, +h},
+        c + glm::vec2{-w + r, +h - r}, c + glm::vec2{+w - r, +h - r}});
+    add_shape_part(fans, vertices, {c + glm::vec2{+w, +h - r}, c + glm::vec2{-w, +h - r},
+        c + glm::vec2{-w, -h + r}, c + glm::vec2{+w, -h + r}});
+    add_shape_part(fans, vertices, {c + glm::vec2{+w - r, -h + r}, c + glm::vec2{-w + r, -h + r},
+        c + glm::vec2{-w + r, -h}, c + glm::vec2{+w - r, -h}});
+    add_shape_part(fans, vertices, gen_corner(c + glm::vec2{+w - r, +h - r}, r, 0.0f));
+    add_shape_part(fans, vertices, gen_corner(c + glm::vec2{-w + r, +h - r}, r, 90.0f));
+    add_shape_part(fans, vertices, gen_corner(c + glm::vec2{-w + r, -h + r}, r, 180.0f));
+    add_shape_part(fans, vertices, gen_corner(c + glm::vec2{+w - r, -h + r}, r, 270.0f));
+}
+
+// The lines of 10-pentagon-web: five rings and five spokes
+static void add_pentagon_web(PrimitiveBatch& loops, std::vector<glm::vec2>& vertices, glm::vec2 c, float size)
+{
+    const float angles[]{10.0f, 90.0f, 170.0f, 270.0f-35.0f, 270.0f+35.0f};
+    auto corner = [&](float radius, int i) {
+        return c + radius * size * glm::vec2{std::cos(glm::radians(angles[i])), std::sin(glm::radians(angles[i]))};
+    };
+    for (int ring{}; ring < 5; ring++) {
+        std::vector<glm::vec2> points;
+        for (int i{}; i < 5; i++) {
+            points.emplace_back(corner(ring * 0.1f + 0.2f, i));
+        }
+        add_shape_part(loops, vertices, points);
+    }
+    for (int i{}; i < 5; i++) {
+        add_shape_part(loops, vertices, {c, corner(0.6f, i)});
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int num_shapes = argc > 1 ? std::atoi(argv[1]) : 10'000;
+    const int frames = argc > 2 ? std::atoi(argv[2]) : 100;
+    const int width{1920}, height{1080};
+
+    GLFWwindow* window = create_bench_window("bench-restart", width, height);
+
+    std::mt19937 rng{42};
+    std::uniform_real_distribution<float> position{-0.95f, 0.95f};
+    PrimitiveBatch fans{GL_TRIANGLE_FAN};
+    PrimitiveBatch loops{GL_LINE_LOOP};
+    std::vector<glm::vec2> vertices;
+    for (int i{}; i < num_shapes; i++) {
+        add_rounded_rect(fans, vertices, glm::vec2{position(rng), position(rng)}, 0.03f, 0.01f, 0.005f);
+        add_pentagon_web(loops, vertices, glm::vec2{position(rng), position(rng)}, 0.05f);
+    }
+
+    GLuint vbo{};
+    glCreateBuffers(1, &vbo);
+    glNamedBufferStorage(vbo, vertices.size()*sizeof(glm::vec2), vertices.data(), 0);
+    GLuint vao{};
+    glCreateVertexArrays(1, &vao);
+    glVertexArrayVertexBuffer(vao, 0, vbo, 0, sizeof(glm::vec2));
+    glEnableVertexArrayAttrib(vao, 0);
+    glVertexArrayAttribFormat(vao, 0, 2, GL_FLOAT, GL_FALSE, 0);
+    glVertexArrayAttribBinding(vao, 0, 0);
+    const GLuint ibo = upload_primitive_batches(vao, {&fans, &loops});
+    glBindVertexArray(vao);
+
+    const GLuint program = create_program();
+    const glm::mat4 identity_matrix{1.0f};
+    glUseProgram(program);
+    glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(identity_matrix));
+    glUniformMatrix4fv(1, 1, GL_FALSE, glm::value_ptr(identity_matrix));
+
+    print_bench_header();
+
+    int draws[SUBMIT_RESTART + 1]{};
+    BenchResult results[SUBMIT_RESTART + 1];
+    for (const BatchSubmit submit : {SUBMIT_SEPARATE, SUBMIT_MULTI_DRAW, SUBMIT_RESTART}) {
+        results[submit] = run_bench(frames, [&]() {
+            glClear(GL_COLOR_BUFFER_BIT);
+            glUniform3f(2, 0.83f, 0.68f, 0.21f);
+            draws[submit] = draw_primitive_batch(fans, submit);
+            glUniform3f(2, 0.0f, 0.0f, 0.0f);
+            draws[submit] += draw_primitive_batch(loops, submit);
+        });
+        print_bench_result(std::string{"batch: "} + batch_submit_name(submit), num_shapes, results[submit]);
+    }
+
+    fmt::print("draw calls per frame: {} separate, {} multi-draw, {} restart\n",
+        draws[SUBMIT_SEPARATE], draws[SUBMIT_MULTI_DRAW], draws[SUBMIT_RESTART]);
+    fmt::print("speedup (cpu): {:.2f}x multi-draw, {:.2f}x restart\n",
+        results[SUBMIT_SEPARATE].cpu_ms / results[SUBMIT_MULTI_DRAW].cpu_ms,
+        results[SUBMIT_SEPARATE].cpu_ms / results[SUBMIT_RESTART].cpu_ms);
+
+    glDeleteProgram(program);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &ibo);
+    glDeleteBuffers(1, &vbo);
+    destroy_bench_window(window);
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include <chrono>
+#include <cstdlib>
+#include <fmt/core.h>
+#include <glm/glm.hpp>
+#include <random>
+#include <vector>
+#include "spatial.h"
+
+// Measures the insert, update and pick rates of the spatial index for 1k
+// triangles up to [max_shapes] in steps of 10x. Updates either nudge a shape
+// like a drag does, or move it anywhere. Picks are at random points.
+// Usage: bench-spatial [max_shapes] [operations]
+
+struct Triangle {
+    glm::vec2 vertices[3];
+};
+
+// Small triangles of about the size 17-triangle-test gives `n` shapes,
+// scattered over [-1, 1]^2
+static Triangle random_triangle(std::mt19937& rng, float size)
+{
+    std::uniform_real_distribution<float> position{-1.0f, 1.0f};
+    std::uniform_real_distribution<float> offset{-size, size};
+    const glm::vec2 center{position(rng), position(rng)};
+    Triangle t;
+    for (glm::vec2& v : t.vertices) {
+        v = center + glm::vec2{offset(rng), offset(rng)};
+    }
+    return t;
+}
+
+template <typename F>
+static double seconds(F f)
+{
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+static void print_rate(const char* name, long long n, int operations, double seconds)
+{
+    fmt::print("{:<32} {:>12} {:>14.0f} {:>12.3f}\n",
+        name, n, operations / seconds, 1e6 * seconds / operations);
+}
+
+int main(int argc, char* argv[])
+{
+    const int max_shapes = argc > 1 ? std::atoi(argv[1]) : 1'000'000;
+    const int operations = argc > 2 ? std::atoi(argv[2]) : 100'000;
+
+    fmt::print("{:<32} {:>12} {:>14} {:>12}\n", "benchmark", "n", "ops/s", "us/op");
+    for (int n{1000}; n <= max_shapes; n *= 10) {
+        std::mt19937 rng{42};
+        const float size = 1.0f / std::sqrt(static_cast<float>(n));
+        std::vector<Triangle> triangles;
+        for (int i{}; i < n; i++) {
+            triangles.emplace_back(random_triangle(rng, size));
+        }
+
+        SpatialIndex index;
+        const double insert = seconds([&] {
+            for (const Triangle& t : triangles) {
+                insert_shape(index, t.vertices);
+            }
+        });
+        print_rate("spatial: insert", n, n, insert);
+
+        std::uniform_int_distribution<int> pick_shape_id{0, n - 1};
+        std::uniform_real_distribution<float> nudge{-0.01f * size, 0.01f * size};
+        const double drag = seconds([&] {
+            for (int i{}; i < operations; i++) {
+                Triangle& t = triangles[pick_shape_id(rng)];
+                const glm::vec2 delta{nudge(rng), nudge(rng)};
+                for (glm::vec2& v : t.vertices) {
+                    v += delta;
+                }
+                update_shape(index, static_cast<int>(&t - triangles.data()), t.vertices);
+            }
+        });
+        print_rate("spatial: update (drag)", n, operations, drag);
+
+        const double jump = seconds([&] {
+            for (int i{}; i < operations; i++) {
+                const int id = pick_shape_id(rng);
+                triangles[id] = random_triangle(rng, size);
+                update_shape(index, id, triangles[id].vertices);
+            }
+        });
+        print_rate("spatial: update (jump)", n, operations, jump);
+
+        std::uniform_real_distribution<float> position{-1.0f, 1.0f};
+        int hits{};
+        const double pick = seconds([&] {
+            for (int i{}; i < operations; i++) {
+                hits += pick_shape(index, glm::vec2{position(rng), position(rng)}) >= 0;
+            }
+        });
+        print_rate("spatial: pick", n, operations, pick);
+        fmt::print("{:<32} {:>12} {:>14} {:>12}\n", "  tree height, hits", n, spatial_height(index), hits);
+    }
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include "glad.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fmt/core.h>
+#include <GLFW/glfw3.h>
+#include <string_view>
+#include <vector>
+#include "bench.h"
+#include "gltrace.h"
+
+// Replays a GL trace, captured by running a demo with GLTRACE=<file> in the
+// environment, as fast as the driver goes in a hidden window, and prints the
+// CPU time to submit each frame and the GPU time of all of them. The first
+// frame, which creates the objects and compiles the shaders, is timed apart.
+// With --stats it only counts the calls, to compare traces of two builds.
+// Usage: glreplay <trace> [--stats]
+
+static void print_stats(const GlTrace& trace)
+{
+    fmt::print("{:<32} {:>12}\n", "call", "count");
+    for (int call{}; call < gl_trace_call_count(); call++) {
+        if (trace.call_counts[call] > 0) {
+            fmt::print("{:<32} {:>12}\n", gl_trace_call_name(call), trace.call_counts[call]);
+        }
+    }
+    fmt::print("{} frames, {} calls, {} draw calls, {:.1f} MB of data\n",
+        trace.frames, trace.calls, trace.draws, trace.payload_bytes / 1.0e6);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        fmt::print(stderr, "Usage: glreplay <trace> [--stats]\n");
+        return EXIT_FAILURE;
+    }
+    const bool stats_only = argc > 2 && std::string_view{argv[2]} == "--stats";
+
+    GlTrace trace;
+    if (!load_gl_trace(trace, argv[1])) {
+        return EXIT_FAILURE;
+    }
+    if (stats_only) {
+        trace.execute = false;
+        while (replay_gl_frame(trace)) {
+        }
+        print_stats(trace);
+        return EXIT_SUCCESS;
+    }
+
+    GLFWwindow* window = create_bench_window("glreplay", std::max(trace.width, 1), std::max(trace.height, 1));
+    GLint framebuffer{};
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    trace.default_framebuffer = framebuffer;
+
+    using clock = std::chrono::steady_clock;
+    using milliseconds = std::chrono::duration<double, std::milli>;
+
+    // The first frame, then the rest, each submitted as soon as the last one is
+    auto start = clock::now();
+    const bool more = replay_gl_frame(trace);
+    glFinish();
+    const double first_ms = milliseconds(clock::now() - start).count();
+    const long long first_draws = trace.draws;
+
+    GLuint queries[2]{};
+    glCreateQueries(GL_TIMESTAMP, 2, queries);
+    glQueryCounter(queries[0], GL_TIMESTAMP);
+    std::vector<double> frame_ms;
+    start = clock::now();
+    while (more) {
+        const auto frame_start = clock::now();
+        if (!replay_gl_frame(trace)) {
+            break; // the calls after the last frame, deleting objects
+        }
+        frame_ms.push_back(milliseconds(clock::now() - frame_start).count());
+    }
+    glQueryCounter(queries[1], GL_TIMESTAMP);
+    glFinish();
+    const double total_ms = milliseconds(clock::now() - start).count();
+
+    GLuint64 timestamps[2]{};
+    glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &timestamps[0]);
+    glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &timestamps[1]);
+    glDeleteQueries(2, queries);
+
+    const long long frames = frame_ms.size();
+    std::sort(frame_ms.begin(), frame_ms.end());
+    fmt::print("first frame: {:.3f} ms, {} draw calls\n", first_ms, first_draws);
+    if (frames > 0) {
+        fmt::print("{} more frames: {:.1f} draw calls per frame\n",
+            frames, static_cast<double>(trace.draws - first_draws) / frames);
+        fmt::print("cpu ms per frame: {:.3f} min, {:.3f} median, {:.3f} max\n",
+            frame_ms.front(), frame_ms[frames / 2], frame_ms.back());
+        fmt::print("wall ms per frame: {:.3f}, gpu ms per frame: {:.3f}\n",
+            total_ms / frames, (timestamps[1] - timestamps[0]) / 1.0e6 / frames);
+    }
+
+    fmt::print("{} calls, {} draw calls, {:.1f} MB of data in all\n", trace.calls, trace.draws, trace.payload_bytes / 1.0e6);
+
+    destroy_bench_window(window);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+#include "glad.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fmt/core.h>
+#include <functional>
+#include <GLFW/glfw3.h>
+#include <string_view>
+#include "bench.h"
+
+// Offscreen render target, since a hidden window's default framebuffer
+// is not guaranteed to own its pixels
+static GLuint fbo{};
+static GLuint rbo[2]{};
+
+/**
+ * Creates a hidden window with an OpenGL 4.6 core context, vsync off, and
+ * binds a `width` x `height` offscreen framebuffer to draw into.
+ * Exits the process on failure.
+ */
+GLFWwindow* create_bench_window(const char* title, int width, int height)
+{
+    glfwSetErrorCallback(
+        [](int error, const char* description) {
+            fmt::print(stderr, "ERROR: {}\n",  description);
+        }
+    );
+
+    if (!glfwInit()) {
+        exit(EXIT_FAILURE);
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    GLFWwindow* window = glfwCreateWindow(width, height, title, nullptr, nullptr);
+    if (!window) {
+        glfwTerminate();
+        exit(EXIT_FAILURE);
+    }
+
+    glfwMakeContextCurrent(window);
+    gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    glfwSwapInterval(0); // vsync off
+
+    fmt::print("GL_RENDERER: {}\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    fmt::print("GL_VERSION: {}\n", reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+
+    glCreateRenderbuffers(2, rbo);
+    glNamedRenderbufferStorage(rbo[0], GL_RGBA8, width, height);
+    glNamedRenderbufferStorage(rbo[1], GL_DEPTH24_STENCIL8, width, height);
+    glCreateFramebuffers(1, &fbo);
+    glNamedFramebufferRenderbuffer(fbo, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rbo[0]);
+    glNamedFramebufferRenderbuffer(fbo, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo[1]);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, width, height);
+
+    return window;
+}
+
+void destroy_bench_window(GLFWwindow* window)
+{
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(2, rbo);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}
+
+/**
+ * Calls `frame` a few times to warm up, then `frames` times while measuring.
+ * The GPU time comes from a GL_TIME_ELAPSED query that spans all frames,
+ * and both times are averaged per frame.
+ */
+BenchResult run_bench(int frames, const std::function<void()>& frame)
+{
+    using clock = std::chrono::steady_clock;
+
+    for (int i{}; i < std::min(frames, 10); i++) {
+        frame();
+    }
+    glFinish();
+
+    GLuint query{};
+    glCreateQueries(GL_TIME_ELAPSED, 1, &query);
+
+    const auto start = clock::now();
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    for (int i{}; i < frames; i++) {
+        frame();
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    glFinish();
+    const auto stop = clock::now();
+
+    GLuint64 elapsed_ns{};
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed_ns);
+    glDeleteQueries(1, &query);
+
+    BenchResult result;
+    result.cpu_ms = std::chrono::duration<double, std::milli>(stop - start).count() / frames;
+    result.gpu_ms = elapsed_ns / 1.0e6 / frames;
+    return result;
+}
+
+void print_bench_header()
+{
+    fmt::print("{:<32} {:>12} {:>12} {:>12}\n", "benchmark", "n", "cpu ms", "gpu ms");
+}
+
+void print_bench_result(std::string_view name, long long n, const BenchResult& result)
+{
+    fmt::print("{:<32} {:>12} {:>12.3f} {:>12.3f}\n", name, n, result.cpu_ms, result.gpu_ms);
+}
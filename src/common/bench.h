@@ -0,0 +1,20 @@
+#ifndef BENCH_H_INCLUDED
+#define BENCH_H_INCLUDED
+
+#include <functional>
+#include <string_view>
+#include "glad.h"
+#include <GLFW/glfw3.h>
+
+struct BenchResult {
+    double cpu_ms{}; // average wall-clock time per frame
+    double gpu_ms{}; // average GPU time per frame (GL_TIME_ELAPSED)
+};
+
+extern GLFWwindow* create_bench_window(const char* title, int width, int height);
+extern void destroy_bench_window(GLFWwindow* window);
+extern BenchResult run_bench(int frames, const std::function<void()>& frame);
+extern void print_bench_header();
+extern void print_bench_result(std::string_view name, long long n, const BenchResult& result);
+
+#endif // BENCH_H_INCLUDED
@@ -0,0 +1,376 @@
+#include "glad.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <fmt/core.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <vector>
+#include "canvas.h"
+#include "shader.h"
+#include "utils.h"
+
+// Where a shape goes in the stream, handed out by reserve()
+struct ShapeSpace {
+    CanvasVertex* vertices{};
+    GLuint* indices{};
+    GLuint base{}; // index of vertices[0] in its region
+};
+
+static GLuint create_program()
+{
+    namespace fs = std::filesystem;
+    return compile_shaders({
+        fs::canonical(dirname() / ".." / "shader" / "canvas.vert").c_str(),
+        fs::canonical(dirname() / ".." / "shader" / "canvas.frag").c_str(),
+    });
+}
+
+static GLuint pack_rgba8(glm::vec4 color)
+{
+    const glm::vec4 c = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+    return static_cast<GLuint>(c.x)
+        | static_cast<GLuint>(c.y) << 8
+        | static_cast<GLuint>(c.z) << 16
+        | static_cast<GLuint>(c.w) << 24;
+}
+
+/**
+ * Creates the program and the stream, of CANVAS_REGIONS regions of
+ * `region_vertices` vertices and three times as many indices each.
+ * The larger the regions, the fewer draw calls a busy frame takes.
+ */
+void create_canvas(Canvas2D& canvas, GLsizei region_vertices)
+{
+    canvas.program = create_program();
+    canvas.region_vertices = region_vertices;
+    canvas.region_indices = 3 * region_vertices;
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const GLsizeiptr vertex_bytes = GLsizeiptr{CANVAS_REGIONS} * canvas.region_vertices * sizeof(CanvasVertex);
+    const GLsizeiptr index_bytes = GLsizeiptr{CANVAS_REGIONS} * canvas.region_indices * sizeof(GLuint);
+    glCreateBuffers(1, &canvas.vbo);
+    glNamedBufferStorage(canvas.vbo, vertex_bytes, nullptr, flags);
+    canvas.vertices = static_cast<CanvasVertex*>(glMapNamedBufferRange(canvas.vbo, 0, vertex_bytes, flags));
+    glCreateBuffers(1, &canvas.ibo);
+    glNamedBufferStorage(canvas.ibo, index_bytes, nullptr, flags);
+    canvas.indices = static_cast<GLuint*>(glMapNamedBufferRange(canvas.ibo, 0, index_bytes, flags));
+
+    glCreateVertexArrays(1, &canvas.vao);
+    glVertexArrayVertexBuffer(canvas.vao, 0, canvas.vbo, 0, sizeof(CanvasVertex));
+    glVertexArrayElementBuffer(canvas.vao, canvas.ibo);
+    glEnableVertexArrayAttrib(canvas.vao, 0);
+    glVertexArrayAttribFormat(canvas.vao, 0, 2, GL_FLOAT, GL_FALSE, offsetof(CanvasVertex, position));
+    glVertexArrayAttribBinding(canvas.vao, 0, 0);
+    glEnableVertexArrayAttrib(canvas.vao, 1);
+    glVertexArrayAttribFormat(canvas.vao, 1, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(CanvasVertex, color));
+    glVertexArrayAttribBinding(canvas.vao, 1, 0);
+}
+
+// Recompiles the shaders, e.g. after editing them
+void reload_canvas(Canvas2D& canvas)
+{
+    flush_canvas(canvas);
+    glDeleteProgram(canvas.program);
+    canvas.program = create_program();
+    glProgramUniformMatrix4fv(canvas.program, 0, 1, GL_FALSE, glm::value_ptr(canvas.transform));
+}
+
+// Starts a frame, see set_canvas_transform()
+void begin_canvas(Canvas2D& canvas, const glm::mat4& transform, glm::vec2 viewport)
+{
+    canvas.shapes = 0;
+    canvas.draws = 0;
+    set_canvas_transform(canvas, transform, viewport);
+}
+
+/**
+ * Draws the shapes so far, and maps the ones after from canvas units to
+ * clip space with `transform`. `viewport` specifies the size in pixels
+ * that curves are made smooth for.
+ */
+void set_canvas_transform(Canvas2D& canvas, const glm::mat4& transform, glm::vec2 viewport)
+{
+    flush_canvas(canvas);
+    canvas.transform = transform;
+    canvas.pixels_per_unit = glm::length(glm::vec2{transform[0][0], transform[0][1]}) * viewport.x / 2.0f;
+    glProgramUniformMatrix4fv(canvas.program, 0, 1, GL_FALSE, glm::value_ptr(transform));
+}
+
+/**
+ * Draws the shapes appended since the last draw, with a single call.
+ * Leaves the canvas program as the current program and its VAO bound.
+ */
+void flush_canvas(Canvas2D& canvas)
+{
+    const GLsizei count = canvas.next_index - canvas.first_index;
+    if (count == 0) {
+        return;
+    }
+
+    const GLintptr offset = (GLintptr{canvas.region} * canvas.region_indices + canvas.first_index) * sizeof(GLuint);
+    glUseProgram(canvas.program);
+    glBindVertexArray(canvas.vao);
+    glDrawElementsBaseVertex(GL_TRIANGLES, count, GL_UNSIGNED_INT,
+        reinterpret_cast<const void*>(offset), canvas.region * canvas.region_vertices);
+    canvas.first_index = canvas.next_index;
+    canvas.draws++;
+}
+
+// Draws the shapes of the frame
+void end_canvas(Canvas2D& canvas)
+{
+    flush_canvas(canvas);
+}
+
+void delete_canvas(Canvas2D& canvas)
+{
+    for (GLsync fence : canvas.fences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+    glDeleteVertexArrays(1, &canvas.vao);
+    glUnmapNamedBuffer(canvas.ibo);
+    glDeleteBuffers(1, &canvas.ibo);
+    glUnmapNamedBuffer(canvas.vbo);
+    glDeleteBuffers(1, &canvas.vbo);
+    glDeleteProgram(canvas.program);
+    canvas = Canvas2D{};
+}
+
+// Draws the current region, fences it, and moves on to the next one once
+// the GPU has finished drawing from it
+static void next_region(Canvas2D& canvas)
+{
+    flush_canvas(canvas);
+    canvas.fences[canvas.region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    canvas.region = (canvas.region + 1) % CANVAS_REGIONS;
+    canvas.next_vertex = 0;
+    canvas.next_index = 0;
+    canvas.first_index = 0;
+
+    GLsync& fence = canvas.fences[canvas.region];
+    if (!fence) {
+        return;
+    }
+    if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+        canvas.waits++;
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000) == GL_TIMEOUT_EXPIRED) {
+        }
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+// Takes space for a shape from the current region, or the next one if it
+// does not fit. Returns false if it does not fit in a region at all.
+static bool reserve(Canvas2D& canvas, GLsizei num_vertices, GLsizei num_indices, ShapeSpace& space)
+{
+    if (num_vertices > canvas.region_vertices || num_indices > canvas.region_indices) {
+        fmt::print(stderr, "ERROR: Shape of {} vertices is larger than a canvas region\n", num_vertices);
+        return false;
+    }
+    if (canvas.next_vertex + num_vertices > canvas.region_vertices ||
+        canvas.next_index + num_indices > canvas.region_indices) {
+        next_region(canvas);
+    }
+
+    space.vertices = canvas.vertices + canvas.region * canvas.region_vertices + canvas.next_vertex;
+    space.indices = canvas.indices + canvas.region * canvas.region_indices + canvas.next_index;
+    space.base = canvas.next_vertex;
+    canvas.next_vertex += num_vertices;
+    canvas.next_index += num_indices;
+    canvas.shapes++;
+    return true;
+}
+
+// Segments for an arc of `angle` radians: as few as keep every chord within
+// a quarter pixel of the arc, and at least one per quarter turn
+static int arc_segments(const Canvas2D& canvas, float radius, float angle)
+{
+    const float pixels = radius * canvas.pixels_per_unit;
+    const float step = pixels > 0.25f ? 2.0f * std::acos(1.0f - 0.25f / pixels) : glm::half_pi<float>();
+    const int least = std::max(static_cast<int>(std::ceil(angle / glm::half_pi<float>() - 1e-3f)), 1);
+    return std::clamp(static_cast<int>(std::ceil(angle / step)), least, 256);
+}
+
+// Writes the `segments` + 1 points of an arc, starting at `start` radians
+// and `step` apart. Rotates a unit vector rather than calling sin and cos
+// for every point.
+static void put_arc(
+    CanvasVertex* vertices, glm::vec2 center, float radius,
+    float start, float step, int segments, GLuint color)
+{
+    const float c = std::cos(step);
+    const float s = std::sin(step);
+    glm::vec2 direction{std::cos(start), std::sin(start)};
+    for (int i{}; i <= segments; i++) {
+        vertices[i] = CanvasVertex{center + radius * direction, color};
+        direction = glm::vec2{c * direction.x - s * direction.y, s * direction.x + c * direction.y};
+    }
+}
+
+static void put_triangle(GLuint*& indices, GLuint a, GLuint b, GLuint c)
+{
+    indices[0] = a;
+    indices[1] = b;
+    indices[2] = c;
+    indices += 3;
+}
+
+void fill_circle(Canvas2D& canvas, glm::vec2 center, float radius, glm::vec4 color)
+{
+    fill_pie(canvas, center, radius, 0.0f, 360.0f, color);
+}
+
+/**
+ * Appends a pie.
+ * `start` specifies the starting angle in degrees.
+ * `end` specifies the ending angle in degrees.
+ */
+void fill_pie(Canvas2D& canvas, glm::vec2 center, float radius, float start, float end, glm::vec4 color)
+{
+    start = glm::radians(start);
+    end = glm::radians(end);
+    const int segments = arc_segments(canvas, radius, std::abs(end - start));
+    ShapeSpace space;
+    if (!reserve(canvas, segments + 2, 3 * segments, space)) {
+        return;
+    }
+
+    const GLuint rgba = pack_rgba8(color);
+    space.vertices[0] = CanvasVertex{center, rgba};
+    put_arc(space.vertices + 1, center, radius, start, (end - start) / segments, segments, rgba);
+    for (int i{}; i < segments; i++) {
+        put_triangle(space.indices, space.base, space.base + 1 + i, space.base + 2 + i);
+    }
+}
+
+/**
+ * Appends a ring, or a part of it from `start` to `end` degrees.
+ */
+void fill_ring(Canvas2D& canvas, glm::vec2 center, float inner_radius, float outer_radius, glm::vec4 color,
+    float start, float end)
+{
+    start = glm::radians(start);
+    end = glm::radians(end);
+    const int segments = arc_segments(canvas, outer_radius, std::abs(end - start));
+    ShapeSpace space;
+    if (!reserve(canvas, 2 * (segments + 1), 6 * segments, space)) {
+        return;
+    }
+
+    // The outer arc, then the inner one
+    const GLuint rgba = pack_rgba8(color);
+    const float step = (end - start) / segments;
+    put_arc(space.vertices, center, outer_radius, start, step, segments, rgba);
+    put_arc(space.vertices + segments + 1, center, inner_radius, start, step, segments, rgba);
+    const GLuint outer = space.base;
+    const GLuint inner = space.base + segments + 1;
+    for (int i{}; i < segments; i++) {
+        put_triangle(space.indices, outer + i, outer + i + 1, inner + i);
+        put_triangle(space.indices, inner + i, outer + i + 1, inner + i + 1);
+    }
+}
+
+/**
+ * Appends a rectangle with rounded corners.
+ * `size` specifies the width and height of the rectangle.
+ * `radius` specifies the radius of the corners, at most half the shorter side.
+ */
+void fill_rounded_rect(Canvas2D& canvas, glm::vec2 center, glm::vec2 size, float radius, glm::vec4 color)
+{
+    const glm::vec2 half = size / 2.0f;
+    const float r = std::clamp(radius, 0.0f, std::min(half.x, half.y));
+    const int segments = arc_segments(canvas, r, glm::half_pi<float>());
+    const int outline = 4 * (segments + 1);
+    ShapeSpace space;
+    if (!reserve(canvas, outline + 1, 3 * outline, space)) {
+        return;
+    }
+
+    // A fan around the center, through the corners counter-clockwise,
+    // starting from the top-right one
+    const GLuint rgba = pack_rgba8(color);
+    const glm::vec2 corners[]{{+1.0f, +1.0f}, {-1.0f, +1.0f}, {-1.0f, -1.0f}, {+1.0f, -1.0f}};
+    space.vertices[0] = CanvasVertex{center, rgba};
+    for (int i{}; i < 4; i++) {
+        put_arc(space.vertices + 1 + i * (segments + 1), center + corners[i] * (half - r), r,
+            i * glm::half_pi<float>(), glm::half_pi<float>() / segments, segments, rgba);
+    }
+    for (int i{}; i < outline; i++) {
+        put_triangle(space.indices, space.base, space.base + 1 + i, space.base + 1 + (i + 1) % outline);
+    }
+}
+
+/**
+ * Appends a convex polygon, as a fan from its first point.
+ * `points` specifies at least 3 points, in either winding.
+ */
+void fill_polygon(Canvas2D& canvas, const std::vector<glm::vec2>& points, glm::vec4 color)
+{
+    const GLsizei n = static_cast<GLsizei>(points.size());
+    ShapeSpace space;
+    if (n < 3 || !reserve(canvas, n, 3 * (n - 2), space)) {
+        return;
+    }
+
+    const GLuint rgba = pack_rgba8(color);
+    for (GLsizei i{}; i < n; i++) {
+        space.vertices[i] = CanvasVertex{points[i], rgba};
+    }
+    for (GLsizei i{1}; i < n - 1; i++) {
+        put_triangle(space.indices, space.base, space.base + i, space.base + i + 1);
+    }
+}
+
+/**
+ * Appends a polyline.
+ * `points` specifies at least 2 points, or at least 3 if `closed` is true.
+ * `thickness` specifies the line width in canvas units.
+ * `closed` connects the last point back to the first one.
+ * Each segment is a quad, and the gaps where they meet are filled with
+ * bevel joins.
+ */
+void stroke_polyline(Canvas2D& canvas, const std::vector<glm::vec2>& points, float thickness, glm::vec4 color,
+    bool closed)
+{
+    const GLsizei n = static_cast<GLsizei>(points.size());
+    closed = closed && n >= 3;
+    const GLsizei segments = closed ? n : n - 1;
+    const GLsizei joins = closed ? n : n - 2;
+    ShapeSpace space;
+    if (n < 2 || !reserve(canvas, 4 * segments + joins, 6 * (segments + joins), space)) {
+        return;
+    }
+
+    // Segment i has vertices 4i to 4i+3, left and right of its start, then
+    // of its end. The joins then add the points they pivot around.
+    const GLuint rgba = pack_rgba8(color);
+    for (GLsizei i{}; i < segments; i++) {
+        const glm::vec2 a = points[i];
+        const glm::vec2 b = points[(i + 1) % n];
+        const float length = glm::length(b - a);
+        const glm::vec2 normal = length > 0.0f
+            ? glm::vec2{a.y - b.y, b.x - a.x} * (thickness / 2.0f / length)
+            : glm::vec2{};
+        CanvasVertex* quad = space.vertices + 4 * i;
+        quad[0] = CanvasVertex{a + normal, rgba};
+        quad[1] = CanvasVertex{a - normal, rgba};
+        quad[2] = CanvasVertex{b + normal, rgba};
+        quad[3] = CanvasVertex{b - normal, rgba};
+        const GLuint first = space.base + 4 * i;
+        put_triangle(space.indices, first, first + 1, first + 2);
+        put_triangle(space.indices, first + 2, first + 1, first + 3);
+    }
+    for (GLsizei i{}; i < joins; i++) {
+        const GLsizei next = (i + 1) % segments;
+        const GLuint pivot = space.base + 4 * segments + i;
+        space.vertices[4 * segments + i] = CanvasVertex{points[(i + 1) % n], rgba};
+        put_triangle(space.indices, pivot, space.base + 4 * i + 2, space.base + 4 * next);
+        put_triangle(space.indices, pivot, space.base + 4 * i + 3, space.base + 4 * next + 1);
+    }
+}
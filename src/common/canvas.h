@@ -0,0 +1,62 @@
+#ifndef CANVAS_H_INCLUDED
+#define CANVAS_H_INCLUDED
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "glad.h"
+
+// One vertex of the stream, laid out for shader/canvas.vert
+struct CanvasVertex {
+    glm::vec2 position{};
+    GLuint color{}; // RGBA8
+};
+static_assert(sizeof(CanvasVertex) == 12, "CanvasVertex must be tightly packed");
+
+// Parts of the stream, each fenced once the canvas moves on to the next one
+constexpr int CANVAS_REGIONS{3};
+
+// Immediate-mode 2D shapes, appended as indexed triangles with a color per
+// vertex to a persistently mapped vertex and index stream. Shapes are only
+// drawn when the transform changes, when a region of the stream fills up
+// and at end_canvas(), so a frame of any number of shapes takes a draw call
+// per region it spans rather than one per shape, and no uniform changes.
+// Regions are reused once the GPU has passed the fence of their last draw.
+struct Canvas2D {
+    GLuint program{};
+    GLuint vao{};
+    GLuint vbo{};
+    GLuint ibo{};
+    CanvasVertex* vertices{};     // persistently mapped, CANVAS_REGIONS regions
+    GLuint* indices{};            // relative to the first vertex of their region
+    GLsizei region_vertices{};    // capacity of a region
+    GLsizei region_indices{};
+    GLsync fences[CANVAS_REGIONS]{};
+    int region{};                 // being written
+    GLsizei next_vertex{};        // free space in that region
+    GLsizei next_index{};
+    GLsizei first_index{};        // of the shapes not drawn yet
+    glm::mat4 transform{1.0f};    // from canvas units to clip space
+    float pixels_per_unit{1.0f};  // picks the segments of curves
+    long long shapes{};           // since begin_canvas()
+    long long draws{};
+    long long waits{};            // for the GPU to free a region, since create_canvas()
+};
+
+extern void create_canvas(Canvas2D& canvas, GLsizei region_vertices = 1 << 18);
+extern void reload_canvas(Canvas2D& canvas);
+extern void begin_canvas(Canvas2D& canvas, const glm::mat4& transform, glm::vec2 viewport);
+extern void set_canvas_transform(Canvas2D& canvas, const glm::mat4& transform, glm::vec2 viewport);
+extern void flush_canvas(Canvas2D& canvas);
+extern void end_canvas(Canvas2D& canvas);
+extern void delete_canvas(Canvas2D& canvas);
+
+extern void fill_circle(Canvas2D& canvas, glm::vec2 center, float radius, glm::vec4 color);
+extern void fill_pie(Canvas2D& canvas, glm::vec2 center, float radius, float start, float end, glm::vec4 color);
+extern void fill_ring(Canvas2D& canvas, glm::vec2 center, float inner_radius, float outer_radius, glm::vec4 color,
+    float start = 0.0f, float end = 360.0f);
+extern void fill_rounded_rect(Canvas2D& canvas, glm::vec2 center, glm::vec2 size, float radius, glm::vec4 color);
+extern void fill_polygon(Canvas2D& canvas, const std::vector<glm::vec2>& points, glm::vec4 color);
+extern void stroke_polyline(Canvas2D& canvas, const std::vector<glm::vec2>& points, float thickness, glm::vec4 color,
+    bool closed = false);
+
+#endif // CANVAS_H_INCLUDED
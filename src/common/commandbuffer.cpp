@@ -0,0 +1,190 @@
+#include "glad.h"
+#include <cstring>
+#include <glm/gtc/type_ptr.hpp>
+#include "commandbuffer.h"
+
+enum CommandType : GLuint {
+    USE_PROGRAM,
+    BIND_VERTEX_ARRAY,
+    BIND_BUFFER_BASE,
+    POLYGON_MODE,
+    UNIFORM_1F,
+    UNIFORM_3F,
+    UNIFORM_4F,
+    UNIFORM_MATRIX_4F,
+    DRAW_ARRAYS,
+    DRAW_ELEMENTS,
+};
+
+// Arguments of the commands, stored right after their type
+struct BindBufferBase {
+    GLenum target;
+    GLuint index;
+    GLuint object;
+};
+
+template <typename T>
+struct Uniform {
+    GLint location;
+    T value;
+};
+
+struct DrawArrays {
+    GLenum mode;
+    GLint first;
+    GLsizei count;
+    GLsizei instance_count;
+};
+
+struct DrawElements {
+    GLenum mode;
+    GLsizei count;
+    GLenum type;
+    GLintptr offset;
+    GLsizei instance_count;
+};
+
+template <typename T>
+static void record(CommandBuffer& buffer, CommandType type, const T& args)
+{
+    const size_t size = buffer.data.size();
+    buffer.data.resize(size + sizeof(type) + sizeof(args));
+    std::memcpy(buffer.data.data() + size, &type, sizeof(type));
+    std::memcpy(buffer.data.data() + size + sizeof(type), &args, sizeof(args));
+    buffer.commands++;
+}
+
+// Reads the arguments at `p` and advances `p` past them
+template <typename T>
+static T read(const unsigned char*& p)
+{
+    T args;
+    std::memcpy(&args, p, sizeof(args));
+    p += sizeof(args);
+    return args;
+}
+
+void reset_command_buffer(CommandBuffer& buffer)
+{
+    buffer.data.clear();
+    buffer.commands = 0;
+}
+
+void record_use_program(CommandBuffer& buffer, GLuint program)
+{
+    record(buffer, USE_PROGRAM, program);
+}
+
+void record_bind_vertex_array(CommandBuffer& buffer, GLuint vao)
+{
+    record(buffer, BIND_VERTEX_ARRAY, vao);
+}
+
+void record_bind_buffer_base(CommandBuffer& buffer, GLenum target, GLuint index, GLuint object)
+{
+    record(buffer, BIND_BUFFER_BASE, BindBufferBase{target, index, object});
+}
+
+void record_polygon_mode(CommandBuffer& buffer, GLenum mode)
+{
+    record(buffer, POLYGON_MODE, mode);
+}
+
+void record_uniform(CommandBuffer& buffer, GLint location, GLfloat value)
+{
+    record(buffer, UNIFORM_1F, Uniform<GLfloat>{location, value});
+}
+
+void record_uniform(CommandBuffer& buffer, GLint location, const glm::vec3& value)
+{
+    record(buffer, UNIFORM_3F, Uniform<glm::vec3>{location, value});
+}
+
+void record_uniform(CommandBuffer& buffer, GLint location, const glm::vec4& value)
+{
+    record(buffer, UNIFORM_4F, Uniform<glm::vec4>{location, value});
+}
+
+void record_uniform(CommandBuffer& buffer, GLint location, const glm::mat4& value)
+{
+    record(buffer, UNIFORM_MATRIX_4F, Uniform<glm::mat4>{location, value});
+}
+
+void record_draw_arrays(CommandBuffer& buffer, GLenum mode, GLint first, GLsizei count, GLsizei instance_count)
+{
+    record(buffer, DRAW_ARRAYS, DrawArrays{mode, first, count, instance_count});
+}
+
+/**
+ * Records an indexed draw.
+ * `offset` specifies the byte offset of the first index in the element
+ *     buffer of the VAO bound when the command is replayed.
+ */
+void record_draw_elements(CommandBuffer& buffer, GLenum mode, GLsizei count, GLenum type, GLintptr offset, GLsizei instance_count)
+{
+    record(buffer, DRAW_ELEMENTS, DrawElements{mode, count, type, offset, instance_count});
+}
+
+// Issues the recorded GL calls in order. Must run on the thread with the context.
+void replay_command_buffer(const CommandBuffer& buffer)
+{
+    const unsigned char* p = buffer.data.data();
+    const unsigned char* end = p + buffer.data.size();
+    while (p < end) {
+        switch (read<CommandType>(p)) {
+        case USE_PROGRAM:
+            glUseProgram(read<GLuint>(p));
+            break;
+        case BIND_VERTEX_ARRAY:
+            glBindVertexArray(read<GLuint>(p));
+            break;
+        case BIND_BUFFER_BASE: {
+            const auto args = read<BindBufferBase>(p);
+            glBindBufferBase(args.target, args.index, args.object);
+            break;
+        }
+        case POLYGON_MODE:
+            glPolygonMode(GL_FRONT_AND_BACK, read<GLenum>(p));
+            break;
+        case UNIFORM_1F: {
+            const auto args = read<Uniform<GLfloat>>(p);
+            glUniform1f(args.location, args.value);
+            break;
+        }
+        case UNIFORM_3F: {
+            const auto args = read<Uniform<glm::vec3>>(p);
+            glUniform3fv(args.location, 1, glm::value_ptr(args.value));
+            break;
+        }
+        case UNIFORM_4F: {
+            const auto args = read<Uniform<glm::vec4>>(p);
+            glUniform4fv(args.location, 1, glm::value_ptr(args.value));
+            break;
+        }
+        case UNIFORM_MATRIX_4F: {
+            const auto args = read<Uniform<glm::mat4>>(p);
+            glUniformMatrix4fv(args.location, 1, GL_FALSE, glm::value_ptr(args.value));
+            break;
+        }
+        case DRAW_ARRAYS: {
+            const auto args = read<DrawArrays>(p);
+            glDrawArraysInstanced(args.mode, args.first, args.count, args.instance_count);
+            break;
+        }
+        case DRAW_ELEMENTS: {
+            const auto args = read<DrawElements>(p);
+            glDrawElementsInstanced(args.mode, args.count, args.type,
+                reinterpret_cast<const void*>(args.offset), args.instance_count);
+            break;
+        }
+        }
+    }
+}
+
+// Replays `buffers` one after the other, e.g. those of the workers of a frame
+void replay_command_buffers(const std::vector<CommandBuffer>& buffers)
+{
+    for (const CommandBuffer& buffer : buffers) {
+        replay_command_buffer(buffer);
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef COMMANDBUFFER_H_INCLUDED
+#define COMMANDBUFFER_H_INCLUDED
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "glad.h"
+
+// GL calls recorded into a linear buffer, to be replayed later on the thread
+// that owns the context. Recording makes no GL calls, so each worker thread
+// can record into its own buffer. Resetting keeps the memory, so recording
+// stops allocating once a buffer has grown to the size of a frame.
+struct CommandBuffer {
+    std::vector<unsigned char> data; // packed commands, each a type then its arguments
+    int commands{};
+};
+
+extern void reset_command_buffer(CommandBuffer& buffer);
+extern void record_use_program(CommandBuffer& buffer, GLuint program);
+extern void record_bind_vertex_array(CommandBuffer& buffer, GLuint vao);
+extern void record_bind_buffer_base(CommandBuffer& buffer, GLenum target, GLuint index, GLuint object);
+extern void record_polygon_mode(CommandBuffer& buffer, GLenum mode);
+extern void record_uniform(CommandBuffer& buffer, GLint location, GLfloat value);
+extern void record_uniform(CommandBuffer& buffer, GLint location, const glm::vec3& value);
+extern void record_uniform(CommandBuffer& buffer, GLint location, const glm::vec4& value);
+extern void record_uniform(CommandBuffer& buffer, GLint location, const glm::mat4& value);
+extern void record_draw_arrays(CommandBuffer& buffer, GLenum mode, GLint first, GLsizei count, GLsizei instance_count = 1);
+extern void record_draw_elements(CommandBuffer& buffer, GLenum mode, GLsizei count, GLenum type, GLintptr offset, GLsizei instance_count = 1);
+extern void replay_command_buffer(const CommandBuffer& buffer);
+extern void replay_command_buffers(const std::vector<CommandBuffer>& buffers);
+
+#endif // COMMANDBUFFER_H_INCLUDED
@@ -0,0 +1,401 @@
+#include "glad.h"
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <initializer_list>
+#include "cubecull.h"
+#include "frustum.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CUBECULL_X86
+#include <immintrin.h>
+#endif
+
+// What every kernel needs to cull a range of cubes
+struct CubeCull {
+    Frustum frustum;
+    glm::mat4 view_proj{};
+    float spread{};
+    float time{};
+    GLuint* visible_ids{};
+    glm::mat4* matrices{};
+};
+
+// Angular speeds of the motion in shader/cubes-cull.comp
+constexpr float K_X{0.35f}, K_Y{0.52f}, K_Z{0.70f}, K_SPIN{1.75f};
+
+constexpr float CUBE_RADIUS{1.7320508f}; // bounding sphere of a cube with half size 1
+
+// Returns k * (id + time), as phase() in shader/cubes-cull.comp
+static float phase(float k, GLuint id, float time)
+{
+    const float x = k / glm::two_pi<float>() * static_cast<float>(id);
+    return glm::two_pi<float>() * (x - std::floor(x)) + k * time;
+}
+
+// Culls cubes `first` to `end` - 1 one at a time, after `visible` others
+// are visible. Returns the number visible after them.
+static GLuint cull_scalar(const CubeCull& cull, GLuint first, GLuint end, GLuint visible)
+{
+    for (GLuint id = first; id < end; id++) {
+        const glm::vec3 center = glm::vec3{
+            std::sin(phase(K_X, id, cull.time)),
+            std::sin(phase(K_Y, id, cull.time)),
+            std::sin(phase(K_Z, id, cull.time)),
+        } * cull.spread;
+        if (!sphere_in_frustum(cull.frustum, center, CUBE_RADIUS)) {
+            continue;
+        }
+
+        // The product of the three rotation matrices of the shader, which
+        // rotate by -angle, written out in closed form
+        const float angle = phase(K_SPIN, id, cull.time);
+        const float c = std::cos(angle);
+        const float s = -std::sin(angle);
+        const glm::mat4 model{
+            c*c,          c*s + s*s*c,  s*s - s*c*c,  0.0f,
+            -c*s,         c*c - s*s*s,  s*c + c*s*s,  0.0f,
+            s,            -s*c,         c*c,          0.0f,
+            center.x,     center.y,     center.z,     1.0f,
+        };
+        cull.visible_ids[visible++] = id;
+        cull.matrices[id] = cull.view_proj * model;
+    }
+    return visible;
+}
+
+#ifdef CUBECULL_X86
+
+// The kernels below evaluate sin and cos as polynomials (Cephes sinf and
+// cosf) after reducing the angle to [-pi/4, pi/4] around a multiple of
+// pi/2, which is split in three for an exact reduction
+constexpr float PIO2_1{1.5703125f}, PIO2_2{4.837512969970703125e-4f}, PIO2_3{7.54978995489188216e-8f};
+constexpr float SIN_1{-1.6666654611e-1f}, SIN_2{8.3321608736e-3f}, SIN_3{-1.9515295891e-4f};
+constexpr float COS_1{4.166664568298827e-2f}, COS_2{-1.388731625493765e-3f}, COS_3{2.443315711809948e-5f};
+
+// Sine and cosine of 4 angles
+__attribute__((target("sse4.1")))
+static void sincos_sse4(__m128 x, __m128& sin, __m128& cos)
+{
+    const __m128 j = _mm_round_ps(_mm_mul_ps(x, _mm_set1_ps(2.0f / glm::pi<float>())),
+        _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(j, _mm_set1_ps(PIO2_1)));
+    r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(PIO2_2)));
+    r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(PIO2_3)));
+    const __m128 r2 = _mm_mul_ps(r, r);
+
+    __m128 s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_3), r2), _mm_set1_ps(SIN_2));
+    s = _mm_add_ps(_mm_mul_ps(s, r2), _mm_set1_ps(SIN_1));
+    s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, r2), r), r);
+    __m128 c = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(COS_3), r2), _mm_set1_ps(COS_2));
+    c = _mm_add_ps(_mm_mul_ps(c, r2), _mm_set1_ps(COS_1));
+    c = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(c, r2), r2), _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(r2, _mm_set1_ps(0.5f))));
+
+    // In quadrant q, sin(x) is s, c, -s, -c and cos(x) is c, -s, -c, s
+    const __m128i q = _mm_cvtps_epi32(j);
+    const __m128 odd = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+    const __m128 sin_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), 30));
+    const __m128 cos_sign = _mm_castsi128_ps(
+        _mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+    sin = _mm_xor_ps(_mm_blendv_ps(s, c, odd), sin_sign);
+    cos = _mm_xor_ps(_mm_blendv_ps(c, s, odd), cos_sign);
+}
+
+// phase() of cubes `ids`
+__attribute__((target("sse4.1")))
+static __m128 phase_sse4(float k, __m128 ids, float time)
+{
+    const __m128 x = _mm_mul_ps(_mm_set1_ps(k / glm::two_pi<float>()), ids);
+    const __m128 fraction = _mm_sub_ps(x, _mm_floor_ps(x));
+    return _mm_add_ps(_mm_mul_ps(_mm_set1_ps(glm::two_pi<float>()), fraction), _mm_set1_ps(k * time));
+}
+
+// Stores column `col` of the matrices of 4 cubes from `first` on, given
+// as its rows across them, for the cubes whose bit is set in `mask`
+__attribute__((target("sse4.1")))
+static void store_column_sse4(glm::mat4* matrices, GLuint first, int mask, int col,
+    __m128 row0, __m128 row1, __m128 row2, __m128 row3)
+{
+    _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+    const __m128 columns[4]{row0, row1, row2, row3};
+    for (; mask; mask &= mask - 1) {
+        const int i = __builtin_ctz(mask);
+        _mm_storeu_ps(&matrices[first + i][col][0], columns[i]);
+    }
+}
+
+// Culls the first `blocks` * 4 cubes, 4 at a time. Returns the number visible.
+__attribute__((target("sse4.1")))
+static GLuint cull_sse4(const CubeCull& cull, GLuint blocks)
+{
+    __m128 planes[6][4];
+    for (int p{}; p < 6; p++) {
+        for (int i{}; i < 4; i++) {
+            planes[p][i] = _mm_set1_ps(cull.frustum.planes[p][i]);
+        }
+    }
+    __m128 view_proj[4][4];
+    for (int col{}; col < 4; col++) {
+        for (int row{}; row < 4; row++) {
+            view_proj[col][row] = _mm_set1_ps(cull.view_proj[col][row]);
+        }
+    }
+    const __m128 spread = _mm_set1_ps(cull.spread);
+    const __m128 min_distance = _mm_set1_ps(-CUBE_RADIUS);
+
+    GLuint visible{};
+    for (GLuint block{}; block < blocks; block++) {
+        const GLuint first = 4*block;
+        const __m128 ids = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(static_cast<int>(first)), _mm_setr_epi32(0, 1, 2, 3)));
+
+        __m128 center[3], unused;
+        sincos_sse4(phase_sse4(K_X, ids, cull.time), center[0], unused);
+        sincos_sse4(phase_sse4(K_Y, ids, cull.time), center[1], unused);
+        sincos_sse4(phase_sse4(K_Z, ids, cull.time), center[2], unused);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int i{}; i < 3; i++) {
+            center[i] = _mm_mul_ps(center[i], spread);
+        }
+        for (const auto& plane : planes) {
+            const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(plane[0], center[0]), _mm_mul_ps(plane[1], center[1])),
+                _mm_mul_ps(plane[2], center[2])), plane[3]);
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, min_distance));
+        }
+        const int mask = _mm_movemask_ps(inside);
+        if (!mask) {
+            continue;
+        }
+
+        __m128 s, c;
+        sincos_sse4(phase_sse4(K_SPIN, ids, cull.time), s, c);
+        s = _mm_sub_ps(_mm_setzero_ps(), s);
+        const __m128 cc = _mm_mul_ps(c, c), cs = _mm_mul_ps(c, s), ss = _mm_mul_ps(s, s);
+        const __m128 ssc = _mm_mul_ps(ss, c);
+        const __m128 model[4][3]{
+            {cc, _mm_add_ps(cs, ssc), _mm_sub_ps(ss, _mm_mul_ps(cs, c))},
+            {_mm_sub_ps(_mm_setzero_ps(), cs), _mm_sub_ps(cc, _mm_mul_ps(ss, s)), _mm_add_ps(cs, ssc)},
+            {s, _mm_sub_ps(_mm_setzero_ps(), cs), cc},
+            {center[0], center[1], center[2]},
+        };
+        for (int col{}; col < 4; col++) {
+            __m128 rows[4];
+            for (int row{}; row < 4; row++) {
+                rows[row] = _mm_add_ps(_mm_add_ps(
+                    _mm_mul_ps(view_proj[0][row], model[col][0]), _mm_mul_ps(view_proj[1][row], model[col][1])),
+                    _mm_mul_ps(view_proj[2][row], model[col][2]));
+                if (col == 3) {
+                    rows[row] = _mm_add_ps(rows[row], view_proj[3][row]);
+                }
+            }
+            store_column_sse4(cull.matrices, first, mask, col, rows[0], rows[1], rows[2], rows[3]);
+        }
+        for (int bits = mask; bits; bits &= bits - 1) {
+            cull.visible_ids[visible++] = first + __builtin_ctz(bits);
+        }
+    }
+    return visible;
+}
+
+// Sine and cosine of 8 angles
+__attribute__((target("avx2,fma")))
+static void sincos_avx2(__m256 x, __m256& sin, __m256& cos)
+{
+    const __m256 j = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(2.0f / glm::pi<float>())),
+        _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 r = _mm256_fnmadd_ps(j, _mm256_set1_ps(PIO2_1), x);
+    r = _mm256_fnmadd_ps(j, _mm256_set1_ps(PIO2_2), r);
+    r = _mm256_fnmadd_ps(j, _mm256_set1_ps(PIO2_3), r);
+    const __m256 r2 = _mm256_mul_ps(r, r);
+
+    __m256 s = _mm256_fmadd_ps(_mm256_set1_ps(SIN_3), r2, _mm256_set1_ps(SIN_2));
+    s = _mm256_fmadd_ps(s, r2, _mm256_set1_ps(SIN_1));
+    s = _mm256_fmadd_ps(_mm256_mul_ps(s, r2), r, r);
+    __m256 c = _mm256_fmadd_ps(_mm256_set1_ps(COS_3), r2, _mm256_set1_ps(COS_2));
+    c = _mm256_fmadd_ps(c, r2, _mm256_set1_ps(COS_1));
+    c = _mm256_fmadd_ps(_mm256_mul_ps(c, r2), r2, _mm256_fnmadd_ps(r2, _mm256_set1_ps(0.5f), _mm256_set1_ps(1.0f)));
+
+    // In quadrant q, sin(x) is s, c, -s, -c and cos(x) is c, -s, -c, s
+    const __m256i q = _mm256_cvtps_epi32(j);
+    const __m256 odd = _mm256_castsi256_ps(
+        _mm256_cmpeq_epi32(_mm256_and_si256(q, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+    const __m256 sin_sign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(q, _mm256_set1_epi32(2)), 30));
+    const __m256 cos_sign = _mm256_castsi256_ps(
+        _mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(q, _mm256_set1_epi32(1)), _mm256_set1_epi32(2)), 30));
+    sin = _mm256_xor_ps(_mm256_blendv_ps(s, c, odd), sin_sign);
+    cos = _mm256_xor_ps(_mm256_blendv_ps(c, s, odd), cos_sign);
+}
+
+// phase() of cubes `ids`
+__attribute__((target("avx2,fma")))
+static __m256 phase_avx2(float k, __m256 ids, float time)
+{
+    const __m256 x = _mm256_mul_ps(_mm256_set1_ps(k / glm::two_pi<float>()), ids);
+    const __m256 fraction = _mm256_sub_ps(x, _mm256_floor_ps(x));
+    return _mm256_fmadd_ps(_mm256_set1_ps(glm::two_pi<float>()), fraction, _mm256_set1_ps(k * time));
+}
+
+// Culls the first `blocks` * 8 cubes, 8 at a time. Returns the number visible.
+__attribute__((target("avx2,fma")))
+static GLuint cull_avx2(const CubeCull& cull, GLuint blocks)
+{
+    __m256 planes[6][4];
+    for (int p{}; p < 6; p++) {
+        for (int i{}; i < 4; i++) {
+            planes[p][i] = _mm256_set1_ps(cull.frustum.planes[p][i]);
+        }
+    }
+    __m256 view_proj[4][4];
+    for (int col{}; col < 4; col++) {
+        for (int row{}; row < 4; row++) {
+            view_proj[col][row] = _mm256_set1_ps(cull.view_proj[col][row]);
+        }
+    }
+    const __m256 spread = _mm256_set1_ps(cull.spread);
+    const __m256 min_distance = _mm256_set1_ps(-CUBE_RADIUS);
+
+    GLuint visible{};
+    for (GLuint block{}; block < blocks; block++) {
+        const GLuint first = 8*block;
+        const __m256 ids = _mm256_cvtepi32_ps(_mm256_add_epi32(
+            _mm256_set1_epi32(static_cast<int>(first)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+
+        __m256 center[3], unused;
+        sincos_avx2(phase_avx2(K_X, ids, cull.time), center[0], unused);
+        sincos_avx2(phase_avx2(K_Y, ids, cull.time), center[1], unused);
+        sincos_avx2(phase_avx2(K_Z, ids, cull.time), center[2], unused);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int i{}; i < 3; i++) {
+            center[i] = _mm256_mul_ps(center[i], spread);
+        }
+        for (const auto& plane : planes) {
+            const __m256 distance = _mm256_fmadd_ps(plane[0], center[0],
+                _mm256_fmadd_ps(plane[1], center[1], _mm256_fmadd_ps(plane[2], center[2], plane[3])));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, min_distance, _CMP_GE_OQ));
+        }
+        const int mask = _mm256_movemask_ps(inside);
+        if (!mask) {
+            continue;
+        }
+
+        __m256 s, c;
+        sincos_avx2(phase_avx2(K_SPIN, ids, cull.time), s, c);
+        s = _mm256_sub_ps(_mm256_setzero_ps(), s);
+        const __m256 cc = _mm256_mul_ps(c, c), cs = _mm256_mul_ps(c, s), ss = _mm256_mul_ps(s, s);
+        const __m256 ssc = _mm256_mul_ps(ss, c);
+        const __m256 model[4][3]{
+            {cc, _mm256_add_ps(cs, ssc), _mm256_fnmadd_ps(cs, c, ss)},
+            {_mm256_sub_ps(_mm256_setzero_ps(), cs), _mm256_fnmadd_ps(ss, s, cc), _mm256_add_ps(cs, ssc)},
+            {s, _mm256_sub_ps(_mm256_setzero_ps(), cs), cc},
+            {center[0], center[1], center[2]},
+        };
+        for (int col{}; col < 4; col++) {
+            __m256 rows[4];
+            for (int row{}; row < 4; row++) {
+                rows[row] = _mm256_fmadd_ps(view_proj[0][row], model[col][0],
+                    _mm256_fmadd_ps(view_proj[1][row], model[col][1],
+                    _mm256_mul_ps(view_proj[2][row], model[col][2])));
+                if (col == 3) {
+                    rows[row] = _mm256_add_ps(rows[row], view_proj[3][row]);
+                }
+            }
+            // Each half holds 4 cubes, stored as the SSE kernel does
+            store_column_sse4(cull.matrices, first, mask & 0xf, col,
+                _mm256_castps256_ps128(rows[0]), _mm256_castps256_ps128(rows[1]),
+                _mm256_castps256_ps128(rows[2]), _mm256_castps256_ps128(rows[3]));
+            store_column_sse4(cull.matrices, first + 4, mask >> 4, col,
+                _mm256_extractf128_ps(rows[0], 1), _mm256_extractf128_ps(rows[1], 1),
+                _mm256_extractf128_ps(rows[2], 1), _mm256_extractf128_ps(rows[3], 1));
+        }
+        for (int bits = mask; bits; bits &= bits - 1) {
+            cull.visible_ids[visible++] = first + __builtin_ctz(bits);
+        }
+    }
+    return visible;
+}
+
+#endif // CUBECULL_X86
+
+static bool supported(CullKernel kernel)
+{
+#ifdef CUBECULL_X86
+    __builtin_cpu_init();
+    switch (kernel) {
+    case CULL_AVX2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case CULL_SSE4:
+        return __builtin_cpu_supports("sse4.1");
+    default:
+        return true;
+    }
+#else
+    return kernel == CULL_SCALAR;
+#endif
+}
+
+static CullKernel best_kernel()
+{
+    for (const CullKernel kernel : {CULL_AVX2, CULL_SSE4}) {
+        if (supported(kernel)) {
+            return kernel;
+        }
+    }
+    return CULL_SCALAR;
+}
+
+static CullKernel current_kernel{best_kernel()};
+
+/**
+ * Frustum culls the `count` tumbling cubes of 08-cubes-instancing on the
+ * CPU, as shader/cubes-cull.comp does on the GPU. Writes the ids of the
+ * visible cubes in order to `visible_ids`, and their model-view-projection
+ * matrices to `matrices` at their ids. The SIMD kernels evaluate sin and
+ * cos as polynomials, so their matrices differ from the scalar kernel's by
+ * rounding only. Returns the number of visible cubes.
+ * `spread` specifies how far cubes move from the center.
+ */
+GLuint frustum_cull_cubes(
+    GLuint count, float spread, const glm::mat4& view_proj, float time,
+    GLuint* visible_ids, glm::mat4* matrices)
+{
+    const CubeCull cull{extract_frustum(view_proj), view_proj, spread, time, visible_ids, matrices};
+    GLuint first{}, visible{};
+#ifdef CUBECULL_X86
+    if (current_kernel == CULL_AVX2) {
+        visible = cull_avx2(cull, count / 8);
+        first = count / 8 * 8;
+    }
+    else if (current_kernel == CULL_SSE4) {
+        visible = cull_sse4(cull, count / 4);
+        first = count / 4 * 4;
+    }
+#endif
+    return cull_scalar(cull, first, count, visible);
+}
+
+CullKernel cull_kernel()
+{
+    return current_kernel;
+}
+
+// Uses `kernel` from now on, if the CPU supports it. Not thread safe.
+bool set_cull_kernel(CullKernel kernel)
+{
+    if (!supported(kernel)) {
+        return false;
+    }
+    current_kernel = kernel;
+    return true;
+}
+
+const char* cull_kernel_name(CullKernel kernel)
+{
+    switch (kernel) {
+    case CULL_AVX2:
+        return "avx2";
+    case CULL_SSE4:
+        return "sse4.1";
+    default:
+        return "scalar";
+    }
+}
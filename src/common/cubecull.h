@@ -0,0 +1,17 @@
+#ifndef CUBECULL_H_INCLUDED
+#define CUBECULL_H_INCLUDED
+
+#include <glm/glm.hpp>
+#include "glad.h"
+
+// Implementations of frustum_cull_cubes(), chosen for the CPU when the program starts
+enum CullKernel : int { CULL_SCALAR, CULL_SSE4, CULL_AVX2 };
+
+extern GLuint frustum_cull_cubes(
+    GLuint count, float spread, const glm::mat4& view_proj, float time,
+    GLuint* visible_ids, glm::mat4* matrices);
+extern CullKernel cull_kernel();
+extern bool set_cull_kernel(CullKernel kernel);
+extern const char* cull_kernel_name(CullKernel kernel);
+
+#endif // CUBECULL_H_INCLUDED
@@ -0,0 +1,134 @@
+#include "glad.h"
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <numeric>
+#include <vector>
+#include "dashed.h"
+#include "scan.h"
+#include "shader.h"
+#include "utils.h"
+
+static void create_programs(DashedPolyline& dp)
+{
+    namespace fs = std::filesystem;
+    dp.program = compile_shaders({
+        fs::canonical(dirname() / ".." / "shader" / "dashed-polyline.vert").c_str(),
+        fs::canonical(dirname() / ".." / "shader" / "dashed-polyline.frag").c_str(),
+    });
+    dp.distance_program = compile_shaders({
+        fs::canonical(dirname() / ".." / "shader" / "dash-distance.comp").c_str(),
+    });
+}
+
+/**
+ * Creates a set of dashed polylines.
+ * `points` specifies the points of all polylines back to back. A point with
+ *     w == 0 separates two polylines, and the dash pattern restarts after it.
+ * `pattern` specifies alternating on and off lengths in pixels, see set_dash_pattern().
+ */
+void create_dashed_polyline(
+    DashedPolyline& dp, const std::vector<glm::vec4>& points,
+    const std::vector<float>& pattern)
+{
+    create_programs(dp);
+
+    dp.num_points = static_cast<GLuint>(points.size());
+    glCreateBuffers(1, &dp.point_ssbo);
+    glNamedBufferStorage(dp.point_ssbo, points.size()*sizeof(*points.data()), points.data(), 0);
+    glCreateBuffers(1, &dp.dist_ssbo);
+    glNamedBufferStorage(dp.dist_ssbo, points.size()*sizeof(GLfloat), nullptr, 0);
+
+    // The scan runs across breaks, so each point subtracts the distance
+    // scanned up to the break before it
+    std::vector<GLuint> starts(points.size());
+    for (GLuint i = 1; i < dp.num_points; i++) {
+        starts[i] = points[i].w == 0.0f ? i : starts[i-1];
+    }
+    glCreateBuffers(1, &dp.start_ssbo);
+    glNamedBufferStorage(dp.start_ssbo, starts.size()*sizeof(GLuint), starts.data(), 0);
+
+    create_scan(dp.scan, dp.num_points);
+    set_dash_pattern(dp, pattern);
+}
+
+/**
+ * Replaces the dash pattern of `dp`.
+ * `pattern` specifies alternating on and off lengths in pixels, starting with on.
+ *     As in SVG, a pattern with an odd number of lengths is repeated once.
+ */
+void set_dash_pattern(DashedPolyline& dp, std::vector<float> pattern)
+{
+    if (pattern.empty()) {
+        pattern = {1.0f, 0.0f}; // solid
+    }
+    if (pattern.size() % 2) {
+        pattern.insert(pattern.end(), pattern.begin(), pattern.end());
+    }
+
+    glDeleteBuffers(1, &dp.pattern_ssbo);
+    glCreateBuffers(1, &dp.pattern_ssbo);
+    glNamedBufferStorage(dp.pattern_ssbo, pattern.size()*sizeof(*pattern.data()), pattern.data(), 0);
+    dp.pattern_count = static_cast<GLuint>(pattern.size());
+    dp.pattern_period = std::accumulate(pattern.begin(), pattern.end(), 0.0f);
+}
+
+// Recompiles the shaders, e.g. after editing them
+void reload_dashed_polyline(DashedPolyline& dp)
+{
+    glDeleteProgram(dp.program);
+    glDeleteProgram(dp.distance_program);
+    create_programs(dp);
+}
+
+/**
+ * Computes the window-space distance along the polylines on the GPU and then
+ * draws them as GL_LINES with vertex pulling, so no per-frame CPU work
+ * depends on the number of points.
+ * `phase` shifts the dash pattern in pixels, e.g. to animate it.
+ * Leaves the dashed polyline program as the current program.
+ */
+void draw_dashed_polyline(
+    const DashedPolyline& dp, const glm::mat4& mvp, glm::vec2 resolution,
+    glm::vec4 color, float phase)
+{
+    if (dp.num_points < 2) {
+        return;
+    }
+
+    // Window-space length of every segment, then their prefix sum
+    const GLuint local_size_x{256}; // must match shader/dash-distance.comp
+    glUseProgram(dp.distance_program);
+    glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(mvp));
+    glUniform2f(1, resolution.x, resolution.y);
+    glUniform1ui(2, dp.num_points);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, dp.point_ssbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, dp.dist_ssbo);
+    glDispatchCompute((dp.num_points + local_size_x - 1) / local_size_x, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    inclusive_scan(dp.scan, dp.dist_ssbo, dp.num_points);
+
+    glUseProgram(dp.program);
+    glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(mvp));
+    glUniform4fv(1, 1, glm::value_ptr(color));
+    glUniform1ui(2, dp.pattern_count);
+    glUniform1f(3, dp.pattern_period);
+    glUniform1f(4, phase);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, dp.point_ssbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, dp.dist_ssbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, dp.pattern_ssbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, dp.start_ssbo);
+    glDrawArrays(GL_LINES, 0, 2 * static_cast<GLsizei>(dp.num_points - 1));
+}
+
+void delete_dashed_polyline(DashedPolyline& dp)
+{
+    delete_scan(dp.scan);
+    glDeleteBuffers(1, &dp.pattern_ssbo);
+    glDeleteBuffers(1, &dp.start_ssbo);
+    glDeleteBuffers(1, &dp.dist_ssbo);
+    glDeleteBuffers(1, &dp.point_ssbo);
+    glDeleteProgram(dp.distance_program);
+    glDeleteProgram(dp.program);
+    dp = DashedPolyline{};
+}
@@ -0,0 +1,34 @@
+#ifndef DASHED_H_INCLUDED
+#define DASHED_H_INCLUDED
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "glad.h"
+#include "scan.h"
+
+// Dashed polylines whose dash pattern runs continuously across vertices.
+// The distance along the polylines is computed on the GPU every frame.
+struct DashedPolyline {
+    GLuint program{};
+    GLuint distance_program{};
+    GLuint point_ssbo{};   // vec4 points, w == 0 breaks the polyline
+    GLuint dist_ssbo{};    // distance along the polyline in pixels
+    GLuint start_ssbo{};   // index of the break before each point, or 0
+    GLuint pattern_ssbo{}; // alternating on and off lengths in pixels
+    GLuint num_points{};
+    GLuint pattern_count{};
+    GLfloat pattern_period{};
+    Scan scan;
+};
+
+extern void create_dashed_polyline(
+    DashedPolyline& dp, const std::vector<glm::vec4>& points,
+    const std::vector<float>& pattern);
+extern void set_dash_pattern(DashedPolyline& dp, std::vector<float> pattern);
+extern void reload_dashed_polyline(DashedPolyline& dp);
+extern void draw_dashed_polyline(
+    const DashedPolyline& dp, const glm::mat4& mvp, glm::vec2 resolution,
+    glm::vec4 color, float phase);
+extern void delete_dashed_polyline(DashedPolyline& dp);
+
+#endif // DASHED_H_INCLUDED
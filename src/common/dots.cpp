@@ -0,0 +1,178 @@
+#include "glad.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fmt/core.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <vector>
+#include "dots.h"
+#include "shader.h"
+#include "utils.h"
+
+const int dot_lod_segments[NUM_DOT_LODS]{8, 16, 30, 64};
+
+static void create_programs(DotRenderer& dr)
+{
+    namespace fs = std::filesystem;
+    dr.program = compile_shaders({
+        fs::canonical(dirname() / ".." / "shader" / "dots.vert").c_str(),
+        fs::canonical(dirname() / ".." / "shader" / "lod.frag").c_str(),
+    });
+    dr.cull_program = compile_shaders({
+        fs::canonical(dirname() / ".." / "shader" / "dots-cull.comp").c_str(),
+    });
+}
+
+// Unit circle fan of a LOD. Since a circle is convex, one of the
+// points on the circle serves as the central vertex of its fan.
+static std::vector<GLfloat> gen_circle(int segments)
+{
+    const float angle{glm::two_pi<float>() / segments};
+    std::vector<GLfloat> vertices;
+    vertices.reserve(2 * segments);
+    for (int i{}; i < segments; i++) {
+        vertices.emplace_back(std::cos(angle * i));
+        vertices.emplace_back(std::sin(angle * i));
+    }
+    return vertices;
+}
+
+// Packs a color with components in [0..1] into RGBA8, as unpackUnorm4x8() expects
+GLuint pack_color(glm::vec4 color)
+{
+    const glm::vec4 c = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+    return static_cast<GLuint>(c.x)
+        | static_cast<GLuint>(c.y) << 8
+        | static_cast<GLuint>(c.z) << 16
+        | static_cast<GLuint>(c.w) << 24;
+}
+
+// Most dots whose buffers fit in one shader storage block and whose ids fit
+// in the instance lists. Mesa commonly allows 128 MB, less than the visible
+// lists of 10 million dots take.
+static GLuint max_dot_capacity()
+{
+    GLint64 max_block_size{};
+    glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &max_block_size);
+    const GLint64 dot_size = std::max<GLint64>(sizeof(Dot), NUM_DOT_LODS*sizeof(GLuint));
+    return static_cast<GLuint>(std::min<GLint64>(max_block_size / dot_size, LOD_MAX_INSTANCES));
+}
+
+/**
+ * Creates a renderer for `dots`. Their number becomes the capacity,
+ * which later calls to update_dots() must not exceed. The capacity is clamped
+ * to what a shader storage block can hold, and only that many dots are drawn.
+ * A renderer without dots draws nothing.
+ */
+void create_dot_renderer(DotRenderer& dr, const std::vector<Dot>& dots)
+{
+    create_programs(dr);
+    if (dots.empty()) {
+        return;
+    }
+
+    dr.capacity = static_cast<GLuint>(dots.size());
+    const GLuint max_capacity = max_dot_capacity();
+    if (dr.capacity > max_capacity) {
+        fmt::print(stderr, "ERROR: {} dots exceed GL_MAX_SHADER_STORAGE_BLOCK_SIZE or the instance ids, drawing {}\n",
+            dr.capacity, max_capacity);
+        dr.capacity = max_capacity;
+    }
+    dr.lods.mode = GL_TRIANGLE_FAN;
+    dr.lods.attribute_sizes = {2};
+    for (int segments : dot_lod_segments) {
+        add_lod_mesh(dr.lods, gen_circle(segments));
+    }
+    upload_lod_group(dr.lods, dr.capacity);
+
+    glCreateBuffers(1, &dr.dot_ssbo);
+    glNamedBufferStorage(dr.dot_ssbo, dr.capacity*sizeof(Dot), nullptr, GL_DYNAMIC_STORAGE_BIT);
+    glCreateBuffers(1, &dr.visible_ssbo);
+    glNamedBufferStorage(dr.visible_ssbo, lod_list_size(dr.lods)*sizeof(GLuint), nullptr, 0);
+
+    update_dots(dr, dots);
+}
+
+// Replaces the dots, e.g. to change their colors
+void update_dots(DotRenderer& dr, const std::vector<Dot>& dots)
+{
+    dr.num_dots = std::min(static_cast<GLuint>(dots.size()), dr.capacity);
+    if (dr.num_dots == 0) {
+        return;
+    }
+    glNamedBufferSubData(dr.dot_ssbo, 0, dr.num_dots*sizeof(Dot), dots.data());
+}
+
+// Recompiles the shaders, e.g. after editing them
+void reload_dot_renderer(DotRenderer& dr)
+{
+    glDeleteProgram(dr.program);
+    glDeleteProgram(dr.cull_program);
+    create_programs(dr);
+}
+
+/**
+ * Culls the dots on the GPU and draws the visible ones, each with the
+ * circle fan that suits its size on screen.
+ * Leaves the dot program as the current program and its VAO bound.
+ */
+void draw_dots(const DotRenderer& dr, const glm::mat4& mvp, glm::vec2 resolution)
+{
+    if (dr.num_dots == 0) {
+        return;
+    }
+
+    reset_lod_commands(dr.lods);
+
+    const GLuint local_size_x{256}; // must match shader/dots-cull.comp
+    glUseProgram(dr.cull_program);
+    glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(mvp));
+    glUniform2f(1, resolution.x, resolution.y);
+    glUniform1ui(2, dr.num_dots);
+    glUniform1ui(3, dr.capacity);
+    glUniform1f(4, dr.min_radius);
+    glUniform3fv(5, 1, glm::value_ptr(dr.lods.lod_radius));
+    glUniform1ui(6, static_cast<GLuint>(dr.lods.meshes.size()));
+    glUniform1f(7, dr.lods.crossfade);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, dr.dot_ssbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, dr.visible_ssbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, dr.lods.command_buffer);
+    glDispatchCompute((dr.num_dots + local_size_x - 1) / local_size_x, 1, 1);
+
+    // The draws below read both the visible lists and the instance counts
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+    glUseProgram(dr.program);
+    glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(mvp));
+    glUniform1i(1, GL_TRUE);
+    draw_lod_group(dr.lods);
+}
+
+// Draws every dot with the 30-segment fan and no culling, for comparison
+void draw_dots_unculled(const DotRenderer& dr, const glm::mat4& mvp)
+{
+    if (dr.num_dots == 0) {
+        return;
+    }
+
+    const LodMesh& mesh = dr.lods.meshes[2];
+
+    glUseProgram(dr.program);
+    glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(mvp));
+    glUniform1i(1, GL_FALSE);
+    glBindVertexArray(dr.lods.vao);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, dr.dot_ssbo);
+    glDrawArraysInstanced(GL_TRIANGLE_FAN, mesh.first, mesh.count, dr.num_dots);
+}
+
+void delete_dot_renderer(DotRenderer& dr)
+{
+    glDeleteBuffers(1, &dr.visible_ssbo);
+    glDeleteBuffers(1, &dr.dot_ssbo);
+    delete_lod_group(dr.lods);
+    glDeleteProgram(dr.cull_program);
+    glDeleteProgram(dr.program);
+    dr = DotRenderer{};
+}
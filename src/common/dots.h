@@ -0,0 +1,43 @@
+#ifndef DOTS_H_INCLUDED
+#define DOTS_H_INCLUDED
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "glad.h"
+#include "lod.h"
+
+// Per-instance dot, laid out as std430 struct Dot in shader/dots.vert
+struct Dot {
+    glm::vec2 position{};
+    GLfloat radius{};  // in world units
+    GLuint color{};    // RGBA8, see pack_color()
+};
+static_assert(sizeof(Dot) == 16, "Dot must match the std430 layout");
+
+// Segments of the circle fans, from coarse to fine
+constexpr int NUM_DOT_LODS{4};
+extern const int dot_lod_segments[NUM_DOT_LODS];
+
+// Dots drawn from an SSBO with GPU culling. A compute pass drops off-screen
+// and sub-pixel dots and sorts the rest into one instance list per fan LOD,
+// which glMultiDrawArraysIndirect then draws without any CPU readback.
+struct DotRenderer {
+    GLuint program{};
+    GLuint cull_program{};
+    LodGroup lods;         // unit circle fans
+    GLuint dot_ssbo{};
+    GLuint visible_ssbo{}; // one list of `capacity` entries per LOD
+    GLuint num_dots{};
+    GLuint capacity{};
+    GLfloat min_radius{0.5f}; // dots smaller than this in pixels are culled
+};
+
+extern GLuint pack_color(glm::vec4 color);
+extern void create_dot_renderer(DotRenderer& dr, const std::vector<Dot>& dots);
+extern void update_dots(DotRenderer& dr, const std::vector<Dot>& dots);
+extern void reload_dot_renderer(DotRenderer& dr);
+extern void draw_dots(const DotRenderer& dr, const glm::mat4& mvp, glm::vec2 resolution);
+extern void draw_dots_unculled(const DotRenderer& dr, const glm::mat4& mvp);
+extern void delete_dot_renderer(DotRenderer& dr);
+
+#endif // DOTS_H_INCLUDED
@@ -0,0 +1,349 @@
+#include <algorithm>
+#include "edges.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define EDGES_X86
+#include <immintrin.h>
+#endif
+
+// Never inside: 0*x + 0*y - 1 < 0
+static void clear_coefficients(EdgeTriangles& triangles, int t)
+{
+    for (int e{}; e < 3; e++) {
+        triangles.a[e][t] = 0.0f;
+        triangles.b[e][t] = 0.0f;
+        triangles.c[e][t] = -1.0f;
+    }
+}
+
+static bool inside_scalar(const EdgeTriangles& triangles, int t, glm::vec2 p)
+{
+    for (int e{}; e < 3; e++) {
+        if (triangles.a[e][t] * p.x + triangles.b[e][t] * p.y + triangles.c[e][t] < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int find_scalar(const EdgeTriangles& triangles, glm::vec2 p)
+{
+    for (int t = triangles.count - 1; t >= 0; t--) {
+        if (inside_scalar(triangles, t, p)) {
+            return t;
+        }
+    }
+    return -1;
+}
+
+static int find_candidates_scalar(const EdgeTriangles& triangles, const int* candidates, int n, glm::vec2 p)
+{
+    int best{-1};
+    for (int i{}; i < n; i++) {
+        if (candidates[i] > best && inside_scalar(triangles, candidates[i], p)) {
+            best = candidates[i];
+        }
+    }
+    return best;
+}
+
+static void points_scalar(const EdgeTriangles& triangles, const glm::vec2* points, int n, std::uint8_t* inside)
+{
+    for (int i{}; i < n; i++) {
+        inside[i] = find_scalar(triangles, points[i]) >= 0;
+    }
+}
+
+#ifdef EDGES_X86
+
+// Bit i of the result is set if triangle t + i contains (x, y), tested 4 at a time
+__attribute__((target("sse4.1")))
+static int block_mask_sse4(const EdgeTriangles& triangles, int t, __m128 x, __m128 y)
+{
+    int mask{};
+    for (int half{}; half < 2; half++) {
+        const int i = t + 4*half;
+        __m128 min{};
+        for (int e{}; e < 3; e++) {
+            const __m128 a = _mm_loadu_ps(&triangles.a[e][i]);
+            const __m128 b = _mm_loadu_ps(&triangles.b[e][i]);
+            const __m128 c = _mm_loadu_ps(&triangles.c[e][i]);
+            const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, x), _mm_mul_ps(b, y)), c);
+            min = e == 0 ? d : _mm_min_ps(min, d);
+        }
+        mask |= _mm_movemask_ps(_mm_cmpge_ps(min, _mm_setzero_ps())) << 4*half;
+    }
+    return mask;
+}
+
+__attribute__((target("sse4.1")))
+static int find_sse4(const EdgeTriangles& triangles, glm::vec2 p)
+{
+    const __m128 x = _mm_set1_ps(p.x);
+    const __m128 y = _mm_set1_ps(p.y);
+    const int blocks = static_cast<int>(triangles.a[0].size()) / EDGE_BLOCK;
+    for (int block = blocks - 1; block >= 0; block--) {
+        const int mask = block_mask_sse4(triangles, block*EDGE_BLOCK, x, y);
+        if (mask) {
+            return block*EDGE_BLOCK + 31 - __builtin_clz(mask);
+        }
+    }
+    return -1;
+}
+
+// Without gathers, the candidates' coefficients are loaded one by one
+__attribute__((target("sse4.1")))
+static int find_candidates_sse4(const EdgeTriangles& triangles, const int* candidates, int n, glm::vec2 p)
+{
+    const __m128 x = _mm_set1_ps(p.x);
+    const __m128 y = _mm_set1_ps(p.y);
+    int best{-1};
+    int i{};
+    for (; i + 4 <= n; i += 4) {
+        const int* ids = candidates + i;
+        __m128 min{};
+        for (int e{}; e < 3; e++) {
+            const float* a = triangles.a[e].data();
+            const float* b = triangles.b[e].data();
+            const float* c = triangles.c[e].data();
+            const __m128 d = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(_mm_setr_ps(a[ids[0]], a[ids[1]], a[ids[2]], a[ids[3]]), x),
+                _mm_mul_ps(_mm_setr_ps(b[ids[0]], b[ids[1]], b[ids[2]], b[ids[3]]), y)),
+                _mm_setr_ps(c[ids[0]], c[ids[1]], c[ids[2]], c[ids[3]]));
+            min = e == 0 ? d : _mm_min_ps(min, d);
+        }
+        for (int mask = _mm_movemask_ps(_mm_cmpge_ps(min, _mm_setzero_ps())); mask; mask &= mask - 1) {
+            best = std::max(best, ids[__builtin_ctz(mask)]);
+        }
+    }
+    return std::max(best, find_candidates_scalar(triangles, candidates + i, n - i, p));
+}
+
+__attribute__((target("sse4.1")))
+static void points_sse4(const EdgeTriangles& triangles, const glm::vec2* points, int n, std::uint8_t* inside)
+{
+    for (int i{}; i < n; i++) {
+        inside[i] = find_sse4(triangles, points[i]) >= 0;
+    }
+}
+
+// Bit i of the result is set if triangle t + i contains (x, y)
+__attribute__((target("avx2,fma")))
+static int block_mask_avx2(const EdgeTriangles& triangles, int t, __m256 x, __m256 y)
+{
+    __m256 min{};
+    for (int e{}; e < 3; e++) {
+        const __m256 a = _mm256_loadu_ps(&triangles.a[e][t]);
+        const __m256 b = _mm256_loadu_ps(&triangles.b[e][t]);
+        const __m256 c = _mm256_loadu_ps(&triangles.c[e][t]);
+        const __m256 d = _mm256_fmadd_ps(a, x, _mm256_fmadd_ps(b, y, c));
+        min = e == 0 ? d : _mm256_min_ps(min, d);
+    }
+    return _mm256_movemask_ps(_mm256_cmp_ps(min, _mm256_setzero_ps(), _CMP_GE_OQ));
+}
+
+__attribute__((target("avx2,fma")))
+static int find_avx2(const EdgeTriangles& triangles, glm::vec2 p)
+{
+    const __m256 x = _mm256_set1_ps(p.x);
+    const __m256 y = _mm256_set1_ps(p.y);
+    const int blocks = static_cast<int>(triangles.a[0].size()) / EDGE_BLOCK;
+    for (int block = blocks - 1; block >= 0; block--) {
+        const int mask = block_mask_avx2(triangles, block*EDGE_BLOCK, x, y);
+        if (mask) {
+            return block*EDGE_BLOCK + 31 - __builtin_clz(mask);
+        }
+    }
+    return -1;
+}
+
+__attribute__((target("avx2,fma")))
+static int find_candidates_avx2(const EdgeTriangles& triangles, const int* candidates, int n, glm::vec2 p)
+{
+    const __m256 x = _mm256_set1_ps(p.x);
+    const __m256 y = _mm256_set1_ps(p.y);
+    int best{-1};
+    int i{};
+    for (; i + EDGE_BLOCK <= n; i += EDGE_BLOCK) {
+        const __m256i ids = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(candidates + i));
+        __m256 min{};
+        for (int e{}; e < 3; e++) {
+            const __m256 a = _mm256_i32gather_ps(triangles.a[e].data(), ids, 4);
+            const __m256 b = _mm256_i32gather_ps(triangles.b[e].data(), ids, 4);
+            const __m256 c = _mm256_i32gather_ps(triangles.c[e].data(), ids, 4);
+            const __m256 d = _mm256_fmadd_ps(a, x, _mm256_fmadd_ps(b, y, c));
+            min = e == 0 ? d : _mm256_min_ps(min, d);
+        }
+        for (int mask = _mm256_movemask_ps(_mm256_cmp_ps(min, _mm256_setzero_ps(), _CMP_GE_OQ)); mask; mask &= mask - 1) {
+            best = std::max(best, candidates[i + __builtin_ctz(mask)]);
+        }
+    }
+    return std::max(best, find_candidates_scalar(triangles, candidates + i, n - i, p));
+}
+
+__attribute__((target("avx2,fma")))
+static void points_avx2(const EdgeTriangles& triangles, const glm::vec2* points, int n, std::uint8_t* inside)
+{
+    for (int i{}; i < n; i++) {
+        inside[i] = find_avx2(triangles, points[i]) >= 0;
+    }
+}
+
+#endif // EDGES_X86
+
+static bool supported(EdgeKernel kernel)
+{
+#ifdef EDGES_X86
+    __builtin_cpu_init();
+    switch (kernel) {
+    case EDGE_AVX2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case EDGE_SSE4:
+        return __builtin_cpu_supports("sse4.1");
+    default:
+        return true;
+    }
+#else
+    return kernel == EDGE_SCALAR;
+#endif
+}
+
+static EdgeKernel best_kernel()
+{
+    for (const EdgeKernel kernel : {EDGE_AVX2, EDGE_SSE4}) {
+        if (supported(kernel)) {
+            return kernel;
+        }
+    }
+    return EDGE_SCALAR;
+}
+
+static EdgeKernel current_kernel{best_kernel()};
+
+/**
+ * Appends a triangle, growing the storage by a block at a time.
+ * Returns its index.
+ */
+int add_edge_triangle(EdgeTriangles& triangles, const glm::vec2 (&vertices)[3])
+{
+    const int t = triangles.count;
+    set_edge_triangle(triangles, t, vertices);
+    return t;
+}
+
+/**
+ * Sets triangle `t` to `vertices`, which may be in either winding order,
+ * adding triangles that contain nothing up to it if needed.
+ */
+void set_edge_triangle(EdgeTriangles& triangles, int t, const glm::vec2 (&vertices)[3])
+{
+    if (t >= triangles.count) {
+        const int size = static_cast<int>(triangles.a[0].size());
+        const int padded = (t / EDGE_BLOCK + 1) * EDGE_BLOCK;
+        for (int e{}; e < 3; e++) {
+            triangles.a[e].resize(std::max(size, padded), 0.0f);
+            triangles.b[e].resize(std::max(size, padded), 0.0f);
+            triangles.c[e].resize(std::max(size, padded), -1.0f);
+        }
+        triangles.count = t + 1;
+    }
+
+    // The edge functions are positive inside, so flip them for a clockwise triangle
+    const glm::vec2 u = vertices[1] - vertices[0];
+    const glm::vec2 v = vertices[2] - vertices[0];
+    const float orientation = u.x * v.y - u.y * v.x < 0.0f ? -1.0f : 1.0f;
+    for (int e{}; e < 3; e++) {
+        const glm::vec2 from = vertices[e];
+        const glm::vec2 to = vertices[(e + 1) % 3];
+        const float a = orientation * (from.y - to.y);
+        const float b = orientation * (to.x - from.x);
+        triangles.a[e][t] = a;
+        triangles.b[e][t] = b;
+        triangles.c[e][t] = -(a * from.x + b * from.y);
+    }
+}
+
+// Makes triangle `t` contain nothing, e.g. once its shape is removed
+void clear_edge_triangle(EdgeTriangles& triangles, int t)
+{
+    clear_coefficients(triangles, t);
+}
+
+// Returns the last triangle that contains `p`, or -1 if none does
+int find_triangle(const EdgeTriangles& triangles, glm::vec2 p)
+{
+#ifdef EDGES_X86
+    if (current_kernel == EDGE_AVX2) {
+        return find_avx2(triangles, p);
+    }
+    if (current_kernel == EDGE_SSE4) {
+        return find_sse4(triangles, p);
+    }
+#endif
+    return find_scalar(triangles, p);
+}
+
+/**
+ * Returns the highest of the `n` triangle indices in `candidates` whose
+ * triangle contains `p`, or -1 if none does. Suits the leaves of a spatial
+ * index that a point falls in.
+ */
+int find_triangle(const EdgeTriangles& triangles, const int* candidates, int n, glm::vec2 p)
+{
+#ifdef EDGES_X86
+    if (current_kernel == EDGE_AVX2) {
+        return find_candidates_avx2(triangles, candidates, n, p);
+    }
+    if (current_kernel == EDGE_SSE4) {
+        return find_candidates_sse4(triangles, candidates, n, p);
+    }
+#endif
+    return find_candidates_scalar(triangles, candidates, n, p);
+}
+
+/**
+ * Sets `inside[i]` to whether any triangle contains `points[i]`, for `n`
+ * points. With a selection rectangle or a lasso as triangles, this selects
+ * the shapes whose positions are in `points`.
+ */
+void points_in_triangles(const EdgeTriangles& triangles, const glm::vec2* points, int n, std::uint8_t* inside)
+{
+#ifdef EDGES_X86
+    if (current_kernel == EDGE_AVX2) {
+        points_avx2(triangles, points, n, inside);
+        return;
+    }
+    if (current_kernel == EDGE_SSE4) {
+        points_sse4(triangles, points, n, inside);
+        return;
+    }
+#endif
+    points_scalar(triangles, points, n, inside);
+}
+
+EdgeKernel edge_kernel()
+{
+    return current_kernel;
+}
+
+// Uses `kernel` from now on, if the CPU supports it. Not thread safe.
+bool set_edge_kernel(EdgeKernel kernel)
+{
+    if (!supported(kernel)) {
+        return false;
+    }
+    current_kernel = kernel;
+    return true;
+}
+
+const char* edge_kernel_name(EdgeKernel kernel)
+{
+    switch (kernel) {
+    case EDGE_AVX2:
+        return "avx2";
+    case EDGE_SSE4:
+        return "sse4.1";
+    default:
+        return "scalar";
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef EDGES_H_INCLUDED
+#define EDGES_H_INCLUDED
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Triangles per block of the SIMD kernels, the storage is padded to it
+constexpr int EDGE_BLOCK{8};
+
+// Triangles as their three edge functions, in structure of arrays. Point p
+// is inside triangle t when a[e][t]*p.x + b[e][t]*p.y + c[e][t] >= 0 for
+// each edge e, whatever the winding, and on its edges too, up to rounding,
+// which differs between kernels. Padding and removed triangles contain no
+// point.
+struct EdgeTriangles {
+    std::vector<float> a[3];
+    std::vector<float> b[3];
+    std::vector<float> c[3];
+    int count{};
+};
+
+// Implementations of the tests, chosen for the CPU when the program starts
+enum EdgeKernel : int { EDGE_SCALAR, EDGE_SSE4, EDGE_AVX2 };
+
+extern int add_edge_triangle(EdgeTriangles& triangles, const glm::vec2 (&vertices)[3]);
+extern void set_edge_triangle(EdgeTriangles& triangles, int t, const glm::vec2 (&vertices)[3]);
+extern void clear_edge_triangle(EdgeTriangles& triangles, int t);
+extern int find_triangle(const EdgeTriangles& triangles, glm::vec2 p);
+extern int find_triangle(const EdgeTriangles& triangles, const int* candidates, int n, glm::vec2 p);
+extern void points_in_triangles(const EdgeTriangles& triangles, const glm::vec2* points, int n, std::uint8_t* inside);
+extern EdgeKernel edge_kernel();
+extern bool set_edge_kernel(EdgeKernel kernel);
+extern const char* edge_kernel_name(EdgeKernel kernel);
+
+#endif // EDGES_H_INCLUDED
@@ -0,0 +1,440 @@
+#include "glad.h"
+#include <algorithm>
+#include <fmt/core.h>
+#include <functional>
+#include <queue>
+#include "framegraph.h"
+
+static std::uint64_t pending_key(const FrameGraphResource& resource)
+{
+    return std::uint64_t{resource.texture} << 32 | resource.object;
+}
+
+static GLuint add_resource(FrameGraph& graph, const FrameGraphResource& resource)
+{
+    graph.resources.emplace_back(resource);
+    FrameGraphResource& added = graph.resources.back();
+    const auto it = graph.pending.find(pending_key(added));
+    if (!added.transient && it != graph.pending.end()) {
+        added.dirty = true;
+        added.covered = it->second;
+    }
+    return static_cast<GLuint>(graph.resources.size()) - 1;
+}
+
+// Declares a texture that lives outside the graph
+GLuint import_texture(FrameGraph& graph, const char* name, GLuint texture)
+{
+    FrameGraphResource resource;
+    resource.name = name;
+    resource.texture = true;
+    resource.object = texture;
+    return add_resource(graph, resource);
+}
+
+// Declares a buffer that lives outside the graph
+GLuint import_buffer(FrameGraph& graph, const char* name, GLuint buffer)
+{
+    FrameGraphResource resource;
+    resource.name = name;
+    resource.object = buffer;
+    return add_resource(graph, resource);
+}
+
+/**
+ * Declares a texture that only lives from the first to the last pass using
+ * it. It may share its storage with other transient textures of the same
+ * description, so its contents are undefined until a pass writes them.
+ */
+GLuint create_transient_texture(FrameGraph& graph, const char* name, const FrameGraphTextureDesc& desc)
+{
+    FrameGraphResource resource;
+    resource.name = name;
+    resource.texture = true;
+    resource.transient = true;
+    resource.desc = desc;
+    return add_resource(graph, resource);
+}
+
+void mark_output(FrameGraph& graph, GLuint resource)
+{
+    graph.resources[resource].output = true;
+}
+
+/**
+ * Declares a pass. `execute` issues its GL commands, and runs with the
+ * pass's framebuffer bound if it has attachments.
+ * Returns the pass id for read_resource() and write_resource().
+ */
+GLuint add_pass(FrameGraph& graph, const char* name, std::function<void()> execute)
+{
+    FrameGraphPass pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+    graph.passes.emplace_back(std::move(pass));
+    return static_cast<GLuint>(graph.passes.size()) - 1;
+}
+
+void read_resource(FrameGraph& graph, GLuint pass, GLuint resource, GLuint access)
+{
+    graph.passes[pass].uses.emplace_back(FrameGraphUse{resource, access, false});
+}
+
+// A pass that also depends on the previous contents, e.g. through atomics
+// or by drawing over them, must read the resource as well
+void write_resource(FrameGraph& graph, GLuint pass, GLuint resource, GLuint access)
+{
+    graph.passes[pass].uses.emplace_back(FrameGraphUse{resource, access, true});
+}
+
+void set_side_effect(FrameGraph& graph, GLuint pass)
+{
+    graph.passes[pass].side_effect = true;
+}
+
+// Valid while the graph executes
+GLuint frame_graph_texture(const FrameGraph& graph, GLuint resource)
+{
+    return graph.resources[resource].object;
+}
+
+// Framebuffer with the attachments of `pass`, valid while the graph executes
+GLuint frame_graph_framebuffer(const FrameGraph& graph, GLuint pass)
+{
+    return graph.pass_framebuffers[pass];
+}
+
+static bool depth_format(GLenum format)
+{
+    return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 ||
+           format == GL_DEPTH_COMPONENT32F || format == GL_DEPTH24_STENCIL8 ||
+           format == GL_DEPTH32F_STENCIL8;
+}
+
+static bool same_desc(const FrameGraphTextureDesc& a, const FrameGraphTextureDesc& b)
+{
+    return a.format == b.format && a.width == b.width && a.height == b.height;
+}
+
+// Barrier bits that make shader writes visible to `access`
+static GLbitfield barrier_bits(const FrameGraphResource& resource, GLuint access)
+{
+    switch (access) {
+    case ACCESS_ATTACHMENT:
+        return GL_FRAMEBUFFER_BARRIER_BIT;
+    case ACCESS_SAMPLED:
+        return GL_TEXTURE_FETCH_BARRIER_BIT;
+    case ACCESS_IMAGE:
+        return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+    case ACCESS_STORAGE:
+        return GL_SHADER_STORAGE_BARRIER_BIT;
+    case ACCESS_INDIRECT:
+        return GL_COMMAND_BARRIER_BIT;
+    case ACCESS_VERTEX:
+        return GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT;
+    case ACCESS_UNIFORM:
+        return GL_UNIFORM_BARRIER_BIT;
+    default:
+        return resource.texture ? GL_TEXTURE_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT :
+                                  GL_BUFFER_UPDATE_BARRIER_BIT;
+    }
+}
+
+// Shader writes are the only writes that GL does not order by itself
+static bool incoherent(GLuint access)
+{
+    return access == ACCESS_IMAGE || access == ACCESS_STORAGE;
+}
+
+/**
+ * Returns the passes to execute in order. A pass depends on the last pass
+ * declared before it that writes a resource it uses, and a writer also on
+ * the readers since that write. Passes that neither have side effects nor
+ * write outputs are culled unless a kept pass reads what they write.
+ */
+static std::vector<GLuint> compile(const FrameGraph& graph, FrameGraphStats& stats)
+{
+    const auto num_passes = static_cast<GLuint>(graph.passes.size());
+    std::vector<std::vector<GLuint>> producers(num_passes);  // read after write
+    std::vector<std::vector<GLuint>> successors(num_passes); // every dependency
+    std::vector<GLint> last_writer(graph.resources.size(), -1);
+    std::vector<std::vector<GLuint>> readers(graph.resources.size());
+
+    for (GLuint p{}; p < num_passes; p++) {
+        for (const bool writes : {false, true}) {
+            for (const FrameGraphUse& use : graph.passes[p].uses) {
+                if (use.write != writes) {
+                    continue;
+                }
+                const GLint writer = last_writer[use.resource];
+                if (writer >= 0 && static_cast<GLuint>(writer) != p) {
+                    successors[writer].emplace_back(p);
+                    if (!writes) {
+                        producers[p].emplace_back(writer);
+                    }
+                }
+                if (!writes) {
+                    readers[use.resource].emplace_back(p);
+                    continue;
+                }
+                for (const GLuint reader : readers[use.resource]) {
+                    if (reader != p) {
+                        successors[reader].emplace_back(p);
+                    }
+                }
+                readers[use.resource].clear();
+                last_writer[use.resource] = p;
+            }
+        }
+    }
+
+    // Producers are declared before their readers, so one backward sweep
+    // propagates liveness
+    std::vector<bool> kept(num_passes);
+    for (GLuint p = num_passes; p-- > 0;) {
+        const FrameGraphPass& pass = graph.passes[p];
+        kept[p] = kept[p] || pass.side_effect || std::any_of(pass.uses.begin(), pass.uses.end(),
+            [&graph](const FrameGraphUse& use) { return use.write && graph.resources[use.resource].output; });
+        if (kept[p]) {
+            for (const GLuint producer : producers[p]) {
+                kept[producer] = true;
+            }
+        }
+    }
+
+    // Kahn's algorithm over the kept passes, preferring declaration order
+    std::vector<GLuint> in_degree(num_passes);
+    for (GLuint p{}; p < num_passes; p++) {
+        for (const GLuint s : successors[p]) {
+            in_degree[s] += kept[p];
+        }
+    }
+    std::priority_queue<GLuint, std::vector<GLuint>, std::greater<GLuint>> ready;
+    for (GLuint p{}; p < num_passes; p++) {
+        if (kept[p] && in_degree[p] == 0) {
+            ready.push(p);
+        }
+        else if (!kept[p]) {
+            stats.culled++;
+        }
+    }
+    std::vector<GLuint> order;
+    while (!ready.empty()) {
+        const GLuint p = ready.top();
+        ready.pop();
+        order.emplace_back(p);
+        for (const GLuint s : successors[p]) {
+            if (kept[s] && --in_degree[s] == 0) {
+                ready.push(s);
+            }
+        }
+    }
+    stats.passes = static_cast<int>(order.size());
+    return order;
+}
+
+static GLuint acquire_texture(FrameGraph& graph, const FrameGraphTextureDesc& desc, FrameGraphStats& stats)
+{
+    for (PooledTexture& pooled : graph.textures) {
+        if (!pooled.busy && same_desc(pooled.desc, desc)) {
+            stats.pooled_textures += !pooled.used;
+            pooled.busy = pooled.used = true;
+            return pooled.texture;
+        }
+    }
+
+    PooledTexture pooled{desc, 0, true, true};
+    glCreateTextures(GL_TEXTURE_2D, 1, &pooled.texture);
+    glTextureStorage2D(pooled.texture, 1, desc.format, desc.width, desc.height);
+    glTextureParameteri(pooled.texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(pooled.texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    graph.textures.emplace_back(pooled);
+    stats.pooled_textures++;
+    return pooled.texture;
+}
+
+static void release_texture(FrameGraph& graph, GLuint texture)
+{
+    for (PooledTexture& pooled : graph.textures) {
+        if (pooled.texture == texture) {
+            pooled.busy = false;
+        }
+    }
+}
+
+static GLuint acquire_framebuffer(FrameGraph& graph, const FrameGraphPass& pass)
+{
+    std::vector<GLuint> attachments;
+    for (const FrameGraphUse& use : pass.uses) {
+        const GLuint texture = graph.resources[use.resource].object;
+        if (use.access == ACCESS_ATTACHMENT &&
+            std::find(attachments.begin(), attachments.end(), texture) == attachments.end()) {
+            attachments.emplace_back(texture);
+        }
+    }
+    if (attachments.empty()) {
+        return 0;
+    }
+
+    for (PooledFramebuffer& pooled : graph.framebuffers) {
+        if (pooled.attachments == attachments) {
+            pooled.used = true;
+            return pooled.fbo;
+        }
+    }
+
+    PooledFramebuffer pooled{attachments, 0, true};
+    glCreateFramebuffers(1, &pooled.fbo);
+    std::vector<GLenum> draw_buffers;
+    for (const FrameGraphUse& use : pass.uses) {
+        const FrameGraphResource& resource = graph.resources[use.resource];
+        if (use.access != ACCESS_ATTACHMENT) {
+            continue;
+        }
+        if (depth_format(resource.desc.format)) {
+            glNamedFramebufferTexture(pooled.fbo, GL_DEPTH_ATTACHMENT, resource.object, 0);
+        }
+        else if (std::find(draw_buffers.begin(), draw_buffers.end(), resource.object) == draw_buffers.end()) {
+            glNamedFramebufferTexture(pooled.fbo, GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(draw_buffers.size()), resource.object, 0);
+            draw_buffers.emplace_back(resource.object);
+        }
+    }
+    for (GLenum i{}; i < draw_buffers.size(); i++) {
+        draw_buffers[i] = GL_COLOR_ATTACHMENT0 + i;
+    }
+    glNamedFramebufferDrawBuffers(pooled.fbo, static_cast<GLsizei>(draw_buffers.size()), draw_buffers.data());
+    if (glCheckNamedFramebufferStatus(pooled.fbo, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fmt::print(stderr, "ERROR: incomplete framebuffer for pass {}\n", pass.name);
+    }
+    graph.framebuffers.emplace_back(pooled);
+    return pooled.fbo;
+}
+
+// Issues one barrier with every bit that the uses of `pass` still need
+static void issue_barriers(FrameGraph& graph, const FrameGraphPass& pass, FrameGraphStats& stats)
+{
+    GLbitfield bits{};
+    for (const FrameGraphUse& use : pass.uses) {
+        const FrameGraphResource& resource = graph.resources[use.resource];
+        if (resource.dirty) {
+            bits |= barrier_bits(resource, use.access) & ~resource.covered;
+        }
+    }
+    if (!bits) {
+        return;
+    }
+
+    glMemoryBarrier(bits);
+    stats.barriers++;
+    for (FrameGraphResource& resource : graph.resources) {
+        resource.covered |= bits;
+    }
+}
+
+/**
+ * Compiles and executes the passes declared since the last execution, then
+ * clears the declarations. Ends with the default framebuffer bound.
+ * Returns what was culled, issued and allocated.
+ */
+FrameGraphStats execute_frame_graph(FrameGraph& graph)
+{
+    FrameGraphStats stats;
+    const std::vector<GLuint> order = compile(graph, stats);
+
+    // Lifetimes of the transient textures, as positions in `order`
+    const auto num_resources = graph.resources.size();
+    std::vector<GLint> first_use(num_resources, -1), last_use(num_resources, -1);
+    for (GLint i{}; i < static_cast<GLint>(order.size()); i++) {
+        for (const FrameGraphUse& use : graph.passes[order[i]].uses) {
+            if (first_use[use.resource] < 0) {
+                first_use[use.resource] = i;
+            }
+            last_use[use.resource] = i;
+        }
+    }
+
+    for (PooledTexture& pooled : graph.textures) {
+        pooled.busy = pooled.used = false;
+    }
+    for (PooledFramebuffer& pooled : graph.framebuffers) {
+        pooled.used = false;
+    }
+    graph.pass_framebuffers.assign(graph.passes.size(), 0);
+
+    for (GLint i{}; i < static_cast<GLint>(order.size()); i++) {
+        const GLuint p = order[i];
+        FrameGraphPass& pass = graph.passes[p];
+
+        for (size_t r{}; r < num_resources; r++) {
+            FrameGraphResource& resource = graph.resources[r];
+            if (resource.transient && first_use[r] == i) {
+                resource.object = acquire_texture(graph, resource.desc, stats);
+                stats.transient_textures++;
+            }
+        }
+
+        issue_barriers(graph, pass, stats);
+        graph.pass_framebuffers[p] = acquire_framebuffer(graph, pass);
+        if (graph.pass_framebuffers[p]) {
+            glBindFramebuffer(GL_FRAMEBUFFER, graph.pass_framebuffers[p]);
+        }
+        pass.execute();
+
+        for (const FrameGraphUse& use : pass.uses) {
+            FrameGraphResource& resource = graph.resources[use.resource];
+            if (use.write && incoherent(use.access)) {
+                resource.dirty = true;
+                resource.covered = 0;
+            }
+        }
+        for (size_t r{}; r < num_resources; r++) {
+            if (graph.resources[r].transient && last_use[r] == i) {
+                release_texture(graph, graph.resources[r].object);
+            }
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // Carry the writes of imported objects that no pass has made visible yet
+    for (const FrameGraphResource& resource : graph.resources) {
+        if (!resource.transient) {
+            if (resource.dirty) {
+                graph.pending[pending_key(resource)] = resource.covered;
+            }
+            else {
+                graph.pending.erase(pending_key(resource));
+            }
+        }
+    }
+
+    // Free what this frame did not use, e.g. textures of the old size after a resize
+    graph.textures.erase(std::remove_if(graph.textures.begin(), graph.textures.end(),
+        [](const PooledTexture& pooled) {
+            if (!pooled.used) {
+                glDeleteTextures(1, &pooled.texture);
+            }
+            return !pooled.used;
+        }), graph.textures.end());
+    graph.framebuffers.erase(std::remove_if(graph.framebuffers.begin(), graph.framebuffers.end(),
+        [](const PooledFramebuffer& pooled) {
+            if (!pooled.used) {
+                glDeleteFramebuffers(1, &pooled.fbo);
+            }
+            return !pooled.used;
+        }), graph.framebuffers.end());
+
+    graph.resources.clear();
+    graph.passes.clear();
+    return stats;
+}
+
+void delete_frame_graph(FrameGraph& graph)
+{
+    for (const PooledTexture& pooled : graph.textures) {
+        glDeleteTextures(1, &pooled.texture);
+    }
+    for (const PooledFramebuffer& pooled : graph.framebuffers) {
+        glDeleteFramebuffers(1, &pooled.fbo);
+    }
+    graph = FrameGraph{};
+}
@@ -0,0 +1,105 @@
+#ifndef FRAMEGRAPH_H_INCLUDED
+#define FRAMEGRAPH_H_INCLUDED
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "glad.h"
+
+// How a pass accesses a resource, which decides the barrier a later pass
+// needs after shader writes to it
+enum FrameGraphAccess : GLuint {
+    ACCESS_ATTACHMENT, // framebuffer attachment, see frame_graph_framebuffer()
+    ACCESS_SAMPLED,    // texture fetches through a sampler
+    ACCESS_IMAGE,      // image load and store
+    ACCESS_STORAGE,    // shader storage buffer, including atomics
+    ACCESS_INDIRECT,   // indirect draw or dispatch commands
+    ACCESS_VERTEX,     // vertex or index buffer
+    ACCESS_UNIFORM,    // uniform buffer
+    ACCESS_TRANSFER,   // glBufferSubData, glCopy*, glGet*SubData, glClear*
+};
+
+struct FrameGraphTextureDesc {
+    GLenum format{GL_RGBA8};
+    GLsizei width{1};
+    GLsizei height{1};
+};
+
+struct FrameGraphResource {
+    std::string name;
+    bool texture{};   // else a buffer
+    bool transient{}; // texture allocated by the graph for the passes that use it
+    bool output{};    // used after the graph, so its writers are never culled
+    FrameGraphTextureDesc desc;
+    GLuint object{};  // GL name, assigned to transient textures on execution
+    bool dirty{};     // has shader writes not yet made visible to every access
+    GLbitfield covered{}; // barrier bits issued since the last shader write
+};
+
+struct FrameGraphUse {
+    GLuint resource{};
+    GLuint access{};
+    bool write{};
+};
+
+struct FrameGraphPass {
+    std::string name;
+    std::vector<FrameGraphUse> uses;
+    std::function<void()> execute;
+    bool side_effect{}; // e.g. presents or reads back, so it is never culled
+};
+
+struct FrameGraphStats {
+    int passes{};
+    int culled{};
+    int barriers{};
+    int transient_textures{};
+    int pooled_textures{};
+};
+
+// Transient texture, possibly shared by transient resources whose lifetimes
+// do not overlap, and kept across frames while it is used
+struct PooledTexture {
+    FrameGraphTextureDesc desc;
+    GLuint texture{};
+    bool busy{};
+    bool used{};
+};
+
+struct PooledFramebuffer {
+    std::vector<GLuint> attachments;
+    GLuint fbo{};
+    bool used{};
+};
+
+// Passes of one frame that declare the textures and buffers they read and
+// write. Executing the graph culls the passes whose results nothing uses,
+// orders the rest by their dependencies, assigns the transient textures from
+// a pool by lifetime, and issues the glMemoryBarrier calls that the shader
+// writes of a pass require for the accesses of the passes after it.
+// Declarations are cleared after every execution, the pools are kept.
+struct FrameGraph {
+    std::vector<FrameGraphResource> resources;
+    std::vector<FrameGraphPass> passes;
+    std::vector<GLuint> pass_framebuffers;
+    std::vector<PooledTexture> textures;
+    std::vector<PooledFramebuffer> framebuffers;
+    std::unordered_map<std::uint64_t, GLbitfield> pending; // imported objects still dirty after the last frame
+};
+
+extern GLuint import_texture(FrameGraph& graph, const char* name, GLuint texture);
+extern GLuint import_buffer(FrameGraph& graph, const char* name, GLuint buffer);
+extern GLuint create_transient_texture(FrameGraph& graph, const char* name, const FrameGraphTextureDesc& desc);
+extern void mark_output(FrameGraph& graph, GLuint resource);
+extern GLuint add_pass(FrameGraph& graph, const char* name, std::function<void()> execute);
+extern void read_resource(FrameGraph& graph, GLuint pass, GLuint resource, GLuint access);
+extern void write_resource(FrameGraph& graph, GLuint pass, GLuint resource, GLuint access);
+extern void set_side_effect(FrameGraph& graph, GLuint pass);
+extern GLuint frame_graph_texture(const FrameGraph& graph, GLuint resource);
+extern GLuint frame_graph_framebuffer(const FrameGraph& graph, GLuint pass);
+extern FrameGraphStats execute_frame_graph(FrameGraph& graph);
+extern void delete_frame_graph(FrameGraph& graph);
+
+#endif // FRAMEGRAPH_H_INCLUDED
@@ -0,0 +1,38 @@
+#include <glm/glm.hpp>
+#include "frustum.h"
+
+/**
+ * Extracts the world-space planes of the view frustum from a
+ * view-projection matrix (Gribb and Hartmann), normalized so that
+ * plane distances are in world units.
+ */
+Frustum extract_frustum(const glm::mat4& view_proj)
+{
+    // glm is column-major, so view_proj[c][r] is row r, column c
+    const auto row = [&](int r) {
+        return glm::vec4{view_proj[0][r], view_proj[1][r], view_proj[2][r], view_proj[3][r]};
+    };
+
+    Frustum frustum;
+    frustum.planes[0] = row(3) + row(0); // left
+    frustum.planes[1] = row(3) - row(0); // right
+    frustum.planes[2] = row(3) + row(1); // bottom
+    frustum.planes[3] = row(3) - row(1); // top
+    frustum.planes[4] = row(3) + row(2); // near
+    frustum.planes[5] = row(3) - row(2); // far
+    for (glm::vec4& plane : frustum.planes) {
+        plane /= glm::length(glm::vec3{plane});
+    }
+    return frustum;
+}
+
+// Returns false only if the sphere lies entirely outside one of the planes
+bool sphere_in_frustum(const Frustum& frustum, glm::vec3 center, float radius)
+{
+    for (const glm::vec4& plane : frustum.planes) {
+        if (glm::dot(glm::vec3{plane}, center) + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,15 @@
+#ifndef FRUSTUM_H_INCLUDED
+#define FRUSTUM_H_INCLUDED
+
+#include <glm/glm.hpp>
+
+// Six planes (a, b, c, d) with a*x + b*y + c*z + d >= 0 inside the frustum,
+// in the order left, right, bottom, top, near, far
+struct Frustum {
+    glm::vec4 planes[6]{};
+};
+
+extern Frustum extract_frustum(const glm::mat4& view_proj);
+extern bool sphere_in_frustum(const Frustum& frustum, glm::vec3 center, float radius);
+
+#endif // FRUSTUM_H_INCLUDED
@@ -0,0 +1,83 @@
+#include "glad.h"
+#include "glstate.h"
+
+// Forgets the shadowed values, so that the next setters call GL
+void invalidate_gl_state(GlState& state)
+{
+    state.valid = false;
+}
+
+// Makes every shadowed value known by setting it in GL once
+static void validate(GlState& state)
+{
+    if (state.valid) {
+        return;
+    }
+    state.valid = true;
+    glUseProgram(state.program);
+    glBindVertexArray(state.vao);
+    glPolygonMode(GL_FRONT_AND_BACK, state.polygon_mode);
+    state.depth_test ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
+    state.blend ? glEnable(GL_BLEND) : glDisable(GL_BLEND);
+    state.changes += 5;
+}
+
+void use_program(GlState& state, GLuint program)
+{
+    validate(state);
+    if (state.program == program) {
+        state.redundant++;
+        return;
+    }
+    state.program = program;
+    glUseProgram(program);
+    state.changes++;
+}
+
+void bind_vertex_array(GlState& state, GLuint vao)
+{
+    validate(state);
+    if (state.vao == vao) {
+        state.redundant++;
+        return;
+    }
+    state.vao = vao;
+    glBindVertexArray(vao);
+    state.changes++;
+}
+
+void set_polygon_mode(GlState& state, GLenum mode)
+{
+    validate(state);
+    if (state.polygon_mode == mode) {
+        state.redundant++;
+        return;
+    }
+    state.polygon_mode = mode;
+    glPolygonMode(GL_FRONT_AND_BACK, mode);
+    state.changes++;
+}
+
+void set_depth_test(GlState& state, bool enable)
+{
+    validate(state);
+    if (state.depth_test == enable) {
+        state.redundant++;
+        return;
+    }
+    state.depth_test = enable;
+    enable ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
+    state.changes++;
+}
+
+void set_blend(GlState& state, bool enable)
+{
+    validate(state);
+    if (state.blend == enable) {
+        state.redundant++;
+        return;
+    }
+    state.blend = enable;
+    enable ? glEnable(GL_BLEND) : glDisable(GL_BLEND);
+    state.changes++;
+}
@@ -0,0 +1,27 @@
+#ifndef GLSTATE_H_INCLUDED
+#define GLSTATE_H_INCLUDED
+
+#include "glad.h"
+
+// Shadow copy of the GL state that draw submission changes most often.
+// Each setter only calls GL when the value differs from the shadowed one.
+// Call invalidate_gl_state() after changing the same state behind its back.
+struct GlState {
+    bool valid{};
+    GLuint program{};
+    GLuint vao{};
+    GLenum polygon_mode{GL_FILL};
+    bool depth_test{};
+    bool blend{};
+    int changes{};   // GL calls made
+    int redundant{}; // GL calls skipped
+};
+
+extern void invalidate_gl_state(GlState& state);
+extern void use_program(GlState& state, GLuint program);
+extern void bind_vertex_array(GlState& state, GLuint vao);
+extern void set_polygon_mode(GlState& state, GLenum mode);
+extern void set_depth_test(GlState& state, bool enable);
+extern void set_blend(GlState& state, bool enable);
+
+#endif // GLSTATE_H_INCLUDED
@@ -0,0 +1,1006 @@
+#include "glad.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fmt/core.h>
+#include <fstream>
+#include <GLFW/glfw3.h>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "gltrace.h"
+
+// Every traced GL function, with how to record its result and each of its
+// arguments. Functions that are not listed still work while tracing, but
+// are missing from the trace, so list the ones a demo starts to use.
+#define GL_TRACED_CALLS(CALL) \
+    CALL(AttachShader, NoResult, Name<TRACE_PROGRAM>, Name<TRACE_PROGRAM>) \
+    CALL(BeginQuery, NoResult, Value, Name<TRACE_QUERY>) \
+    CALL(BindBuffer, NoResult, Value, Name<TRACE_BUFFER>) \
+    CALL(BindBufferBase, NoResult, Value, Value, Name<TRACE_BUFFER>) \
+    CALL(BindFramebuffer, NoResult, Value, Name<TRACE_FRAMEBUFFER>) \
+    CALL(BindImageTexture, NoResult, Value, Name<TRACE_TEXTURE>, Value, Value, Value, Value, Value) \
+    CALL(BindTextureUnit, NoResult, Value, Name<TRACE_TEXTURE>) \
+    CALL(BindVertexArray, NoResult, Name<TRACE_VERTEX_ARRAY>) \
+    CALL(BlitNamedFramebuffer, NoResult, Name<TRACE_FRAMEBUFFER>, Name<TRACE_FRAMEBUFFER>, \
+        Value, Value, Value, Value, Value, Value, Value, Value, Value, Value) \
+    CALL(BufferData, NoResult, Value, Value, Bytes<1>, Value) \
+    CALL(CheckNamedFramebufferStatus, NoResult, Name<TRACE_FRAMEBUFFER>, Value) \
+    CALL(Clear, NoResult, Value) \
+    CALL(ClearBufferfv, NoResult, Value, Value, ClearValue) \
+    CALL(ClearBufferuiv, NoResult, Value, Value, ClearValue) \
+    CALL(ClearColor, NoResult, Value, Value, Value, Value) \
+    CALL(ClientWaitSync, NoResult, Sync, Value, Value) \
+    CALL(CompileShader, NoResult, Name<TRACE_PROGRAM>) \
+    CALL(CopyNamedBufferSubData, NoResult, Name<TRACE_BUFFER>, Name<TRACE_BUFFER>, Value, Value, Value) \
+    CALL(CreateBuffers, NoResult, Value, NewNames<TRACE_BUFFER, 0>) \
+    CALL(CreateFramebuffers, NoResult, Value, NewNames<TRACE_FRAMEBUFFER, 0>) \
+    CALL(CreateProgram, NewName<TRACE_PROGRAM>) \
+    CALL(CreateQueries, NoResult, Value, Value, NewNames<TRACE_QUERY, 1>) \
+    CALL(CreateRenderbuffers, NoResult, Value, NewNames<TRACE_RENDERBUFFER, 0>) \
+    CALL(CreateShader, NewName<TRACE_PROGRAM>, Value) \
+    CALL(CreateTextures, NoResult, Value, Value, NewNames<TRACE_TEXTURE, 1>) \
+    CALL(CreateVertexArrays, NoResult, Value, NewNames<TRACE_VERTEX_ARRAY, 0>) \
+    CALL(DeleteBuffers, NoResult, Value, DeletedNames<TRACE_BUFFER, 0>) \
+    CALL(DeleteFramebuffers, NoResult, Value, DeletedNames<TRACE_FRAMEBUFFER, 0>) \
+    CALL(DeleteProgram, NoResult, Name<TRACE_PROGRAM>) \
+    CALL(DeleteQueries, NoResult, Value, DeletedNames<TRACE_QUERY, 0>) \
+    CALL(DeleteRenderbuffers, NoResult, Value, DeletedNames<TRACE_RENDERBUFFER, 0>) \
+    CALL(DeleteShader, NoResult, Name<TRACE_PROGRAM>) \
+    CALL(DeleteSync, NoResult, Sync) \
+    CALL(DeleteTextures, NoResult, Value, DeletedNames<TRACE_TEXTURE, 0>) \
+    CALL(DeleteVertexArrays, NoResult, Value, DeletedNames<TRACE_VERTEX_ARRAY, 0>) \
+    CALL(DepthFunc, NoResult, Value) \
+    CALL(Disable, NoResult, Value) \
+    CALL(DispatchCompute, NoResult, Value, Value, Value) \
+    CALL(DrawArrays, NoResult, Value, Value, Value) \
+    CALL(DrawArraysInstanced, NoResult, Value, Value, Value, Value) \
+    CALL(DrawElements, NoResult, Value, Value, Value, Value) \
+    CALL(DrawElementsBaseVertex, NoResult, Value, Value, Value, Value, Value) \
+    CALL(DrawElementsInstanced, NoResult, Value, Value, Value, Value, Value) \
+    CALL(Enable, NoResult, Value) \
+    CALL(EnableVertexArrayAttrib, NoResult, Name<TRACE_VERTEX_ARRAY>, Value) \
+    CALL(EnableVertexAttribArray, NoResult, Value) \
+    CALL(EndQuery, NoResult, Value) \
+    CALL(FenceSync, NewSync, Value, Value) \
+    CALL(Finish, NoResult) \
+    CALL(Flush, NoResult) \
+    CALL(GenBuffers, NoResult, Value, NewNames<TRACE_BUFFER, 0>) \
+    CALL(GenVertexArrays, NoResult, Value, NewNames<TRACE_VERTEX_ARRAY, 0>) \
+    CALL(GetInteger64v, NoResult, Value, Out<-1>) \
+    CALL(GetIntegerv, NoResult, Value, Out<-1>) \
+    CALL(GetNamedBufferSubData, NoResult, Name<TRACE_BUFFER>, Value, Value, Out<2>) \
+    CALL(GetProgramInfoLog, NoResult, Name<TRACE_PROGRAM>, Value, Out<-1>, Out<1>) \
+    CALL(GetProgramiv, NoResult, Name<TRACE_PROGRAM>, Value, Out<-1>) \
+    CALL(GetQueryObjectiv, NoResult, Name<TRACE_QUERY>, Value, Out<-1>) \
+    CALL(GetQueryObjectui64v, NoResult, Name<TRACE_QUERY>, Value, Out<-1>) \
+    CALL(GetShaderInfoLog, NoResult, Name<TRACE_PROGRAM>, Value, Out<-1>, Out<1>) \
+    CALL(GetShaderiv, NoResult, Name<TRACE_PROGRAM>, Value, Out<-1>) \
+    CALL(GetUniformLocation, NewLocation, Name<TRACE_PROGRAM>, String) \
+    CALL(LinkProgram, NoResult, Name<TRACE_PROGRAM>) \
+    CALL(MapNamedBufferRange, NewMapping, Name<TRACE_BUFFER>, Value, Value, Value) \
+    CALL(MemoryBarrier, NoResult, Value) \
+    CALL(MultiDrawArrays, NoResult, Value, Array<3, 1>, Array<3, 1>, Value) \
+    CALL(MultiDrawArraysIndirect, NoResult, Value, Value, Value, Value) \
+    CALL(MultiDrawElementsIndirect, NoResult, Value, Value, Value, Value, Value) \
+    CALL(NamedBufferStorage, NoResult, Name<TRACE_BUFFER>, Value, Bytes<1>, Value) \
+    CALL(NamedBufferSubData, NoResult, Name<TRACE_BUFFER>, Value, Value, Bytes<2>) \
+    CALL(NamedFramebufferDrawBuffers, NoResult, Name<TRACE_FRAMEBUFFER>, Value, Array<1, 1>) \
+    CALL(NamedFramebufferReadBuffer, NoResult, Name<TRACE_FRAMEBUFFER>, Value) \
+    CALL(NamedFramebufferRenderbuffer, NoResult, Name<TRACE_FRAMEBUFFER>, Value, Value, Name<TRACE_RENDERBUFFER>) \
+    CALL(NamedFramebufferTexture, NoResult, Name<TRACE_FRAMEBUFFER>, Value, Name<TRACE_TEXTURE>, Value) \
+    CALL(NamedRenderbufferStorage, NoResult, Name<TRACE_RENDERBUFFER>, Value, Value, Value) \
+    CALL(PixelStorei, NoResult, Value, Value) \
+    CALL(PointSize, NoResult, Value) \
+    CALL(PolygonMode, NoResult, Value, Value) \
+    CALL(ProgramUniform1f, NoResult, Name<TRACE_PROGRAM>, Location<0>, Value) \
+    CALL(ProgramUniform2f, NoResult, Name<TRACE_PROGRAM>, Location<0>, Value, Value) \
+    CALL(ProgramUniformMatrix4fv, NoResult, Name<TRACE_PROGRAM>, Location<0>, Value, Value, Array<2, 16>) \
+    CALL(QueryCounter, NoResult, Name<TRACE_QUERY>, Value) \
+    CALL(ReadPixels, NoResult, Value, Value, Value, Value, Value, Value, PackPixels) \
+    CALL(Scissor, NoResult, Value, Value, Value, Value) \
+    CALL(ShaderSource, NoResult, Name<TRACE_PROGRAM>, Value, Sources, SourceLengths) \
+    CALL(TextureParameteri, NoResult, Name<TRACE_TEXTURE>, Value, Value) \
+    CALL(TextureStorage2D, NoResult, Name<TRACE_TEXTURE>, Value, Value, Value, Value) \
+    CALL(Uniform1f, NoResult, Location<-1>, Value) \
+    CALL(Uniform1i, NoResult, Location<-1>, Value) \
+    CALL(Uniform1ui, NoResult, Location<-1>, Value) \
+    CALL(Uniform2f, NoResult, Location<-1>, Value, Value) \
+    CALL(Uniform3f, NoResult, Location<-1>, Value, Value, Value) \
+    CALL(Uniform3fv, NoResult, Location<-1>, Value, Array<1, 3>) \
+    CALL(Uniform4fv, NoResult, Location<-1>, Value, Array<1, 4>) \
+    CALL(UniformMatrix4fv, NoResult, Location<-1>, Value, Value, Array<1, 16>) \
+    CALL(UnmapNamedBuffer, NoResult, UnmappedBuffer) \
+    CALL(UseProgram, NoResult, UsedProgram) \
+    CALL(ValidateProgram, NoResult, Name<TRACE_PROGRAM>) \
+    CALL(VertexArrayAttribBinding, NoResult, Name<TRACE_VERTEX_ARRAY>, Value, Value) \
+    CALL(VertexArrayAttribFormat, NoResult, Name<TRACE_VERTEX_ARRAY>, Value, Value, Value, Value, Value) \
+    CALL(VertexArrayElementBuffer, NoResult, Name<TRACE_VERTEX_ARRAY>, Name<TRACE_BUFFER>) \
+    CALL(VertexArrayVertexBuffer, NoResult, Name<TRACE_VERTEX_ARRAY>, Value, Name<TRACE_BUFFER>, Value, Value) \
+    CALL(VertexAttribPointer, NoResult, Value, Value, Value, Value, Value, Value) \
+    CALL(Viewport, NoResult, Value, Value, Value, Value) \
+    CALL(WaitSync, NoResult, Sync, Value, Value)
+
+enum CallId : std::uint16_t {
+#define CALL_ID(name, ...) CALL_##name,
+    GL_TRACED_CALLS(CALL_ID)
+#undef CALL_ID
+    CALL_MAPPED_WRITE, // changes to a buffer mapped for writing
+    CALL_FRAME,        // trace_frame()
+    CALL_COUNT
+};
+
+static const char* const call_names[]{
+#define CALL_NAME(name, ...) "gl" #name,
+    GL_TRACED_CALLS(CALL_NAME)
+#undef CALL_NAME
+    "(mapped write)",
+    "(frame)",
+};
+
+constexpr char TRACE_MAGIC[4]{'G', 'L', 'T', 'R'};
+constexpr std::uint32_t TRACE_VERSION{1};
+constexpr std::size_t TRACE_FLUSH_SIZE{1 << 20}; // bytes buffered before writing them out
+constexpr std::size_t MAPPED_BLOCK{4096};        // granularity of the mapped write diffs
+
+struct GlTraceHeader {
+    char magic[4]{};
+    std::uint32_t version{};
+    std::int32_t width{}, height{};
+};
+
+// A buffer range mapped for writing. The application writes it behind the
+// GL's back, so its changes are found by comparing it with a copy before
+// each call that may read it.
+struct TracedMapping {
+    GLuint buffer{};
+    const char* pointer{};
+    std::size_t length{};
+    std::vector<char> shadow; // contents in the trace, empty until first written
+};
+
+struct TraceWriter {
+    bool active{};
+    bool discarded{};                 // after a call from another context
+    GLFWwindow* context{};            // current when the trace started, the only one traced
+    std::atomic<bool> other_context{}; // set by the first call from any other context
+    std::string path;
+    std::ofstream file;
+    std::vector<char> buffer;        // records not yet written to the file
+    std::uint64_t offset{};          // bytes written to the file
+    std::vector<TracedMapping> mappings;
+    long long calls{};
+    long long frames{};
+    PFNGLGETINTEGERVPROC get_integer{}; // untraced
+};
+
+static TraceWriter writer;
+
+template <typename T>
+static void put(const T& value)
+{
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    writer.buffer.insert(writer.buffer.end(), bytes, bytes + sizeof(T));
+}
+
+// Writes `size` bytes at a file offset aligned to 8, so that a replay can
+// pass them to the GL straight from the loaded file
+static void put_payload(const void* data, std::size_t size)
+{
+    while ((writer.offset + writer.buffer.size()) % 8 != 0) {
+        writer.buffer.push_back(0);
+    }
+    const char* bytes = static_cast<const char*>(data);
+    writer.buffer.insert(writer.buffer.end(), bytes, bytes + size);
+}
+
+// Reads what put() wrote, or moves past the end of a corrupt trace
+template <typename T>
+static T get(GlTrace& trace)
+{
+    T value{};
+    if (trace.position + sizeof(T) > trace.data.size()) {
+        trace.position = trace.data.size() + 1;
+        return value;
+    }
+    std::memcpy(&value, trace.data.data() + trace.position, sizeof(T));
+    trace.position += sizeof(T);
+    return value;
+}
+
+static const char* get_payload(GlTrace& trace, std::size_t size)
+{
+    const std::size_t start = (trace.position + 7) & ~std::size_t{7};
+    if (start + size > trace.data.size()) {
+        trace.position = trace.data.size() + 1;
+        return nullptr;
+    }
+    trace.position = start + size;
+    trace.payload_bytes += size;
+    return trace.data.data() + start;
+}
+
+// Memory for an output of the call being replayed, none while only parsing
+static char* scratch(GlTrace& trace, std::size_t size)
+{
+    if (!trace.execute) {
+        return nullptr;
+    }
+    return trace.scratch.emplace_back(size).data();
+}
+
+static GLuint replay_name(const GlTrace& trace, GlTraceNames kind, GLuint recorded)
+{
+    if (recorded == 0) {
+        return kind == TRACE_FRAMEBUFFER ? trace.default_framebuffer : 0;
+    }
+    const auto it = trace.names[kind].find(recorded);
+    return it != trace.names[kind].end() ? it->second : recorded;
+}
+
+// Deletes the trace, which could not replay the calls of the contexts it
+// left out, and records nothing more until stop_gl_trace()
+static void discard_trace()
+{
+    writer.file.close();
+    std::filesystem::remove(writer.path);
+    writer.buffer.clear();
+    writer.mappings.clear();
+    writer.discarded = true;
+    fmt::print(stderr, "ERROR: GL calls from a second context cannot be traced, deleted {}\n", writer.path);
+}
+
+// Whether the calls being made go into the trace. A trace records the
+// context that was current when it started, on whichever thread the
+// context is current now, and the GL calls of any other context end it,
+// rather than race with it on the writer.
+static bool traced_context()
+{
+    if (glfwGetCurrentContext() != writer.context) {
+        writer.other_context = true;
+        return false;
+    }
+    if (writer.other_context && !writer.discarded) {
+        discard_trace();
+    }
+    return !writer.discarded;
+}
+
+static void forget_mapping(GLuint buffer)
+{
+    writer.mappings.erase(
+        std::remove_if(writer.mappings.begin(), writer.mappings.end(),
+            [buffer](const TracedMapping& mapping) { return mapping.buffer == buffer; }),
+        writer.mappings.end());
+}
+
+static void put_mapped_write(TracedMapping& mapping, std::size_t offset, std::size_t length)
+{
+    put(static_cast<std::uint16_t>(CALL_MAPPED_WRITE));
+    put(mapping.buffer);
+    put(static_cast<std::uint64_t>(offset));
+    put(static_cast<std::uint64_t>(length));
+    put_payload(mapping.pointer + offset, length);
+    std::memcpy(mapping.shadow.data() + offset, mapping.pointer + offset, length);
+}
+
+// Writes the blocks of mapped buffers that changed since they were last written
+static void put_mapped_changes()
+{
+    for (TracedMapping& mapping : writer.mappings) {
+        if (mapping.shadow.empty()) {
+            mapping.shadow.resize(mapping.length);
+            put_mapped_write(mapping, 0, mapping.length);
+            continue;
+        }
+        std::size_t start{};
+        bool dirty{};
+        for (std::size_t block{}; block < mapping.length; block += MAPPED_BLOCK) {
+            const std::size_t size = std::min(MAPPED_BLOCK, mapping.length - block);
+            const bool changed = std::memcmp(mapping.pointer + block, mapping.shadow.data() + block, size) != 0;
+            if (changed && !dirty) {
+                start = block;
+                dirty = true;
+            }
+            else if (!changed && dirty) {
+                put_mapped_write(mapping, start, block - start);
+                dirty = false;
+            }
+        }
+        if (dirty) {
+            put_mapped_write(mapping, start, mapping.length - start);
+        }
+    }
+}
+
+static void replay_mapped_write(GlTrace& trace)
+{
+    const GLuint buffer = replay_name(trace, TRACE_BUFFER, get<GLuint>(trace));
+    const auto offset = get<std::uint64_t>(trace);
+    const auto length = get<std::uint64_t>(trace);
+    const char* data = get_payload(trace, length);
+    const auto it = trace.mappings.find(buffer);
+    if (trace.execute && it != trace.mappings.end()) {
+        std::memcpy(it->second + offset, data, length);
+    }
+}
+
+// Calls before which the GL may read mapped buffers
+static bool reads_mapped_buffers(CallId call)
+{
+    switch (call) {
+    case CALL_CopyNamedBufferSubData:
+    case CALL_DeleteBuffers:
+    case CALL_DispatchCompute:
+    case CALL_DrawArrays:
+    case CALL_DrawArraysInstanced:
+    case CALL_DrawElements:
+    case CALL_DrawElementsBaseVertex:
+    case CALL_DrawElementsInstanced:
+    case CALL_FenceSync:
+    case CALL_Finish:
+    case CALL_Flush:
+    case CALL_MemoryBarrier:
+    case CALL_MultiDrawArrays:
+    case CALL_MultiDrawArraysIndirect:
+    case CALL_MultiDrawElementsIndirect:
+    case CALL_UnmapNamedBuffer:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool is_draw(CallId call)
+{
+    switch (call) {
+    case CALL_DrawArrays:
+    case CALL_DrawArraysInstanced:
+    case CALL_DrawElements:
+    case CALL_DrawElementsBaseVertex:
+    case CALL_DrawElementsInstanced:
+    case CALL_MultiDrawArrays:
+    case CALL_MultiDrawArraysIndirect:
+    case CALL_MultiDrawElementsIndirect:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// How a call records an argument, and how a replay gets it back. write()
+// runs after the call, so that outputs are filled in, and after() after
+// the replayed call. Both see all the arguments, for sizes and names.
+struct Value {
+    template <typename A, typename Args>
+    static void write(A value, const Args&) { put(value); }
+    template <typename A, typename Args>
+    static A read(GlTrace& trace, const Args&) { return get<A>(trace); }
+    template <typename A, typename Args>
+    static void after(GlTrace&, const Args&, A) {}
+};
+
+template <GlTraceNames Kind>
+struct Name : Value {
+    template <typename A, typename Args>
+    static A read(GlTrace& trace, const Args&) { return replay_name(trace, Kind, get<GLuint>(trace)); }
+};
+
+struct UsedProgram : Value {
+    template <typename A, typename Args>
+    static A read(GlTrace& trace, const Args&)
+    {
+        trace.program = replay_name(trace, TRACE_PROGRAM, get<GLuint>(trace));
+        return trace.program;
+    }
+};
+
+// Names made by glCreate*() or glGen*(), `CountIndex` the argument with their number
+template <GlTraceNames Kind, int CountIndex>
+struct NewNames : Value {
+    template <typename A, typename Args>
+    static void write(A names, const Args& args) { put_payload(names, std::get<CountIndex>(args) * sizeof(GLuint)); }
+
+    // Returns room for the new names, followed by the recorded ones
+    template <typename A, typename Args>
+    static A read(GlTrace& trace, const Args& args)
+    {
+        const std::size_t n = std::get<CountIndex>(args);
+        const char* recorded = get_payload(trace, n * sizeof(GLuint));
+        GLuint* names = reinterpret_cast<GLuint*>(scratch(trace, 2 * n * sizeof(GLuint)));
+        if (names && recorded) {
+            std::memcpy(names + n, recorded, n * sizeof(GLuint));
+        }
+        return names;
+    }
+
+    template <typename A, typename Args>
+    static void after(GlTrace& trace, const Args& args, A names)
+    {
+        const std::size_t n = std::get<CountIndex>(args);
+        for (std::size_t i{}; i < n; i++) {
+            trace.names[Kind][names[n + i]] = names[i];
+        }
+    }
+};
+
+template <GlTraceNames Kind, int CountIndex>
+struct DeletedNames : Value {
+    template <typename A, typename Args>
+    static void write(A names, const Args& args)
+    {
+        const std::size_t n = std::get<CountIndex>(args);
+        put_payload(names, n * sizeof(GLuint));
+        for (std::size_t i{}; Kind == TRACE_BUFFER && i < n; i++) {
+            forget_mapping(names[i]);
+        }
+    }
+
+    // Returns the names to delete, followed by the recorded ones
+    template <typename A, typename Args>
+    static A read(GlTrace& trace, const Args& args)
+    {
+        const std::size_t n = std::get<CountIndex>(args);
+        const GLuint* recorded = reinterpret_cast<const GLuint*>(get_payload(trace, n * sizeof(GLuint)));
+        GLuint* names = reinterpret_cast<GLuint*>(scratch(trace, 2 * n * sizeof(GLuint)));
+        for (std::size_t i{}; names && recorded && i < n; i++) {
+            names[i] = replay_name(trace, Kind, recorded[i]);
+            names[n + i] = recorded[i];
+        }
+        return names;
+    }
+
+    template <typename A, typename Args>
+    static void after(GlTrace& trace, const Args& args, A names)
+    {
+        const std::size_t n = std::get<CountIndex>(args);
+        for (std::size_t i{}; i < n; i++) {
+            trace.names[Kind].erase(names[n + i]);
+            if (Kind == TRACE_BUFFER) {
+                trace.mappings.erase(names[i]);
+            }
+        }
+    }
+};
+
+// `Count` times the argument `CountIndex` elements, or just `Count` if it is -1
+template <int CountIndex, int Count>
+struct Array : Value {
+    template <typename Args>
+    static std::size_t count(const Args& args)
+    {
+        if constexpr (CountIndex < 0) {
+            return Count;
+        }
+        else {
+            return std::get<CountIndex>(args) * Count;
+        }
+    }
+
+    template <typename A, typename Args>
+    static void write(A values, const Args& args) { put_payload(values, count(args) * sizeof(*values)); }
+    template <typename A, typename Args>
+    static A read(GlTrace& trace, const Args& args)
+    {
+        return reinterpret_cast<A>(get_payload(trace, count(args) * sizeof(*A{})));
+    }
+};
+
+// The value of glClearBuffer*v(), whose size depends on the buffer cleared
+struct ClearValue : Value {
+    template <typename Args>
+    static std::size_t count(const Args& args) { return std::get<0>(args) == GL_COLOR ? 4 : 1; }
+
+    template <typename A, typename Args>
+    static void write(A values, const Args& args) { put_payload(values, count(args) * sizeof(*values)); }
+    template <typename A, typename Args>
+    static A read(GlTrace& trace, const Args& args)
+    {
+        return reinterpret_cast<A>(get_payload(trace, count(args) * sizeof(*A{})));
+    }
+};
+
+// Optional data of `SizeIndex` bytes
+template <int SizeIndex>
+struct Bytes : Value {
+    template <typename A, typename Args>
+    static void write(A data, const Args& args)
+    {
+        put(static_cast<std::uint8_t>(data != nullptr));
+        if (data) {
+            put_payload(data, std::get<SizeIndex>(args));
+        }
+    }
+    template <typename A, typename Args>
+    static A read(GlTrace& trace, const Args& args)
+    {
+        return get<std::uint8_t>(trace) ? get_payload(trace, std::get<SizeIndex>(args)) : nullptr;
+    }
+};
+
+// Where a query writes its result, of `SizeIndex` bytes or a few values if it is -1
+template <int SizeIndex>
+struct Out : Value {
+    template <typename A, typename Args>
+    static void write(A, const Args&) {}
+    template <typename A, typename Args>
+    static A read(GlTrace& trace, const Args& args)
+    {
+        if constexpr (SizeIndex < 0) {
+            return reinterpret_cast<A>(scratch(trace, 16 * sizeof(GLint64)));
+        }
+        else {
+            return reinterpret_cast<A>(scratch(trace, std::get<SizeIndex>(args)));
+        }
+    }
+};
+
+// The strings of glShaderSource(), whose lengths SourceLengths passes on
+struct Sources : Value {
+    template <typename A, typename Args>
+    static void write(A strings, const Args& args)
+    {
+        const GLint* lengths = std::get<3>(args);
+        for (GLsizei i{}; i < std::get<1>(args); i++) {
+            const std::uint32_t length = lengths && lengths[i] >= 0 ? lengths[i] : std::strlen(strings[i]);
+            put(length);
+            put_payload(strings[i], length);
+        }
+    }
+    template <typename A, typename Args>
+    static A read(GlTrace& trace, const Args& args)
+    {
+        const std::size_t n = std::get<1>(args);
+        const GLchar** strings = reinterpret_cast<const GLchar**>(scratch(trace, n * sizeof(GLchar*)));
+        GLint* lengths = reinterpret_cast<GLint*>(scratch(trace, n * sizeof(GLint)));
+        for (std::size_t i{}; i < n; i++) {
+            const auto length = get<std::uint32_t>(trace);
+            const GLchar* string = get_payload(trace, length);
+            if (strings) {
+                strings[i] = string;
+                lengths[i] = length;
+            }
+        }
+        trace.source_lengths = lengths;
+        return strings;
+    }
+};
+
+struct SourceLengths : Value {
+    template <typename A, typename Args>
+    static void write(A, const Args&) {}
+    template <typename A, typename Args>
+    static A read(GlTrace& trace, const Args&) { return trace.source_lengths; }
+};
+
+struct String : Value {
+    template <typename A, typename Args>
+    static void write(A string, const Args&)
+    {
+        const std::uint32_t size = std::strlen(string) + 1;
+        put(size);
+        put_payload(string, size);
+    }
+    template <typename A, typename Args>
+    static A read(GlTrace& trace, const Args&) { return get_payload(trace, get<std::uint32_t>(trace)); }
+};
+
+struct Sync : Value {
+    template <typename A, typename Args>
+    static void write(A sync, const Args&) { put(reinterpret_cast<std::uint64_t>(sync)); }
+    template <typename A, typename Args>
+    static A read(GlTrace& trace, const Args&)
+    {
+        const auto it = trace.syncs.find(get<std::uint64_t>(trace));
+        return it != trace.syncs.end() ? it->second : nullptr;
+    }
+};
+
+// A uniform location of the program argument `ProgramIndex`, or of the
+// program in use if it is -1
+template <int ProgramIndex>
+struct Location : Value {
+    template <typename A, typename Args>
+    static A read(GlTrace& trace, const Args& args)
+    {
+        const GLint location = get<GLint>(trace);
+        GLuint program = trace.program;
+        if constexpr (ProgramIndex >= 0) {
+            program = std::get<ProgramIndex>(args);
+        }
+        const auto it = trace.locations.find({program, location});
+        return it != trace.locations.end() ? it->second : location;
+    }
+};
+
+// The pixels of glReadPixels(), an offset into the pixel pack buffer if one is bound
+struct PackPixels : Value {
+    template <typename A, typename Args>
+    static void write(A pixels, const Args&)
+    {
+        GLint pack_buffer{};
+        writer.get_integer(GL_PIXEL_PACK_BUFFER_BINDING, &pack_buffer);
+        put(static_cast<std::uint8_t>(pack_buffer != 0));
+        put(reinterpret_cast<std::uint64_t>(pixels));
+    }
+    template <typename A, typename Args>
+    static A read(GlTrace& trace, const Args& args)
+    {
+        const bool pack_buffer = get<std::uint8_t>(trace);
+        const auto pixels = get<std::uint64_t>(trace);
+        if (pack_buffer) {
+            return reinterpret_cast<A>(pixels);
+        }
+        return scratch(trace, std::size_t{16} * std::get<2>(args) * std::get<3>(args));
+    }
+};
+
+struct UnmappedBuffer : Name<TRACE_BUFFER> {
+    template <typename A, typename Args>
+    static void write(A buffer, const Args&)
+    {
+        put(buffer);
+        forget_mapping(buffer);
+    }
+    template <typename A, typename Args>
+    static void after(GlTrace& trace, const Args&, A buffer) { trace.mappings.erase(buffer); }
+};
+
+// How a call records its result, and what a replay learns from it
+struct NoResult {
+    template <typename R, typename Args>
+    static void write(R, const Args&) {}
+    template <typename R>
+    static R read(GlTrace&) { return R{}; }
+    template <typename R, typename Args>
+    static void after(GlTrace&, const Args&, R, R) {}
+};
+
+template <GlTraceNames Kind>
+struct NewName : NoResult {
+    template <typename R, typename Args>
+    static void write(R name, const Args&) { put(name); }
+    template <typename R>
+    static R read(GlTrace& trace) { return get<R>(trace); }
+    template <typename R, typename Args>
+    static void after(GlTrace& trace, const Args&, R recorded, R name) { trace.names[Kind][recorded] = name; }
+};
+
+struct NewSync : NoResult {
+    template <typename R, typename Args>
+    static void write(R sync, const Args&) { put(reinterpret_cast<std::uint64_t>(sync)); }
+    template <typename R>
+    static R read(GlTrace& trace) { return reinterpret_cast<R>(get<std::uint64_t>(trace)); }
+    template <typename R, typename Args>
+    static void after(GlTrace& trace, const Args&, R recorded, R sync)
+    {
+        trace.syncs[reinterpret_cast<std::uint64_t>(recorded)] = sync;
+    }
+};
+
+struct NewLocation : NoResult {
+    template <typename R, typename Args>
+    static void write(R location, const Args&) { put(location); }
+    template <typename R>
+    static R read(GlTrace& trace) { return get<R>(trace); }
+    template <typename R, typename Args>
+    static void after(GlTrace& trace, const Args& args, R recorded, R location)
+    {
+        trace.locations[{std::get<0>(args), recorded}] = location;
+    }
+};
+
+// Buffers mapped for writing have their changes traced from now on
+struct NewMapping : NoResult {
+    template <typename R, typename Args>
+    static void write(R pointer, const Args& args)
+    {
+        const GLuint buffer = std::get<0>(args);
+        forget_mapping(buffer);
+        if (pointer && (std::get<3>(args) & GL_MAP_WRITE_BIT)) {
+            TracedMapping mapping;
+            mapping.buffer = buffer;
+            mapping.pointer = static_cast<const char*>(pointer);
+            mapping.length = std::get<2>(args);
+            writer.mappings.push_back(std::move(mapping));
+        }
+    }
+    template <typename R, typename Args>
+    static void after(GlTrace& trace, const Args& args, R, R pointer)
+    {
+        trace.mappings[std::get<0>(args)] = static_cast<char*>(pointer);
+    }
+};
+
+/**
+ * Traces calls to the glad entry point `Proc` of type `Function`. While
+ * tracing, `Proc` points to wrapper(), which calls the driver and then
+ * records the call, with `ResultKind` and `Kinds` telling how to record the
+ * result and each argument.
+ */
+template <CallId Id, auto& Proc, typename Function, typename ResultKind, typename... Kinds>
+struct TracedCall;
+
+template <CallId Id, auto& Proc, typename R, typename... A, typename ResultKind, typename... Kinds>
+struct TracedCall<Id, Proc, R (APIENTRYP)(A...), ResultKind, Kinds...> {
+    static_assert(sizeof...(A) == sizeof...(Kinds), "every argument needs a kind");
+    using Args = std::tuple<A...>;
+
+    static inline R (APIENTRYP original)(A...){};
+
+    static void install()
+    {
+        original = Proc;
+        Proc = wrapper;
+    }
+
+    static void uninstall()
+    {
+        Proc = original;
+    }
+
+    static R APIENTRY wrapper(A... a)
+    {
+        if (!traced_context()) {
+            return original(a...);
+        }
+        if (reads_mapped_buffers(Id)) {
+            put_mapped_changes();
+        }
+        if constexpr (std::is_void_v<R>) {
+            original(a...);
+            record(Args{a...});
+        }
+        else {
+            const R result = original(a...);
+            const Args args{a...};
+            record(args);
+            ResultKind::write(result, args);
+            return result;
+        }
+    }
+
+    static void record(const Args& args)
+    {
+        put(static_cast<std::uint16_t>(Id));
+        write_args(args, std::index_sequence_for<A...>{});
+        writer.calls++;
+    }
+
+    template <std::size_t... I>
+    static void write_args(const Args& args, std::index_sequence<I...>)
+    {
+        (Kinds::write(std::get<I>(args), args), ...);
+    }
+
+    template <std::size_t... I>
+    static void read_args(GlTrace& trace, Args& args, std::index_sequence<I...>)
+    {
+        ((std::get<I>(args) = Kinds::template read<A>(trace, args)), ...);
+    }
+
+    template <std::size_t... I>
+    static void after_args(GlTrace& trace, const Args& args, std::index_sequence<I...>)
+    {
+        (Kinds::after(trace, args, std::get<I>(args)), ...);
+    }
+
+    static void replay(GlTrace& trace)
+    {
+        Args args{};
+        read_args(trace, args, std::index_sequence_for<A...>{});
+        if constexpr (std::is_void_v<R>) {
+            if (trace.execute) {
+                std::apply(Proc, args);
+                after_args(trace, args, std::index_sequence_for<A...>{});
+            }
+        }
+        else {
+            const R recorded = ResultKind::template read<R>(trace);
+            if (trace.execute) {
+                const R result = std::apply(Proc, args);
+                after_args(trace, args, std::index_sequence_for<A...>{});
+                ResultKind::after(trace, args, recorded, result);
+            }
+        }
+    }
+};
+
+#define TRACED_CALL(name, ...) TracedCall<CALL_##name, glad_gl##name, decltype(glad_gl##name), __VA_ARGS__>
+
+static void flush_trace()
+{
+    writer.file.write(writer.buffer.data(), writer.buffer.size());
+    writer.offset += writer.buffer.size();
+    writer.buffer.clear();
+}
+
+/**
+ * Starts recording the GL calls of the current context to the file at
+ * `path`, with the data they upload and what the application writes to
+ * mapped buffers. Call it after gladLoadGLLoader(), before creating GL
+ * objects, so that the trace can create them too. Tracing makes every
+ * call slower, and mapped buffers much slower, as their contents are
+ * compared before each draw. The context may move to another thread, as in
+ * 17-triangle-test, but GL calls from any other context, such as the upload
+ * context of 23-rounded-polygons, delete the trace.
+ */
+bool start_gl_trace(const char* path)
+{
+    if (writer.active) {
+        return false;
+    }
+    writer.file.open(path, std::ios::binary);
+    if (!writer.file) {
+        fmt::print(stderr, "ERROR: Failed to create GL trace {}\n", path);
+        return false;
+    }
+
+    writer.path = path;
+    writer.context = glfwGetCurrentContext();
+    writer.other_context = false;
+    writer.discarded = false;
+    writer.get_integer = glad_glGetIntegerv;
+    GLint viewport[4]{};
+    writer.get_integer(GL_VIEWPORT, viewport);
+    GlTraceHeader header;
+    std::copy(std::begin(TRACE_MAGIC), std::end(TRACE_MAGIC), header.magic);
+    header.version = TRACE_VERSION;
+    header.width = viewport[2];
+    header.height = viewport[3];
+    put(header);
+
+#define INSTALL_CALL(name, ...) TRACED_CALL(name, __VA_ARGS__)::install();
+    GL_TRACED_CALLS(INSTALL_CALL)
+#undef INSTALL_CALL
+
+    writer.active = true;
+    writer.calls = writer.frames = 0;
+    fmt::print("Tracing GL calls to {}.\n", path);
+    return true;
+}
+
+// Starts a trace if the environment variable GLTRACE names its file
+bool start_gl_trace()
+{
+    const char* path = std::getenv("GLTRACE");
+    return path && *path && start_gl_trace(path);
+}
+
+// Marks the end of a frame, after glfwSwapBuffers()
+void trace_frame()
+{
+    if (!writer.active || !traced_context()) {
+        return;
+    }
+    put_mapped_changes();
+    put(static_cast<std::uint16_t>(CALL_FRAME));
+    writer.frames++;
+    if (writer.buffer.size() >= TRACE_FLUSH_SIZE) {
+        flush_trace();
+    }
+}
+
+// Stops the trace, with the traced context current, once the threads of
+// other contexts have stopped making GL calls
+void stop_gl_trace()
+{
+    if (!writer.active) {
+        return;
+    }
+#define UNINSTALL_CALL(name, ...) TRACED_CALL(name, __VA_ARGS__)::uninstall();
+    GL_TRACED_CALLS(UNINSTALL_CALL)
+#undef UNINSTALL_CALL
+
+    writer.active = false;
+    if (!traced_context()) {
+        return;
+    }
+    flush_trace();
+    writer.file.close();
+    writer.mappings.clear();
+    fmt::print("Traced {} GL calls in {} frames, {:.1f} MB.\n", writer.calls, writer.frames, writer.offset / 1.0e6);
+}
+
+static bool replay_call(GlTrace& trace, CallId call)
+{
+    switch (call) {
+#define REPLAY_CALL(name, ...) \
+    case CALL_##name: \
+        TRACED_CALL(name, __VA_ARGS__)::replay(trace); \
+        return true;
+    GL_TRACED_CALLS(REPLAY_CALL)
+#undef REPLAY_CALL
+    case CALL_MAPPED_WRITE:
+        replay_mapped_write(trace);
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Replays the calls of the next frame, or only counts them if the trace is
+ * not executed. Returns false after the calls that follow the last frame,
+ * or if the trace is corrupt.
+ */
+bool replay_gl_frame(GlTrace& trace)
+{
+    while (trace.position < trace.data.size()) {
+        const auto call = static_cast<CallId>(get<std::uint16_t>(trace));
+        if (call < CALL_COUNT) {
+            trace.call_counts[call]++;
+        }
+        if (call == CALL_FRAME) {
+            trace.frames++;
+            return true;
+        }
+        trace.scratch.clear();
+        if (!replay_call(trace, call)) {
+            trace.position = trace.data.size() + 1;
+            break;
+        }
+        trace.calls += call != CALL_MAPPED_WRITE;
+        trace.draws += is_draw(call);
+    }
+    return false;
+}
+
+/**
+ * Loads the trace at `path` and checks that it parses. Replaying it then
+ * needs a current context, and `default_framebuffer` set to where the
+ * trace's framebuffer 0 should go.
+ */
+bool load_gl_trace(GlTrace& trace, const char* path)
+{
+    std::ifstream file{path, std::ios::binary | std::ios::ate};
+    trace.data.resize(file ? static_cast<std::size_t>(file.tellg()) : 0);
+    file.seekg(0);
+    file.read(trace.data.data(), trace.data.size());
+
+    GlTraceHeader header;
+    if (!file || trace.data.size() < sizeof(header)) {
+        fmt::print(stderr, "ERROR: Failed to read GL trace {}\n", path);
+        return false;
+    }
+    std::memcpy(&header, trace.data.data(), sizeof(header));
+    if (std::string_view{header.magic, 4} != std::string_view{TRACE_MAGIC, 4} || header.version != TRACE_VERSION) {
+        fmt::print(stderr, "ERROR: {} is not a GL trace of version {}\n", path, TRACE_VERSION);
+        return false;
+    }
+    trace.width = header.width;
+    trace.height = header.height;
+
+    // Parse the whole trace once, so that a replay cannot run off its end
+    trace.execute = false;
+    trace.position = sizeof(header);
+    trace.call_counts.assign(CALL_COUNT, 0);
+    while (replay_gl_frame(trace)) {
+    }
+    if (trace.position != trace.data.size()) {
+        fmt::print(stderr, "ERROR: GL trace {} is corrupt after {} frames\n", path, trace.frames);
+        return false;
+    }
+
+    trace.execute = true;
+    trace.position = sizeof(header);
+    trace.frames = trace.calls = trace.draws = trace.payload_bytes = 0;
+    trace.call_counts.assign(CALL_COUNT, 0);
+    return true;
+}
+
+// The number of different calls in traces, including frame ends and mapped writes
+int gl_trace_call_count()
+{
+    return CALL_COUNT;
+}
+
+const char* gl_trace_call_name(int call)
+{
+    return call >= 0 && call < CALL_COUNT ? call_names[call] : "(unknown)";
+}
@@ -0,0 +1,55 @@
+#ifndef GLTRACE_H_INCLUDED
+#define GLTRACE_H_INCLUDED
+
+#include "glad.h"
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// GL object namespaces whose names a replay translates
+enum GlTraceNames : int {
+    TRACE_BUFFER,
+    TRACE_VERTEX_ARRAY,
+    TRACE_TEXTURE,
+    TRACE_FRAMEBUFFER,
+    TRACE_RENDERBUFFER,
+    TRACE_PROGRAM, // programs and shaders share theirs
+    TRACE_QUERY,
+    TRACE_NAME_KINDS
+};
+
+// A trace file loaded for replay. Objects get new names, syncs and
+// mappings new pointers, and uniform locations may move, so the replay
+// keeps what each recorded one became.
+struct GlTrace {
+    std::vector<char> data;        // the whole file
+    std::size_t position{};        // of the next call
+    int width{}, height{};         // of the viewport when the capture started
+    bool execute{true};            // false only parses, for statistics
+    GLuint default_framebuffer{};  // stands in for framebuffer 0
+    GLuint program{};              // in use, for glUniform*()
+    std::unordered_map<GLuint, GLuint> names[TRACE_NAME_KINDS];
+    std::unordered_map<std::uint64_t, GLsync> syncs;
+    std::map<std::pair<GLuint, GLint>, GLint> locations; // by program and recorded location
+    std::unordered_map<GLuint, char*> mappings;          // by buffer
+    const GLint* source_lengths{}; // of the glShaderSource() being replayed
+    std::vector<std::vector<char>> scratch; // outputs of the call being replayed
+    long long frames{};            // totals so far
+    long long calls{};
+    long long draws{};
+    long long payload_bytes{};     // uploaded with buffer data, uniforms and mapped writes
+    std::vector<long long> call_counts; // by call, see gl_trace_call_name()
+};
+
+extern bool start_gl_trace(const char* path);
+extern bool start_gl_trace();
+extern void trace_frame();
+extern void stop_gl_trace();
+extern bool load_gl_trace(GlTrace& trace, const char* path);
+extern bool replay_gl_frame(GlTrace& trace);
+extern int gl_trace_call_count();
+extern const char* gl_trace_call_name(int call);
+
+#endif // GLTRACE_H_INCLUDED
@@ -0,0 +1,85 @@
+#ifndef HANDOFF_H_INCLUDED
+#define HANDOFF_H_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+
+// Lock-free ring of `Capacity` items from one producer thread to one
+// consumer thread. Neither ever waits: try_push() fails when the ring is
+// full and try_pop() when it is empty.
+template <typename T, std::size_t Capacity>
+struct SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    T items[Capacity];
+    alignas(64) std::atomic<std::size_t> head{}; // next to pop, written by the consumer
+    alignas(64) std::atomic<std::size_t> tail{}; // next to push, written by the producer
+};
+
+template <typename T, std::size_t Capacity>
+bool try_push(SpscQueue<T, Capacity>& queue, const T& item)
+{
+    const std::size_t tail = queue.tail.load(std::memory_order_relaxed);
+    if (tail - queue.head.load(std::memory_order_acquire) == Capacity) {
+        return false;
+    }
+    queue.items[tail % Capacity] = item;
+    queue.tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T, std::size_t Capacity>
+bool try_pop(SpscQueue<T, Capacity>& queue, T& item)
+{
+    const std::size_t head = queue.head.load(std::memory_order_relaxed);
+    if (head == queue.tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+    item = queue.items[head % Capacity];
+    queue.head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+constexpr int TRIPLE_FRESH{4}; // flag of TripleBuffer::middle, set until the consumer takes it
+
+// Latest-value handoff of a whole state from one producer thread to one
+// consumer thread. The producer writes the back buffer and publishes it,
+// the consumer reads the front buffer after taking the newest one. Neither
+// waits, and states the consumer is too slow to see are skipped.
+template <typename T>
+struct TripleBuffer {
+    T buffers[3];
+    int back{0};                 // owned by the producer
+    int front{1};                // owned by the consumer
+    std::atomic<int> middle{2};  // last published, or-ed with TRIPLE_FRESH
+};
+
+template <typename T>
+T& back_buffer(TripleBuffer<T>& buffer)
+{
+    return buffer.buffers[buffer.back];
+}
+
+template <typename T>
+void publish(TripleBuffer<T>& buffer)
+{
+    buffer.back = buffer.middle.exchange(buffer.back | TRIPLE_FRESH, std::memory_order_acq_rel) & 3;
+}
+
+// Makes the newest published state the front buffer, returns false if there is none
+template <typename T>
+bool take_latest(TripleBuffer<T>& buffer)
+{
+    if (!(buffer.middle.load(std::memory_order_relaxed) & TRIPLE_FRESH)) {
+        return false;
+    }
+    buffer.front = buffer.middle.exchange(buffer.front, std::memory_order_acq_rel) & 3;
+    return true;
+}
+
+template <typename T>
+const T& front_buffer(const TripleBuffer<T>& buffer)
+{
+    return buffer.buffers[buffer.front];
+}
+
+#endif // HANDOFF_H_INCLUDED
@@ -0,0 +1,77 @@
+#include "glad.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include "hiz.h"
+#include "shader.h"
+#include "utils.h"
+
+static GLuint create_program()
+{
+    namespace fs = std::filesystem;
+    return compile_shaders({
+        fs::canonical(dirname() / ".." / "shader" / "hiz-build.comp").c_str(),
+    });
+}
+
+void create_hiz(HiZ& hiz, GLsizei width, GLsizei height)
+{
+    hiz.program = create_program();
+    resize_hiz(hiz, width, height);
+}
+
+// Reallocates the pyramid for a depth buffer of `width` by `height`
+void resize_hiz(HiZ& hiz, GLsizei width, GLsizei height)
+{
+    glDeleteTextures(1, &hiz.texture);
+
+    hiz.width = std::max(width, 1);
+    hiz.height = std::max(height, 1);
+    hiz.levels = static_cast<GLsizei>(std::log2(std::max(hiz.width, hiz.height))) + 1;
+    glCreateTextures(GL_TEXTURE_2D, 1, &hiz.texture);
+    glTextureStorage2D(hiz.texture, hiz.levels, GL_R32F, hiz.width, hiz.height);
+    glTextureParameteri(hiz.texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTextureParameteri(hiz.texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
+
+// Recompiles the shader, e.g. after editing it
+void reload_hiz(HiZ& hiz)
+{
+    glDeleteProgram(hiz.program);
+    hiz.program = create_program();
+}
+
+/**
+ * Builds the pyramid from `depth_texture`, which must be as large as level 0
+ * and use GL_NEAREST filtering. One dispatch per level, each reading the
+ * level below through a sampler while writing its own level as an image.
+ * Callers sampling the pyramid afterwards need GL_TEXTURE_FETCH_BARRIER_BIT
+ * first, which a frame graph pass writing it with ACCESS_IMAGE gets.
+ */
+void build_hiz(const HiZ& hiz, GLuint depth_texture)
+{
+    const GLuint local_size{16}; // must match shader/hiz-build.comp
+    glUseProgram(hiz.program);
+
+    GLsizei width{hiz.width}, height{hiz.height};
+    for (GLint level{}; level < hiz.levels; level++) {
+        glBindTextureUnit(0, level == 0 ? depth_texture : hiz.texture);
+        glBindImageTexture(0, hiz.texture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glUniform1i(0, level == 0 ? 0 : level - 1);
+        glUniform1i(1, level == 0);
+        glDispatchCompute((width + local_size - 1) / local_size, (height + local_size - 1) / local_size, 1);
+        if (level + 1 < hiz.levels) {
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        }
+
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+}
+
+void delete_hiz(HiZ& hiz)
+{
+    glDeleteTextures(1, &hiz.texture);
+    glDeleteProgram(hiz.program);
+    hiz = HiZ{};
+}
@@ -0,0 +1,23 @@
+#ifndef HIZ_H_INCLUDED
+#define HIZ_H_INCLUDED
+
+#include "glad.h"
+
+// Hierarchical depth pyramid for occlusion culling. Every texel of a level
+// holds the farthest depth of the texels it covers in the level below, so one
+// fetch at a coarse level conservatively covers a large screen rectangle.
+struct HiZ {
+    GLuint program{};
+    GLuint texture{}; // R32F with a full mip chain, level 0 matches the depth buffer
+    GLsizei width{};
+    GLsizei height{};
+    GLsizei levels{};
+};
+
+extern void create_hiz(HiZ& hiz, GLsizei width, GLsizei height);
+extern void resize_hiz(HiZ& hiz, GLsizei width, GLsizei height);
+extern void reload_hiz(HiZ& hiz);
+extern void build_hiz(const HiZ& hiz, GLuint depth_texture);
+extern void delete_hiz(HiZ& hiz);
+
+#endif // HIZ_H_INCLUDED
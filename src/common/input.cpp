@@ -0,0 +1,56 @@
+#include "input.h"
+
+static void add_event(InputCoalescer& input, double time)
+{
+    if (input.pending.first_time < 0.0) {
+        input.pending.first_time = time;
+    }
+}
+
+void add_cursor_event(InputCoalescer& input, double x, double y, double time)
+{
+    add_event(input, time);
+    const glm::dvec2 cursor{x, y};
+    if (input.has_cursor) {
+        input.pending.motion += cursor - input.cursor;
+    }
+    input.cursor = cursor;
+    input.has_cursor = true;
+    input.pending.cursor = cursor;
+    input.pending.motion_events++;
+    input.cursor_events++;
+}
+
+// Keeps the edge at the latest cursor position, which is where GLFW reports the press
+void add_button_event(InputCoalescer& input, int button, int action, int mods, double time)
+{
+    add_event(input, time);
+    input.pending.edges.emplace_back(ButtonEdge{button, action, mods, input.cursor, time});
+}
+
+void add_scroll_event(InputCoalescer& input, double xoffset, double yoffset, double time)
+{
+    add_event(input, time);
+    input.pending.scroll += glm::dvec2{xoffset, yoffset};
+}
+
+/**
+ * Moves the events since the last call into `frame`, and returns whether
+ * there were any. Call it once per frame, after polling events.
+ */
+bool take_input_frame(InputCoalescer& input, InputFrame& frame)
+{
+    frame.edges.clear();
+    std::swap(frame, input.pending);
+    input.pending.cursor = input.cursor;
+    input.pending.motion = glm::dvec2{0.0};
+    input.pending.motion_events = 0;
+    input.pending.scroll = glm::dvec2{0.0};
+    input.pending.first_time = -1.0;
+    frame.cursor = input.cursor;
+    if (frame.first_time < 0.0) {
+        return false;
+    }
+    input.frames++;
+    return true;
+}
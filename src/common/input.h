@@ -0,0 +1,43 @@
+#ifndef INPUT_H_INCLUDED
+#define INPUT_H_INCLUDED
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// A mouse button press or release, with where and when it happened
+struct ButtonEdge {
+    int button{};
+    int action{}; // GLFW_PRESS or GLFW_RELEASE
+    int mods{};
+    glm::dvec2 cursor{};
+    double time{};
+};
+
+// The input since the last take_input_frame(). Cursor events are merged
+// into the latest position and the sum of their moves, button edges are
+// all kept, in order.
+struct InputFrame {
+    glm::dvec2 cursor{};       // latest position
+    glm::dvec2 motion{};       // sum of the cursor moves
+    int motion_events{};       // cursor events merged into this frame
+    glm::dvec2 scroll{};       // sum of the scroll offsets
+    std::vector<ButtonEdge> edges;
+    double first_time{-1.0};   // of the oldest event, -1 if there is none
+};
+
+// Collects the events of GLFW input callbacks, timestamped by the caller
+// with glfwGetTime(), into frames
+struct InputCoalescer {
+    InputFrame pending;
+    glm::dvec2 cursor{};       // latest position, kept across frames
+    bool has_cursor{};
+    long long cursor_events{}; // totals, for statistics
+    long long frames{};        // taken with at least one event
+};
+
+extern void add_cursor_event(InputCoalescer& input, double x, double y, double time);
+extern void add_button_event(InputCoalescer& input, int button, int action, int mods, double time);
+extern void add_scroll_event(InputCoalescer& input, double xoffset, double yoffset, double time);
+extern bool take_input_frame(InputCoalescer& input, InputFrame& frame);
+
+#endif // INPUT_H_INCLUDED
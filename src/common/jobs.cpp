@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <fmt/core.h>
+#include "jobs.h"
+
+// Index of the queue of the calling thread, 0 for the thread that created the pool
+static thread_local unsigned worker_index{};
+
+static void push(JobSystem& js, Job job)
+{
+    Worker& worker = *js.workers[worker_index];
+    {
+        std::lock_guard<std::mutex> lock{worker.mutex};
+        worker.jobs.emplace_back(std::move(job));
+    }
+    js.queued++;
+
+    // Taking the lock orders this with a worker that is about to sleep
+    { std::lock_guard<std::mutex> lock{js.sleep_mutex}; }
+    js.wake.notify_one();
+}
+
+// Takes the newest job of the calling worker, or else steals the oldest job
+// of another worker, starting with the next one
+static bool pop(JobSystem& js, Job& job)
+{
+    const auto n = static_cast<unsigned>(js.workers.size());
+    for (unsigned i{}; i < n; i++) {
+        Worker& victim = *js.workers[(worker_index + i) % n];
+        std::lock_guard<std::mutex> lock{victim.mutex};
+        if (victim.jobs.empty()) {
+            continue;
+        }
+        if (i == 0) {
+            job = std::move(victim.jobs.back());
+            victim.jobs.pop_back();
+        }
+        else {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            Worker& self = *js.workers[worker_index];
+            self.steals.store(self.steals + 1, std::memory_order_relaxed);
+        }
+        js.queued--;
+        return true;
+    }
+    return false;
+}
+
+static bool run_one(JobSystem& js)
+{
+    Job job;
+    if (!pop(js, job)) {
+        return false;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    job();
+    const std::chrono::duration<double> busy = std::chrono::steady_clock::now() - start;
+    Worker& self = *js.workers[worker_index];
+    self.busy_seconds.store(self.busy_seconds + busy.count(), std::memory_order_relaxed);
+    self.jobs_run.store(self.jobs_run + 1, std::memory_order_relaxed);
+    return true;
+}
+
+// Runs jobs until `unfinished` drops to zero, so waiting never blocks a worker
+static void wait_for(JobSystem& js, const std::atomic<size_t>& unfinished)
+{
+    while (unfinished > 0) {
+        if (!run_one(js)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+static void worker_main(JobSystem& js, unsigned index)
+{
+    worker_index = index;
+    while (!js.stop) {
+        if (!run_one(js)) {
+            std::unique_lock<std::mutex> lock{js.sleep_mutex};
+            js.wake.wait(lock, [&js] { return js.queued > 0 || js.stop; });
+        }
+    }
+}
+
+/**
+ * Starts the worker threads.
+ * `num_workers` specifies the number of workers including the calling
+ *     thread, 0 for one per hardware thread.
+ */
+void create_job_system(JobSystem& js, unsigned num_workers)
+{
+    if (num_workers == 0) {
+        num_workers = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    worker_index = 0;
+    for (unsigned i{}; i < num_workers; i++) {
+        js.workers.emplace_back(std::make_unique<Worker>());
+    }
+    js.stats_start = std::chrono::steady_clock::now();
+    for (unsigned i{1}; i < num_workers; i++) {
+        js.threads.emplace_back(worker_main, std::ref(js), i);
+    }
+}
+
+// Stops the workers, which must be out of work
+void delete_job_system(JobSystem& js)
+{
+    {
+        std::lock_guard<std::mutex> lock{js.sleep_mutex};
+        js.stop = true;
+    }
+    js.wake.notify_all();
+    for (std::thread& thread : js.threads) {
+        thread.join();
+    }
+    js.threads.clear();
+    js.workers.clear();
+    js.stop = false;
+}
+
+unsigned num_workers(const JobSystem& js)
+{
+    return static_cast<unsigned>(js.workers.size());
+}
+
+/**
+ * Calls `body` for consecutive ranges of [0, `count`) on all workers and
+ * returns when every range is done.
+ * `chunk` specifies the size of the ranges, 0 for about four per worker.
+ */
+void parallel_for(
+    JobSystem& js, size_t count, size_t chunk,
+    const std::function<void(size_t begin, size_t end)>& body)
+{
+    if (chunk == 0) {
+        chunk = std::max<size_t>(count / (4 * num_workers(js)), 1);
+    }
+    const size_t num_chunks = (count + chunk - 1) / chunk;
+    std::atomic<size_t> unfinished{num_chunks};
+    for (size_t c{}; c < num_chunks; c++) {
+        push(js, [&body, &unfinished, c, chunk, count] {
+            body(c * chunk, std::min(count, (c + 1) * chunk));
+            unfinished--;
+        });
+    }
+    wait_for(js, unfinished);
+}
+
+// Returns the id of `task` for add_dependency()
+size_t add_task(TaskGraph& graph, Job task)
+{
+    graph.tasks.emplace_back(std::move(task));
+    graph.successors.emplace_back();
+    graph.dependencies.emplace_back(0);
+    return graph.tasks.size() - 1;
+}
+
+// Makes task `after` wait for task `before`. The graph must stay acyclic.
+void add_dependency(TaskGraph& graph, size_t before, size_t after)
+{
+    graph.successors[before].emplace_back(after);
+    graph.dependencies[after]++;
+}
+
+/**
+ * Runs the tasks of `graph` on all workers, each as soon as the tasks it
+ * depends on are done, and returns when all are done. Tasks may themselves
+ * call parallel_for(). The graph can be run again.
+ */
+void run_task_graph(JobSystem& js, const TaskGraph& graph)
+{
+    const size_t n = graph.tasks.size();
+    const auto remaining = std::make_unique<std::atomic<int>[]>(n);
+    for (size_t i{}; i < n; i++) {
+        remaining[i] = graph.dependencies[i];
+    }
+    std::atomic<size_t> unfinished{n};
+
+    std::function<void(size_t)> spawn = [&](size_t i) {
+        push(js, [&, i] {
+            graph.tasks[i]();
+            for (const size_t successor : graph.successors[i]) {
+                if (--remaining[successor] == 0) {
+                    spawn(successor);
+                }
+            }
+            unfinished--;
+        });
+    };
+    for (size_t i{}; i < n; i++) {
+        if (graph.dependencies[i] == 0) {
+            spawn(i);
+        }
+    }
+    wait_for(js, unfinished);
+}
+
+void reset_job_stats(JobSystem& js)
+{
+    for (const auto& worker : js.workers) {
+        worker->busy_seconds = 0.0;
+        worker->jobs_run = 0;
+        worker->steals = 0;
+    }
+    js.stats_start = std::chrono::steady_clock::now();
+}
+
+// Prints the jobs, steals and busy time of each worker since the last reset
+void print_job_stats(const JobSystem& js)
+{
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - js.stats_start;
+    double busy{};
+    for (size_t i{}; i < js.workers.size(); i++) {
+        const Worker& worker = *js.workers[i];
+        fmt::print("worker {:2}: {:6} jobs, {:5} steals, {:5.1f}% busy\n",
+            i, worker.jobs_run.load(), worker.steals.load(), 100.0 * worker.busy_seconds / elapsed.count());
+        busy += worker.busy_seconds;
+    }
+    fmt::print("{} workers, {:.1f} ms, {:.1f}% busy on average\n",
+        js.workers.size(), 1000.0 * elapsed.count(),
+        100.0 * busy / (elapsed.count() * std::max<size_t>(js.workers.size(), 1)));
+}
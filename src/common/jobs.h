@@ -0,0 +1,61 @@
+#ifndef JOBS_H_INCLUDED
+#define JOBS_H_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using Job = std::function<void()>;
+
+// Job queue and stats of one worker. The owner pushes and pops at the back,
+// so it runs the jobs it spawned most recently while their data is still in
+// its cache, and idle workers steal from the front, taking the oldest and
+// usually largest. Only the owner updates the stats.
+struct Worker {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+    std::atomic<double> busy_seconds{};
+    std::atomic<int> jobs_run{};
+    std::atomic<int> steals{};
+};
+
+// Pool of worker threads with one job queue each. The thread that creates it
+// is worker 0 and runs jobs while it waits for them, so work can be spawned
+// from that thread or from jobs, but not from unrelated threads.
+struct JobSystem {
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<int> queued{}; // jobs in all queues, to put idle workers to sleep
+    std::atomic<bool> stop{};
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    std::chrono::steady_clock::time_point stats_start;
+};
+
+// Jobs with dependencies, run by run_task_graph()
+struct TaskGraph {
+    std::vector<Job> tasks;
+    std::vector<std::vector<size_t>> successors;
+    std::vector<int> dependencies;
+};
+
+extern void create_job_system(JobSystem& js, unsigned num_workers = 0);
+extern void delete_job_system(JobSystem& js);
+extern unsigned num_workers(const JobSystem& js);
+extern void parallel_for(
+    JobSystem& js, size_t count, size_t chunk,
+    const std::function<void(size_t begin, size_t end)>& body);
+extern size_t add_task(TaskGraph& graph, Job task);
+extern void add_dependency(TaskGraph& graph, size_t before, size_t after);
+extern void run_task_graph(JobSystem& js, const TaskGraph& graph);
+extern void reset_job_stats(JobSystem& js);
+extern void print_job_stats(const JobSystem& js);
+
+#endif // JOBS_H_INCLUDED
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <fmt/core.h>
+#include <GLFW/glfw3.h>
+#include "latency.h"
+
+// Maps GPU timestamps onto glfwGetTime(). Reading GL_TIMESTAMP does not
+// wait for the GPU, only for the driver.
+static void calibrate(LatencyTracker& tracker)
+{
+    GLint64 gpu_ns{};
+    glGetInteger64v(GL_TIMESTAMP, &gpu_ns);
+    tracker.gpu_offset = glfwGetTime() - gpu_ns / 1e9;
+}
+
+void create_latency_tracker(LatencyTracker& tracker)
+{
+    glCreateQueries(GL_TIMESTAMP, MAX_LATENCY_QUERIES, tracker.queries);
+    calibrate(tracker);
+}
+
+/**
+ * Call right after glfwSwapBuffers(). If the frame shows the effect of
+ * input received at `input_time`, queues a timestamp query that resolves
+ * to when the GPU got past the swap. A negative `input_time` means there
+ * was no new input.
+ */
+void mark_present(LatencyTracker& tracker, double input_time)
+{
+    if (input_time < 0.0) {
+        return;
+    }
+    if (tracker.pending == MAX_LATENCY_QUERIES) {
+        tracker.dropped++;
+        return;
+    }
+    const int slot = (tracker.head + tracker.pending) % MAX_LATENCY_QUERIES;
+    glQueryCounter(tracker.queries[slot], GL_TIMESTAMP);
+    tracker.input_times[slot] = input_time;
+    tracker.pending++;
+}
+
+// Turns the queries whose results are available into samples, without waiting
+void collect_latencies(LatencyTracker& tracker)
+{
+    while (tracker.pending > 0) {
+        const GLuint query = tracker.queries[tracker.head];
+        GLint available{};
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            break;
+        }
+        GLuint64 gpu_ns{};
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &gpu_ns);
+        const double present_time = gpu_ns / 1e9 + tracker.gpu_offset;
+        tracker.samples.emplace_back(1000.0 * (present_time - tracker.input_times[tracker.head]));
+        tracker.head = (tracker.head + 1) % MAX_LATENCY_QUERIES;
+        tracker.pending--;
+    }
+}
+
+// Prints the mean, median and maximum latency since the last print, then recalibrates
+void print_latencies(LatencyTracker& tracker)
+{
+    std::vector<double>& samples = tracker.samples;
+    if (!samples.empty()) {
+        double sum{};
+        for (const double sample : samples) {
+            sum += sample;
+        }
+        std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+        const double median = samples[samples.size() / 2];
+        const double max = *std::max_element(samples.begin(), samples.end());
+        fmt::print("input to present: {} frames, mean {:.1f} ms, median {:.1f} ms, max {:.1f} ms, {} not measured\n",
+            samples.size(), sum / samples.size(), median, max, tracker.dropped);
+    }
+    samples.clear();
+    tracker.dropped = 0;
+    calibrate(tracker);
+}
+
+void delete_latency_tracker(LatencyTracker& tracker)
+{
+    glDeleteQueries(MAX_LATENCY_QUERIES, tracker.queries);
+    tracker = LatencyTracker{};
+}
@@ -0,0 +1,29 @@
+#ifndef LATENCY_H_INCLUDED
+#define LATENCY_H_INCLUDED
+
+#include <vector>
+#include "glad.h"
+
+constexpr int MAX_LATENCY_QUERIES{8};
+
+// Measures input-to-present latency: from the time of an input event, on
+// the glfwGetTime() clock, to a GPU timestamp taken right after the swap of
+// the first frame that shows its effect. The GPU clock is mapped onto the
+// CPU one by sampling both. Display scanout and compositing come on top.
+struct LatencyTracker {
+    GLuint queries[MAX_LATENCY_QUERIES]{};
+    double input_times[MAX_LATENCY_QUERIES]{};
+    int head{};             // oldest pending query
+    int pending{};
+    double gpu_offset{};    // CPU seconds minus GPU seconds
+    std::vector<double> samples; // ms, since the last print
+    int dropped{};          // presents not measured as every query was pending
+};
+
+extern void create_latency_tracker(LatencyTracker& tracker);
+extern void mark_present(LatencyTracker& tracker, double input_time);
+extern void collect_latencies(LatencyTracker& tracker);
+extern void print_latencies(LatencyTracker& tracker);
+extern void delete_latency_tracker(LatencyTracker& tracker);
+
+#endif // LATENCY_H_INCLUDED
@@ -0,0 +1,192 @@
+#include "glad.h"
+#include <fmt/core.h>
+#include <numeric>
+#include <vector>
+#include "lod.h"
+
+// Must match the commands declared by the culling shaders that fill them
+struct DrawArraysIndirectCommand {
+    GLuint count{};
+    GLuint instance_count{};
+    GLuint first{};
+    GLuint base_instance{};
+};
+
+struct DrawElementsIndirectCommand {
+    GLuint count{};
+    GLuint instance_count{};
+    GLuint first_index{};
+    GLint base_vertex{};
+    GLuint base_instance{};
+};
+
+static bool indexed(const LodGroup& group)
+{
+    return !group.indices.empty();
+}
+
+static GLsizei command_size(const LodGroup& group)
+{
+    return indexed(group) ? sizeof(DrawElementsIndirectCommand) : sizeof(DrawArraysIndirectCommand);
+}
+
+static GLuint num_buckets(const LodGroup& group)
+{
+    return group.sets * static_cast<GLuint>(group.meshes.size());
+}
+
+/**
+ * Appends the next finer LOD mesh to `group`.
+ * `vertices` specifies the attributes of every vertex back to back, as
+ *     described by `group.attribute_sizes`.
+ * `indices` specifies the triangles for an indexed group, and must be empty
+ *     for all meshes of a non-indexed group.
+ */
+void add_lod_mesh(
+    LodGroup& group, const std::vector<GLfloat>& vertices,
+    const std::vector<GLuint>& indices)
+{
+    const GLuint stride = std::accumulate(group.attribute_sizes.begin(), group.attribute_sizes.end(), 0);
+    const GLuint first_vertex = static_cast<GLuint>(group.vertices.size()) / stride;
+
+    LodMesh mesh;
+    if (indices.empty()) {
+        mesh.first = first_vertex;
+        mesh.count = static_cast<GLuint>(vertices.size()) / stride;
+    }
+    else {
+        mesh.first = static_cast<GLuint>(group.indices.size());
+        mesh.count = static_cast<GLuint>(indices.size());
+        mesh.base_vertex = static_cast<GLint>(first_vertex);
+    }
+    group.meshes.emplace_back(mesh);
+
+    group.vertices.insert(group.vertices.end(), vertices.begin(), vertices.end());
+    group.indices.insert(group.indices.end(), indices.begin(), indices.end());
+}
+
+/**
+ * Creates the buffers and the VAO of `group` after all meshes are added.
+ * `capacity` specifies the maximum number of instances in one bucket, at
+ *     most LOD_MAX_INSTANCES, to which a larger one is clamped.
+ * `sets` specifies the number of sets of buckets.
+ */
+void upload_lod_group(LodGroup& group, GLuint capacity, GLuint sets)
+{
+    if (capacity > LOD_MAX_INSTANCES) {
+        fmt::print(stderr, "ERROR: {} instances exceed the 24-bit instance ids, using {}\n",
+            capacity, LOD_MAX_INSTANCES);
+        capacity = LOD_MAX_INSTANCES;
+    }
+    group.capacity = capacity;
+    group.sets = sets;
+
+    glCreateBuffers(1, &group.vbo);
+    glNamedBufferStorage(group.vbo, group.vertices.size()*sizeof(GLfloat), group.vertices.data(), 0);
+
+    glCreateVertexArrays(1, &group.vao);
+    const GLint stride = std::accumulate(group.attribute_sizes.begin(), group.attribute_sizes.end(), 0);
+    glVertexArrayVertexBuffer(group.vao, 0, group.vbo, 0, sizeof(GLfloat)*stride);
+    GLuint offset{};
+    for (GLuint i{}; i < group.attribute_sizes.size(); i++) {
+        glEnableVertexArrayAttrib(group.vao, i);
+        glVertexArrayAttribFormat(group.vao, i, group.attribute_sizes[i], GL_FLOAT, GL_FALSE, sizeof(GLfloat)*offset);
+        glVertexArrayAttribBinding(group.vao, i, 0);
+        offset += group.attribute_sizes[i];
+    }
+
+    if (indexed(group)) {
+        glCreateBuffers(1, &group.ebo);
+        glNamedBufferStorage(group.ebo, group.indices.size()*sizeof(GLuint), group.indices.data(), 0);
+        glVertexArrayElementBuffer(group.vao, group.ebo);
+    }
+
+    glCreateBuffers(1, &group.command_buffer);
+    glNamedBufferStorage(group.command_buffer, num_buckets(group)*command_size(group),
+        nullptr, GL_DYNAMIC_STORAGE_BIT);
+}
+
+// Returns the number of entries of the instance lists of all buckets
+GLuint lod_list_size(const LodGroup& group)
+{
+    return num_buckets(group) * group.capacity;
+}
+
+/**
+ * Resets the instance counts of all buckets, which the culling passes
+ * increment. Bucket `set * meshes.size() + lod` lists its instances from
+ * entry `bucket * capacity` on, which the draw passes as its base instance.
+ */
+void reset_lod_commands(const LodGroup& group)
+{
+    const GLuint n = static_cast<GLuint>(group.meshes.size());
+    if (indexed(group)) {
+        std::vector<DrawElementsIndirectCommand> commands(num_buckets(group));
+        for (GLuint bucket{}; bucket < commands.size(); bucket++) {
+            commands[bucket].count = group.meshes[bucket % n].count;
+            commands[bucket].first_index = group.meshes[bucket % n].first;
+            commands[bucket].base_vertex = group.meshes[bucket % n].base_vertex;
+            commands[bucket].base_instance = bucket * group.capacity;
+        }
+        glNamedBufferSubData(group.command_buffer, 0, commands.size()*sizeof(commands[0]), commands.data());
+    }
+    else {
+        std::vector<DrawArraysIndirectCommand> commands(num_buckets(group));
+        for (GLuint bucket{}; bucket < commands.size(); bucket++) {
+            commands[bucket].count = group.meshes[bucket % n].count;
+            commands[bucket].first = group.meshes[bucket % n].first;
+            commands[bucket].base_instance = bucket * group.capacity;
+        }
+        glNamedBufferSubData(group.command_buffer, 0, commands.size()*sizeof(commands[0]), commands.data());
+    }
+}
+
+// Sets the instance count of `bucket`, for instance lists written on the CPU
+void set_lod_instance_count(const LodGroup& group, GLuint bucket, GLuint count)
+{
+    const GLintptr offset = bucket * command_size(group) + sizeof(GLuint);
+    glNamedBufferSubData(group.command_buffer, offset, sizeof(count), &count);
+}
+
+// Returns the instance count of every bucket. This waits for the GPU.
+std::vector<GLuint> read_lod_instance_counts(const LodGroup& group)
+{
+    const GLsizei words = command_size(group) / sizeof(GLuint);
+    std::vector<GLuint> commands(num_buckets(group) * words);
+    glGetNamedBufferSubData(group.command_buffer, 0, commands.size()*sizeof(GLuint), commands.data());
+
+    std::vector<GLuint> counts(num_buckets(group));
+    for (GLuint bucket{}; bucket < counts.size(); bucket++) {
+        counts[bucket] = commands[bucket * words + 1];
+    }
+    return counts;
+}
+
+/**
+ * Draws the buckets of `set`, one indirect command per LOD. gl_DrawID
+ * tells the vertex shader which LOD it draws.
+ * Leaves the VAO of `group` bound.
+ */
+void draw_lod_group(const LodGroup& group, GLuint set)
+{
+    const GLsizei n = static_cast<GLsizei>(group.meshes.size());
+    const auto offset = reinterpret_cast<const void*>(static_cast<GLintptr>(set * n * command_size(group)));
+
+    glBindVertexArray(group.vao);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, group.command_buffer);
+    if (indexed(group)) {
+        glMultiDrawElementsIndirect(group.mode, GL_UNSIGNED_INT, offset, n, 0);
+    }
+    else {
+        glMultiDrawArraysIndirect(group.mode, offset, n, 0);
+    }
+}
+
+void delete_lod_group(LodGroup& group)
+{
+    glDeleteBuffers(1, &group.command_buffer);
+    glDeleteBuffers(1, &group.ebo);
+    glDeleteBuffers(1, &group.vbo);
+    glDeleteVertexArrays(1, &group.vao);
+    group = LodGroup{};
+}
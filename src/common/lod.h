@@ -0,0 +1,55 @@
+#ifndef LOD_H_INCLUDED
+#define LOD_H_INCLUDED
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "glad.h"
+
+constexpr GLuint MAX_LODS{4};
+
+// Entries of the instance lists hold the instance id in the low 24 bits and
+// a crossfade code for shader/lod.frag in the high 8 bits
+constexpr GLuint LOD_ID_MASK{0xffffff};
+constexpr GLuint LOD_MAX_INSTANCES{LOD_ID_MASK + 1}; // more would alias in the id bits
+constexpr GLuint LOD_OPAQUE{127u << 24}; // crossfade code that keeps every pixel
+
+// A mesh of a LodGroup, a range of its shared vertex or index buffer
+struct LodMesh {
+    GLuint first{};      // first vertex, or first index if the group is indexed
+    GLuint count{};      // number of vertices or indices
+    GLint base_vertex{}; // added to the indices if the group is indexed
+};
+
+// Meshes of one object type, from coarse to fine, packed into one vertex
+// buffer and an optional index buffer. A culling pass buckets the instances
+// by their radius in pixels and appends them to one list per LOD, and a
+// single glMultiDraw*Indirect call draws every bucket with its own mesh.
+// A group may hold several sets of buckets, e.g. one per culling phase.
+struct LodGroup {
+    GLenum mode{GL_TRIANGLES};
+    std::vector<GLint> attribute_sizes; // floats per vertex attribute, at locations 0, 1, ...
+    std::vector<GLfloat> vertices;
+    std::vector<GLuint> indices;
+    std::vector<LodMesh> meshes;
+    glm::vec3 lod_radius{4.0f, 12.0f, 40.0f}; // radius in pixels where LOD i + 1 takes over from LOD i
+    GLfloat crossfade{};                      // relative width of the crossfade band around each radius, 0 for none
+    GLuint capacity{};                        // instances per bucket
+    GLuint sets{1};
+    GLuint vao{};
+    GLuint vbo{};
+    GLuint ebo{};
+    GLuint command_buffer{};
+};
+
+extern void add_lod_mesh(
+    LodGroup& group, const std::vector<GLfloat>& vertices,
+    const std::vector<GLuint>& indices = {});
+extern void upload_lod_group(LodGroup& group, GLuint capacity, GLuint sets = 1);
+extern GLuint lod_list_size(const LodGroup& group);
+extern void reset_lod_commands(const LodGroup& group);
+extern void set_lod_instance_count(const LodGroup& group, GLuint bucket, GLuint count);
+extern std::vector<GLuint> read_lod_instance_counts(const LodGroup& group);
+extern void draw_lod_group(const LodGroup& group, GLuint set = 0);
+extern void delete_lod_group(LodGroup& group);
+
+#endif // LOD_H_INCLUDED
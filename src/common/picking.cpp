@@ -0,0 +1,80 @@
+#include "picking.h"
+
+void create_id_picker(IdPicker& picker)
+{
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    for (PickRequest& request : picker.requests) {
+        glCreateBuffers(1, &request.pbo);
+        glNamedBufferStorage(request.pbo, sizeof(GLuint), nullptr, flags | GL_CLIENT_STORAGE_BIT);
+        request.mapped = static_cast<GLuint*>(glMapNamedBufferRange(request.pbo, 0, sizeof(GLuint), flags));
+    }
+}
+
+/**
+ * Queues the read of pixel (`x`, `y`) of color attachment 0 of `framebuffer`,
+ * which holds ids in GL_R32UI. The copy into the pixel buffer object is
+ * asynchronous, poll_id() returns the result. Returns false, without
+ * reading, if too many reads are pending.
+ */
+bool read_id(IdPicker& picker, GLuint framebuffer, GLint x, GLint y)
+{
+    if (picker.pending == MAX_PICK_REQUESTS) {
+        picker.dropped++;
+        return false;
+    }
+
+    PickRequest& request = picker.requests[(picker.head + picker.pending) % MAX_PICK_REQUESTS];
+    request.result = PickResult{0, x, y, 0};
+
+    // With a pixel pack buffer bound, glReadPixels only queues a copy into it
+    glNamedFramebufferReadBuffer(framebuffer, GL_COLOR_ATTACHMENT0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, request.pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(x, y, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    request.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    picker.pending++;
+    return true;
+}
+
+/**
+ * Checks, without waiting, whether the oldest pending read is done. If so,
+ * stores it in `result` and returns true. Call it once per frame, so that
+ * `result.frames` counts the frames the read took.
+ */
+bool poll_id(IdPicker& picker, PickResult& result)
+{
+    if (picker.pending == 0) {
+        return false;
+    }
+
+    // The first poll flushes the fence, so that it signals without waiting for a swap
+    PickRequest& request = picker.requests[picker.head];
+    const GLbitfield flags = request.result.frames == 0 ? GL_SYNC_FLUSH_COMMANDS_BIT : 0;
+    request.result.frames++;
+    const GLenum status = glClientWaitSync(request.fence, flags, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        return false;
+    }
+
+    glDeleteSync(request.fence);
+    request.fence = nullptr;
+    request.result.id = *request.mapped;
+    result = request.result;
+    picker.head = (picker.head + 1) % MAX_PICK_REQUESTS;
+    picker.pending--;
+    return true;
+}
+
+void delete_id_picker(IdPicker& picker)
+{
+    for (PickRequest& request : picker.requests) {
+        glDeleteSync(request.fence);
+        glUnmapNamedBuffer(request.pbo);
+        glDeleteBuffers(1, &request.pbo);
+    }
+    picker = IdPicker{};
+}
@@ -0,0 +1,40 @@
+#ifndef PICKING_H_INCLUDED
+#define PICKING_H_INCLUDED
+
+#include "glad.h"
+
+// A pixel read back from an id buffer by read_id()
+struct PickResult {
+    GLuint id{};  // 0 where nothing was drawn
+    GLint x{};    // framebuffer pixel, origin at the bottom left
+    GLint y{};
+    int frames{}; // polls until the fence signaled, usually 1 or 2
+};
+
+struct PickRequest {
+    GLuint pbo{};
+    GLuint* mapped{}; // persistently mapped, valid once the fence signaled
+    GLsync fence{};
+    PickResult result;
+};
+
+constexpr int MAX_PICK_REQUESTS{4};
+
+// Reads single pixels of an R32UI id buffer into pixel buffer objects. Each
+// read is guarded by a fence and resolved by a later poll once the GPU has
+// passed it, so picking never waits for the GPU, and costs the same whatever
+// the scene size and however the ids were drawn: GPU-generated, instanced
+// or SDF content works as well as geometry the CPU mirrors.
+struct IdPicker {
+    PickRequest requests[MAX_PICK_REQUESTS];
+    int head{};    // oldest pending request
+    int pending{};
+    int dropped{}; // reads refused because every request was pending
+};
+
+extern void create_id_picker(IdPicker& picker);
+extern bool read_id(IdPicker& picker, GLuint framebuffer, GLint x, GLint y);
+extern bool poll_id(IdPicker& picker, PickResult& result);
+extern void delete_id_picker(IdPicker& picker);
+
+#endif // PICKING_H_INCLUDED
@@ -0,0 +1,149 @@
+#include "glad.h"
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <vector>
+#include "polyline.h"
+#include "shader.h"
+#include "utils.h"
+
+GLuint create_polyline_transform_program()
+{
+    namespace fs = std::filesystem;
+    return compile_shaders({
+        fs::canonical(dirname() / ".." / "shader" / "polyline-transform.comp").c_str(),
+    });
+}
+
+static void dispatch_transform(
+    GLuint program, GLuint src_ssbo, GLuint dst_ssbo, GLsizei count,
+    const glm::mat4& mvp, glm::vec2 resolution)
+{
+    const GLint loc_mvp = glGetUniformLocation(program, "u_mvp");
+    const GLint loc_res = glGetUniformLocation(program, "u_resolution");
+    const GLint loc_cnt = glGetUniformLocation(program, "u_count");
+
+    glUniformMatrix4fv(loc_mvp, 1, GL_FALSE, glm::value_ptr(mvp));
+    glUniform2f(loc_res, resolution.x, resolution.y);
+    glUniform1ui(loc_cnt, static_cast<GLuint>(count));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, src_ssbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, dst_ssbo);
+
+    const GLuint local_size_x{256}; // must match shader/polyline-transform.comp
+    glDispatchCompute((count + local_size_x - 1) / local_size_x, 1, 1);
+
+    // Make the transformed points visible to the vertex shader that pulls them
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+/**
+ * Transforms `count` points from `src_ssbo` into window coordinates and writes
+ * them to `dst_ssbo`, which shader/line.vert reads from binding point 1.
+ * Each point is transformed once, instead of 24 times per segment when the
+ * vertex shader does it. Leaves `program` as the current program.
+ */
+void transform_polyline(
+    GLuint program, GLuint src_ssbo, GLuint dst_ssbo, GLsizei count,
+    const glm::mat4& mvp, glm::vec2 resolution)
+{
+    glUseProgram(program);
+    dispatch_transform(program, src_ssbo, dst_ssbo, count, mvp, resolution);
+}
+
+/**
+ * Same as above, but binds `program` through `state`, so that callers drawing
+ * through a GlState (e.g. a RenderQueue) keep their shadow state valid.
+ */
+void transform_polyline(
+    GlState& state, GLuint program, GLuint src_ssbo, GLuint dst_ssbo, GLsizei count,
+    const glm::mat4& mvp, glm::vec2 resolution)
+{
+    use_program(state, program);
+    dispatch_transform(program, src_ssbo, dst_ssbo, count, mvp, resolution);
+}
+
+GLuint create_polyline_batch_program()
+{
+    namespace fs = std::filesystem;
+    return compile_shaders({
+        fs::canonical(dirname() / ".." / "shader" / "polyline-batch.vert").c_str(),
+        fs::canonical(dirname() / ".." / "shader" / "polyline-batch.frag").c_str(),
+    });
+}
+
+/**
+ * Appends a polyline to `batch`.
+ * `points` specifies at least 2 points, or at least 3 if `closed` is true.
+ * `thickness` specifies the line width in pixels.
+ * `closed` connects the last point back to the first one.
+ */
+void add_polyline(
+    PolylineBatch& batch, const std::vector<glm::vec4>& points,
+    glm::vec4 color, float thickness, bool closed)
+{
+    const GLuint n = static_cast<GLuint>(points.size());
+    if (n < (closed ? 3u : 2u)) {
+        return;
+    }
+
+    PolylineDesc desc;
+    desc.first_point = static_cast<GLuint>(batch.points.size());
+    desc.num_points = n;
+    desc.first_segment = batch.num_segments;
+    desc.closed = closed;
+    desc.color = color;
+    desc.thickness = thickness;
+    batch.descs.emplace_back(desc);
+
+    batch.points.insert(batch.points.end(), points.begin(), points.end());
+    batch.num_segments += closed ? n : n - 1;
+}
+
+// Creates the SSBOs of `batch`. Call once after all polylines have been added.
+void upload_polyline_batch(PolylineBatch& batch)
+{
+    const GLsizeiptr points_size = batch.points.size() * sizeof(*batch.points.data());
+    const GLsizeiptr descs_size = batch.descs.size() * sizeof(*batch.descs.data());
+
+    glCreateBuffers(1, &batch.point_ssbo);
+    glNamedBufferStorage(batch.point_ssbo, points_size, batch.points.data(), 0);
+    glCreateBuffers(1, &batch.screen_ssbo);
+    glNamedBufferStorage(batch.screen_ssbo, points_size, nullptr, 0);
+    glCreateBuffers(1, &batch.desc_ssbo);
+    glNamedBufferStorage(batch.desc_ssbo, descs_size, batch.descs.data(), 0);
+}
+
+/**
+ * Draws every polyline of `batch` with one transform dispatch and one draw call.
+ * The owning polyline of each segment is found by a binary search over the
+ * descriptors in the vertex shader. Leaves `program` as the current program.
+ */
+void draw_polyline_batch(
+    const PolylineBatch& batch, GLuint transform_program, GLuint program,
+    const glm::mat4& mvp, glm::vec2 resolution)
+{
+    if (batch.descs.empty()) {
+        return;
+    }
+
+    transform_polyline(transform_program, batch.point_ssbo, batch.screen_ssbo,
+        static_cast<GLsizei>(batch.points.size()), mvp, resolution);
+
+    const GLint loc_res = glGetUniformLocation(program, "u_resolution");
+    const GLint loc_num = glGetUniformLocation(program, "u_num_polylines");
+
+    glUseProgram(program);
+    glUniform2f(loc_res, resolution.x, resolution.y);
+    glUniform1ui(loc_num, static_cast<GLuint>(batch.descs.size()));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, batch.screen_ssbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, batch.desc_ssbo);
+    glDrawArrays(GL_TRIANGLES, 0, 6 * static_cast<GLsizei>(batch.num_segments));
+}
+
+void delete_polyline_batch(PolylineBatch& batch)
+{
+    glDeleteBuffers(1, &batch.point_ssbo);
+    glDeleteBuffers(1, &batch.screen_ssbo);
+    glDeleteBuffers(1, &batch.desc_ssbo);
+    batch = PolylineBatch{};
+}
@@ -0,0 +1,50 @@
+#ifndef POLYLINE_H_INCLUDED
+#define POLYLINE_H_INCLUDED
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "glad.h"
+#include "glstate.h"
+
+// Per-polyline descriptor, laid out as std430 struct Polyline in shader/polyline-batch.vert
+struct PolylineDesc {
+    GLuint first_point{};   // index of the first point in the batch
+    GLuint num_points{};
+    GLuint first_segment{}; // number of segments in all preceding polylines
+    GLuint closed{};
+    glm::vec4 color{};
+    GLfloat thickness{};    // in pixels
+    GLfloat padding[3]{};
+};
+static_assert(sizeof(PolylineDesc) == 48, "PolylineDesc must match the std430 layout");
+
+// Many polylines packed into one point SSBO and one descriptor SSBO,
+// so that all of them are drawn with a single glDrawArrays call
+struct PolylineBatch {
+    std::vector<glm::vec4> points;
+    std::vector<PolylineDesc> descs;
+    GLuint num_segments{};
+    GLuint point_ssbo{};
+    GLuint screen_ssbo{};
+    GLuint desc_ssbo{};
+};
+
+extern GLuint create_polyline_transform_program();
+extern void transform_polyline(
+    GLuint program, GLuint src_ssbo, GLuint dst_ssbo, GLsizei count,
+    const glm::mat4& mvp, glm::vec2 resolution);
+extern void transform_polyline(
+    GlState& state, GLuint program, GLuint src_ssbo, GLuint dst_ssbo, GLsizei count,
+    const glm::mat4& mvp, glm::vec2 resolution);
+
+extern GLuint create_polyline_batch_program();
+extern void add_polyline(
+    PolylineBatch& batch, const std::vector<glm::vec4>& points,
+    glm::vec4 color, float thickness, bool closed);
+extern void upload_polyline_batch(PolylineBatch& batch);
+extern void draw_polyline_batch(
+    const PolylineBatch& batch, GLuint transform_program, GLuint program,
+    const glm::mat4& mvp, glm::vec2 resolution);
+extern void delete_polyline_batch(PolylineBatch& batch);
+
+#endif // POLYLINE_H_INCLUDED
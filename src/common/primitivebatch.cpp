@@ -0,0 +1,81 @@
+#include "glad.h"
+#include <initializer_list>
+#include <vector>
+#include "primitivebatch.h"
+
+/**
+ * Appends a part of `count` vertices starting at `first` to `batch`, which
+ * draws it as a separate primitive of its mode.
+ */
+void add_part(PrimitiveBatch& batch, GLint first, GLsizei count)
+{
+    if (!batch.indices.empty()) {
+        batch.indices.emplace_back(RESTART_INDEX);
+    }
+    for (GLsizei i{}; i < count; i++) {
+        batch.indices.emplace_back(static_cast<GLuint>(first + i));
+    }
+    batch.firsts.emplace_back(first);
+    batch.counts.emplace_back(count);
+}
+
+/**
+ * Copies the indices of `batches` into one element buffer, attached to
+ * `vao`, and returns it. The batches must draw from the vertex buffers of
+ * `vao`, and must not change afterwards.
+ */
+GLuint upload_primitive_batches(GLuint vao, std::initializer_list<PrimitiveBatch*> batches)
+{
+    std::vector<GLuint> indices;
+    for (PrimitiveBatch* batch : batches) {
+        batch->offset = indices.size() * sizeof(GLuint);
+        indices.insert(indices.end(), batch->indices.begin(), batch->indices.end());
+    }
+
+    GLuint ibo{};
+    glCreateBuffers(1, &ibo);
+    glNamedBufferStorage(ibo, indices.size() * sizeof(GLuint), indices.data(), 0);
+    glVertexArrayElementBuffer(vao, ibo);
+    return ibo;
+}
+
+/**
+ * Draws all parts of `batch`, from the VAO its indices were uploaded to,
+ * which must be bound. Returns the number of draw calls it took.
+ * SUBMIT_RESTART leaves GL_PRIMITIVE_RESTART_FIXED_INDEX enabled.
+ */
+int draw_primitive_batch(const PrimitiveBatch& batch, BatchSubmit submit)
+{
+    const GLsizei parts = static_cast<GLsizei>(batch.counts.size());
+    if (parts == 0) {
+        return 0;
+    }
+
+    switch (submit) {
+    case SUBMIT_SEPARATE:
+        for (GLsizei i{}; i < parts; i++) {
+            glDrawArrays(batch.mode, batch.firsts[i], batch.counts[i]);
+        }
+        return parts;
+    case SUBMIT_MULTI_DRAW:
+        glMultiDrawArrays(batch.mode, batch.firsts.data(), batch.counts.data(), parts);
+        return 1;
+    default:
+        glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+        glDrawElements(batch.mode, static_cast<GLsizei>(batch.indices.size()), GL_UNSIGNED_INT,
+            reinterpret_cast<const void*>(batch.offset));
+        return 1;
+    }
+}
+
+const char* batch_submit_name(BatchSubmit submit)
+{
+    switch (submit) {
+    case SUBMIT_SEPARATE:
+        return "separate";
+    case SUBMIT_MULTI_DRAW:
+        return "multi-draw";
+    default:
+        return "restart";
+    }
+}
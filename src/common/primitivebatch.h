@@ -0,0 +1,35 @@
+#ifndef PRIMITIVEBATCH_H_INCLUDED
+#define PRIMITIVEBATCH_H_INCLUDED
+
+#include <initializer_list>
+#include <vector>
+#include "glad.h"
+
+// Ends a primitive in GL_UNSIGNED_INT indices, with GL_PRIMITIVE_RESTART_FIXED_INDEX
+constexpr GLuint RESTART_INDEX{0xFFFFFFFF};
+
+// How draw_primitive_batch() submits the parts of a batch
+enum BatchSubmit {
+    SUBMIT_SEPARATE,   // a glDrawArrays per part, as without batching
+    SUBMIT_MULTI_DRAW, // one glMultiDrawArrays, without indices
+    SUBMIT_RESTART,    // one glDrawElements, the parts separated by RESTART_INDEX
+};
+
+// Parts of consecutive vertices drawn with the same mode, such as the fans
+// of a rounded rectangle or the rings of a web, merged so that the whole
+// sequence is submitted with one call. Fans, strips, line strips and line
+// loops all restart, so any of them can be batched.
+struct PrimitiveBatch {
+    GLenum mode{};
+    std::vector<GLint> firsts;   // of each part
+    std::vector<GLsizei> counts;
+    std::vector<GLuint> indices; // of all parts, with RESTART_INDEX between them
+    GLintptr offset{};           // of the indices in the element buffer
+};
+
+extern void add_part(PrimitiveBatch& batch, GLint first, GLsizei count);
+extern GLuint upload_primitive_batches(GLuint vao, std::initializer_list<PrimitiveBatch*> batches);
+extern int draw_primitive_batch(const PrimitiveBatch& batch, BatchSubmit submit);
+extern const char* batch_submit_name(BatchSubmit submit);
+
+#endif // PRIMITIVEBATCH_H_INCLUDED
@@ -0,0 +1,156 @@
+#include "glad.h"
+#include <algorithm>
+#include <glm/gtc/type_ptr.hpp>
+#include <utility>
+#include "renderqueue.h"
+
+// Bit fields of a sort key, from most to least significant
+constexpr int PASS_BITS{4};
+constexpr int PROGRAM_BITS{12};
+constexpr int VAO_BITS{12};
+constexpr int MATERIAL_BITS{16};
+constexpr int DEPTH_BITS{20};
+static_assert(PASS_BITS + PROGRAM_BITS + VAO_BITS + MATERIAL_BITS + DEPTH_BITS == 64);
+static_assert(MAX_RENDER_PASSES == 1u << PASS_BITS);
+
+static std::uint64_t field(std::uint64_t value, int bits, int shift)
+{
+    return (value & ((std::uint64_t{1} << bits) - 1)) << shift;
+}
+
+void set_pass_state(RenderQueue& queue, GLuint pass, const PassState& state)
+{
+    queue.passes[pass] = state;
+}
+
+/**
+ * Registers a material, a function that sets the uniforms and bindings
+ * shared by the draws that use it. It is called after binding the program.
+ * Returns the id to store in DrawPacket::material.
+ */
+GLuint add_material(RenderQueue& queue, std::function<void()> apply)
+{
+    queue.materials.emplace_back(std::move(apply));
+    return static_cast<GLuint>(queue.materials.size());
+}
+
+/**
+ * Returns the sort key of `packet`: 4 bits pass, 12 bits program, 12 bits
+ * VAO, 16 bits material and 20 bits depth. Object names wider than their
+ * field only weaken the grouping, never the correctness of the submission.
+ */
+std::uint64_t make_sort_key(const DrawPacket& packet)
+{
+    const float depth = std::clamp(packet.depth, 0.0f, 1.0f);
+    const auto quantized = static_cast<std::uint64_t>(depth * ((1u << DEPTH_BITS) - 1));
+    return field(packet.pass, PASS_BITS, 60) |
+           field(packet.program, PROGRAM_BITS, 48) |
+           field(packet.vao, VAO_BITS, 36) |
+           field(packet.material, MATERIAL_BITS, 20) |
+           field(quantized, DEPTH_BITS, 0);
+}
+
+void push_draw(RenderQueue& queue, const DrawPacket& packet)
+{
+    queue.packets.emplace_back(packet);
+    queue.keys.emplace_back(make_sort_key(packet));
+}
+
+// Stable LSD radix sort of the packet indices by key, one byte per round.
+// Rounds where every key has the same byte are skipped, which is the common
+// case for the pass and the high bits of the object names.
+static void sort_packets(RenderQueue& queue)
+{
+    const auto n = static_cast<std::uint32_t>(queue.keys.size());
+    queue.order.resize(n);
+    queue.scratch.resize(n);
+    for (std::uint32_t i{}; i < n; i++) {
+        queue.order[i] = i;
+    }
+
+    for (int shift{}; shift < 64; shift += 8) {
+        std::uint32_t offsets[256]{};
+        for (const std::uint64_t key : queue.keys) {
+            offsets[(key >> shift) & 0xff]++;
+        }
+        if (n == 0 || offsets[(queue.keys[0] >> shift) & 0xff] == n) {
+            continue;
+        }
+
+        std::uint32_t sum{};
+        for (std::uint32_t& offset : offsets) {
+            const std::uint32_t count = offset;
+            offset = sum;
+            sum += count;
+        }
+        for (const std::uint32_t i : queue.order) {
+            queue.scratch[offsets[(queue.keys[i] >> shift) & 0xff]++] = i;
+        }
+        std::swap(queue.order, queue.scratch);
+    }
+}
+
+static void draw(const DrawPacket& packet)
+{
+    if (packet.index_type) {
+        const auto offset = static_cast<GLintptr>(packet.first) *
+            (packet.index_type == GL_UNSIGNED_INT ? 4 : packet.index_type == GL_UNSIGNED_SHORT ? 2 : 1);
+        glDrawElementsInstanced(
+            packet.mode, packet.count, packet.index_type,
+            reinterpret_cast<const void*>(offset), packet.instance_count);
+    }
+    else {
+        glDrawArraysInstanced(packet.mode, packet.first, packet.count, packet.instance_count);
+    }
+}
+
+/**
+ * Sorts and submits every draw pushed since the last submission, then
+ * empties the queue. Passes, programs, VAOs and materials are only changed
+ * between draws that differ in them. A material is applied again after a
+ * program change, since its uniforms belong to the program.
+ * Returns the number of draws and state changes issued.
+ */
+RenderQueueStats submit_render_queue(RenderQueue& queue)
+{
+    sort_packets(queue);
+
+    RenderQueueStats stats;
+    const DrawPacket* last{};
+    for (const std::uint32_t i : queue.order) {
+        const DrawPacket& packet = queue.packets[i];
+
+        if (!last || last->pass != packet.pass) {
+            const PassState& pass = queue.passes[packet.pass];
+            set_polygon_mode(queue.state, pass.polygon_mode);
+            set_depth_test(queue.state, pass.depth_test);
+            set_blend(queue.state, pass.blend);
+            stats.pass_changes++;
+        }
+
+        const bool program_changed = !last || last->program != packet.program;
+        if (program_changed) {
+            use_program(queue.state, packet.program);
+            stats.program_changes++;
+        }
+        if (!last || last->vao != packet.vao) {
+            bind_vertex_array(queue.state, packet.vao);
+            stats.vao_changes++;
+        }
+        if (packet.material && (program_changed || last->material != packet.material)) {
+            queue.materials[packet.material - 1]();
+            stats.material_changes++;
+        }
+
+        if (packet.transform_location >= 0) {
+            glUniformMatrix4fv(packet.transform_location, 1, GL_FALSE, glm::value_ptr(packet.transform));
+        }
+        draw(packet);
+        stats.draws++;
+        last = &packet;
+    }
+
+    queue.packets.clear();
+    queue.keys.clear();
+    return stats;
+}
@@ -0,0 +1,64 @@
+#ifndef RENDERQUEUE_H_INCLUDED
+#define RENDERQUEUE_H_INCLUDED
+
+#include <cstdint>
+#include <functional>
+#include <glm/glm.hpp>
+#include <vector>
+#include "glad.h"
+#include "glstate.h"
+
+constexpr GLuint MAX_RENDER_PASSES{16};
+
+// Fixed-function state set once when a pass begins
+struct PassState {
+    GLenum polygon_mode{GL_FILL};
+    bool depth_test{};
+    bool blend{};
+};
+
+// One draw call with everything needed to issue it
+struct DrawPacket {
+    GLuint pass{};                  // [0..MAX_RENDER_PASSES), drawn in increasing order
+    GLuint program{};
+    GLuint vao{};
+    GLuint material{};              // id returned by add_material(), 0 for none
+    float depth{};                  // [0..1], drawn front to back within equal state
+    GLenum mode{GL_TRIANGLES};
+    GLint first{};                  // first vertex, or first index if `index_type` is set
+    GLsizei count{};
+    GLsizei instance_count{1};
+    GLenum index_type{};            // 0 for glDrawArrays*, else the type of the indices
+    GLint transform_location{-1};   // uniform location of `transform`, -1 for none
+    glm::mat4 transform{1.0f};
+};
+
+// Number of GL calls of one submission
+struct RenderQueueStats {
+    int draws{};
+    int pass_changes{};
+    int program_changes{};
+    int vao_changes{};
+    int material_changes{};
+};
+
+// Collects the draws of a frame, sorts them by a 64-bit key so that draws
+// sharing a pass, program, VAO and material end up next to each other, and
+// submits them through a GlState so that only state changes reach GL.
+struct RenderQueue {
+    PassState passes[MAX_RENDER_PASSES];
+    std::vector<std::function<void()>> materials; // applied after binding the program
+    std::vector<DrawPacket> packets;
+    std::vector<std::uint64_t> keys;    // sort key of each packet
+    std::vector<std::uint32_t> order;   // packet indices in submission order
+    std::vector<std::uint32_t> scratch;
+    GlState state;
+};
+
+extern void set_pass_state(RenderQueue& queue, GLuint pass, const PassState& state);
+extern GLuint add_material(RenderQueue& queue, std::function<void()> apply);
+extern std::uint64_t make_sort_key(const DrawPacket& packet);
+extern void push_draw(RenderQueue& queue, const DrawPacket& packet);
+extern RenderQueueStats submit_render_queue(RenderQueue& queue);
+
+#endif // RENDERQUEUE_H_INCLUDED
@@ -0,0 +1,334 @@
+#include <cstdint>
+#include <cstdlib>
+#include <fmt/core.h>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "replay.h"
+
+// What a logged event is
+enum InputEventType : std::uint8_t {
+    EVENT_KEY,
+    EVENT_MOUSE_BUTTON,
+    EVENT_CURSOR,
+    EVENT_SCROLL,
+    EVENT_WINDOW_SIZE,
+    EVENT_END, // the frame the recording stopped at, always last
+};
+
+// One callback, 40 bytes in the log
+struct InputEvent {
+    double x{}, y{};          // cursor position, scroll offset or window size
+    std::uint32_t frame{};    // poll_input() calls before the event
+    float offset{};           // seconds since the frame started
+    std::int32_t code{};      // key or mouse button
+    std::int32_t scancode{};
+    std::uint16_t mods{};
+    std::uint8_t type{};
+    std::uint8_t action{};
+};
+
+// Starts the log, followed by its events
+struct InputLogHeader {
+    char magic[4]{'G', 'L', 'I', 'N'};
+    std::uint32_t version{1};
+    std::int32_t width{}, height{}; // of the window when the recording started
+};
+
+struct InputLog {
+    ReplayMode mode{REPLAY_OFF};
+    std::string path;
+    InputLogHeader header;
+    std::vector<InputEvent> events;
+    std::size_t next{};          // event to replay
+    std::uint32_t frame{};
+    std::uint32_t end_frame{};
+    double frame_start{};        // time the current frame started
+    double start_time{};         // of attach_input_log()
+    double cursor_x{}, cursor_y{}; // replayed
+    int buttons[GLFW_MOUSE_BUTTON_LAST + 1]{}; // replayed
+    GLFWkeyfun key_callback{};   // of the demo
+    GLFWmousebuttonfun mouse_button_callback{};
+    GLFWcursorposfun cursor_pos_callback{};
+    GLFWscrollfun scroll_callback{};
+    GLFWwindowsizefun window_size_callback{};
+};
+
+static InputLog input_log;
+
+static bool read_input_log(const std::string& path)
+{
+    std::ifstream file{path, std::ios::binary};
+    InputLogHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::string_view{header.magic, 4} != std::string_view{InputLogHeader{}.magic, 4} ||
+        header.version != InputLogHeader{}.version) {
+        fmt::print(stderr, "ERROR: {} is not an input log\n", path);
+        return false;
+    }
+
+    InputEvent event;
+    input_log.header = header;
+    while (file.read(reinterpret_cast<char*>(&event), sizeof(event))) {
+        input_log.events.push_back(event);
+    }
+    if (input_log.events.empty() || input_log.events.back().type != EVENT_END) {
+        fmt::print(stderr, "ERROR: Input log {} is truncated\n", path);
+        return false;
+    }
+    input_log.end_frame = input_log.events.back().frame;
+    return true;
+}
+
+static void write_input_log()
+{
+    std::ofstream file{input_log.path, std::ios::binary};
+    file.write(reinterpret_cast<const char*>(&input_log.header), sizeof(input_log.header));
+    file.write(reinterpret_cast<const char*>(input_log.events.data()), input_log.events.size()*sizeof(InputEvent));
+    if (!file) {
+        fmt::print(stderr, "ERROR: Failed to write input log {}\n", input_log.path);
+    }
+}
+
+/**
+ * Looks for `--record <file>` or `--replay <file>` in the command line and
+ * removes it, so that the demo parses its own arguments as before. A replay
+ * reads the whole log here and hides the windows created afterwards.
+ * Call it after glfwInit() and before glfwCreateWindow().
+ */
+ReplayMode start_input_log(int& argc, char* argv[])
+{
+    int kept{1};
+    for (int i{1}; i < argc; i++) {
+        const std::string_view arg{argv[i]};
+        if ((arg == "--record" || arg == "--replay") && i + 1 < argc) {
+            input_log.mode = arg == "--record" ? REPLAY_RECORD : REPLAY_PLAY;
+            input_log.path = argv[++i];
+        }
+        else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+    argv[argc] = nullptr;
+
+    if (input_log.mode == REPLAY_PLAY) {
+        if (read_input_log(input_log.path)) {
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        }
+        else {
+            input_log.mode = REPLAY_OFF;
+        }
+    }
+    return input_log.mode;
+}
+
+// Logs an event of the current frame when recording. Returns whether to
+// pass it on to the demo, which a replay does only for its own events.
+static bool log_event(InputEvent event)
+{
+    if (input_log.mode == REPLAY_RECORD) {
+        event.frame = input_log.frame;
+        event.offset = static_cast<float>(glfwGetTime() - input_log.frame_start);
+        input_log.events.push_back(event);
+    }
+    return input_log.mode != REPLAY_PLAY;
+}
+
+/**
+ * Puts the input log between `window` and the callbacks the demo set,
+ * which it calls from then on. A replay sizes the window like the recorded
+ * one and turns vsync off.
+ */
+void attach_input_log(GLFWwindow* window)
+{
+    if (input_log.mode == REPLAY_OFF) {
+        return;
+    }
+
+    input_log.key_callback = glfwSetKeyCallback(
+        window,
+        [](GLFWwindow* window, int key, int scancode, int action, int mods) {
+            InputEvent event{};
+            event.type = EVENT_KEY;
+            event.code = key;
+            event.scancode = scancode;
+            event.action = static_cast<std::uint8_t>(action);
+            event.mods = static_cast<std::uint16_t>(mods);
+            if (log_event(event) && input_log.key_callback) {
+                input_log.key_callback(window, key, scancode, action, mods);
+            }
+        }
+    );
+    input_log.mouse_button_callback = glfwSetMouseButtonCallback(
+        window,
+        [](GLFWwindow* window, int button, int action, int mods) {
+            InputEvent event{};
+            event.type = EVENT_MOUSE_BUTTON;
+            event.code = button;
+            event.action = static_cast<std::uint8_t>(action);
+            event.mods = static_cast<std::uint16_t>(mods);
+            if (log_event(event) && input_log.mouse_button_callback) {
+                input_log.mouse_button_callback(window, button, action, mods);
+            }
+        }
+    );
+    input_log.cursor_pos_callback = glfwSetCursorPosCallback(
+        window,
+        [](GLFWwindow* window, double xpos, double ypos) {
+            InputEvent event{};
+            event.type = EVENT_CURSOR;
+            event.x = xpos;
+            event.y = ypos;
+            if (log_event(event) && input_log.cursor_pos_callback) {
+                input_log.cursor_pos_callback(window, xpos, ypos);
+            }
+        }
+    );
+    input_log.scroll_callback = glfwSetScrollCallback(
+        window,
+        [](GLFWwindow* window, double xoffset, double yoffset) {
+            InputEvent event{};
+            event.type = EVENT_SCROLL;
+            event.x = xoffset;
+            event.y = yoffset;
+            if (log_event(event) && input_log.scroll_callback) {
+                input_log.scroll_callback(window, xoffset, yoffset);
+            }
+        }
+    );
+    input_log.window_size_callback = glfwSetWindowSizeCallback(
+        window,
+        [](GLFWwindow* window, int width, int height) {
+            InputEvent event{};
+            event.type = EVENT_WINDOW_SIZE;
+            event.x = width;
+            event.y = height;
+            // A replay resizes the window itself, which the demo must see
+            if ((log_event(event) || input_log.mode == REPLAY_PLAY) && input_log.window_size_callback) {
+                input_log.window_size_callback(window, width, height);
+            }
+        }
+    );
+
+    if (input_log.mode == REPLAY_RECORD) {
+        glfwGetWindowSize(window, &input_log.header.width, &input_log.header.height);
+    }
+    else {
+        glfwSetWindowSize(window, input_log.header.width, input_log.header.height);
+        glfwSwapInterval(0);
+        fmt::print("Replaying {} frames from {}.\n", input_log.end_frame, input_log.path);
+    }
+    input_log.start_time = glfwGetTime();
+    input_log.frame_start = input_log.start_time;
+}
+
+static void replay_event(GLFWwindow* window, const InputEvent& event)
+{
+    switch (event.type) {
+    case EVENT_KEY:
+        if (input_log.key_callback) {
+            input_log.key_callback(window, event.code, event.scancode, event.action, event.mods);
+        }
+        break;
+    case EVENT_MOUSE_BUTTON:
+        if (event.code >= 0 && event.code <= GLFW_MOUSE_BUTTON_LAST) {
+            input_log.buttons[event.code] = event.action;
+        }
+        if (input_log.mouse_button_callback) {
+            input_log.mouse_button_callback(window, event.code, event.action, event.mods);
+        }
+        break;
+    case EVENT_CURSOR:
+        input_log.cursor_x = event.x;
+        input_log.cursor_y = event.y;
+        if (input_log.cursor_pos_callback) {
+            input_log.cursor_pos_callback(window, event.x, event.y);
+        }
+        break;
+    case EVENT_SCROLL:
+        if (input_log.scroll_callback) {
+            input_log.scroll_callback(window, event.x, event.y);
+        }
+        break;
+    case EVENT_WINDOW_SIZE:
+        glfwSetWindowSize(window, static_cast<int>(event.x), static_cast<int>(event.y));
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Ends a frame: processes the events that arrived, waiting up to `timeout`
+ * seconds for one unless replaying. A replay instead delivers the events
+ * recorded in this frame, without waiting, and closes the window after the
+ * last recorded frame.
+ */
+void poll_input(GLFWwindow* window, double timeout)
+{
+    if (input_log.mode != REPLAY_PLAY && timeout > 0.0) {
+        glfwWaitEventsTimeout(timeout);
+    }
+    else {
+        glfwPollEvents();
+    }
+
+    if (input_log.mode == REPLAY_PLAY) {
+        while (input_log.next < input_log.events.size() && input_log.events[input_log.next].frame <= input_log.frame) {
+            replay_event(window, input_log.events[input_log.next++]);
+        }
+        if (input_log.frame + 1 >= input_log.end_frame) {
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
+        }
+    }
+    input_log.frame++;
+    input_log.frame_start = glfwGetTime();
+}
+
+// Writes the recording, or prints how long the replay took
+void stop_input_log()
+{
+    const double elapsed = glfwGetTime() - input_log.start_time;
+    if (input_log.mode == REPLAY_RECORD) {
+        InputEvent end{};
+        end.type = EVENT_END;
+        end.frame = input_log.frame;
+        input_log.events.push_back(end);
+        write_input_log();
+        fmt::print("Recorded {} input events in {} frames to {}.\n",
+            input_log.events.size() - 1, input_log.frame, input_log.path);
+    }
+    else if (input_log.mode == REPLAY_PLAY) {
+        fmt::print("Replayed {} frames in {:.3f} s, {:.3f} ms per frame.\n",
+            input_log.frame, elapsed, input_log.frame ? elapsed * 1000.0 / input_log.frame : 0.0);
+    }
+    input_log.mode = REPLAY_OFF;
+}
+
+ReplayMode input_log_mode()
+{
+    return input_log.mode;
+}
+
+// glfwGetCursorPos(), which in a replay gives the replayed position
+void get_cursor_pos(GLFWwindow* window, double* xpos, double* ypos)
+{
+    if (input_log.mode == REPLAY_PLAY) {
+        *xpos = input_log.cursor_x;
+        *ypos = input_log.cursor_y;
+    }
+    else {
+        glfwGetCursorPos(window, xpos, ypos);
+    }
+}
+
+// glfwGetMouseButton(), which in a replay gives the replayed state
+int get_mouse_button(GLFWwindow* window, int button)
+{
+    if (input_log.mode == REPLAY_PLAY) {
+        return input_log.buttons[button];
+    }
+    return glfwGetMouseButton(window, button);
+}
@@ -0,0 +1,36 @@
+#ifndef REPLAY_H_INCLUDED
+#define REPLAY_H_INCLUDED
+
+#include <GLFW/glfw3.h>
+
+// What the input log of the process does
+enum ReplayMode : int {
+    REPLAY_OFF,
+    REPLAY_RECORD, // --record <file>: logs the input of a live session
+    REPLAY_PLAY,   // --replay <file>: feeds a logged session back, headless
+};
+
+constexpr double REPLAY_FRAME_TIME{1.0 / 60.0}; // seconds per frame in a replay, see set_deterministic()
+
+// Records the key, mouse button, cursor, scroll and window size callbacks
+// of a window, each with the frame it arrived in, into a binary log, and
+// replays them into the same callbacks at the same frames. A replay hides
+// the window, turns vsync off and ignores live input, and the demo puts its
+// FixedTimestep into deterministic mode with REPLAY_FRAME_TIME, so that runs
+// of different builds see the same interaction and animation and can be
+// compared by their time per frame.
+//
+// There is one log per process, as GLFW callbacks carry no state of their
+// own. Call start_input_log() before creating the window,
+// attach_input_log() after setting its callbacks, poll_input() in place of
+// glfwPollEvents() once per frame and stop_input_log() before destroying
+// the window.
+extern ReplayMode start_input_log(int& argc, char* argv[]);
+extern void attach_input_log(GLFWwindow* window);
+extern void poll_input(GLFWwindow* window, double timeout = 0.0);
+extern void stop_input_log();
+extern ReplayMode input_log_mode();
+extern void get_cursor_pos(GLFWwindow* window, double* xpos, double* ypos);
+extern int get_mouse_button(GLFWwindow* window, int button);
+
+#endif // REPLAY_H_INCLUDED
@@ -0,0 +1,88 @@
+#include "glad.h"
+#include <filesystem>
+#include <vector>
+#include "scan.h"
+#include "shader.h"
+#include "utils.h"
+
+static constexpr GLuint block_size{512}; // must match shader/scan-block.comp
+
+static GLuint num_blocks(GLuint count)
+{
+    return (count + block_size - 1) / block_size;
+}
+
+/**
+ * Compiles the scan programs and allocates the block totals for scanning
+ * up to `capacity` elements. Each level holds one total per block of the
+ * level below, until a single block is left.
+ */
+void create_scan(Scan& scan, GLuint capacity)
+{
+    namespace fs = std::filesystem;
+    scan.block_program = compile_shaders({
+        fs::canonical(dirname() / ".." / "shader" / "scan-block.comp").c_str(),
+    });
+    scan.add_program = compile_shaders({
+        fs::canonical(dirname() / ".." / "shader" / "scan-add.comp").c_str(),
+    });
+    scan.capacity = capacity;
+
+    for (GLuint n = num_blocks(capacity); n > 1; n = num_blocks(n)) {
+        GLuint buffer{};
+        glCreateBuffers(1, &buffer);
+        glNamedBufferStorage(buffer, n * sizeof(GLfloat), nullptr, 0);
+        scan.sums.emplace_back(buffer);
+    }
+}
+
+void delete_scan(Scan& scan)
+{
+    glDeleteBuffers(static_cast<GLsizei>(scan.sums.size()), scan.sums.data());
+    glDeleteProgram(scan.add_program);
+    glDeleteProgram(scan.block_program);
+    scan = Scan{};
+}
+
+static void scan_level(const Scan& scan, GLuint buffer, GLuint count, size_t level)
+{
+    const GLuint blocks = num_blocks(count);
+    const bool multi_block = blocks > 1;
+
+    glUseProgram(scan.block_program);
+    glUniform1ui(0, count);
+    glUniform1i(1, multi_block);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffer);
+    if (multi_block) {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, scan.sums[level]);
+    }
+    glDispatchCompute(blocks, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    if (multi_block) {
+        // Scan the block totals, then add them to the blocks that follow
+        scan_level(scan, scan.sums[level], blocks, level + 1);
+
+        glUseProgram(scan.add_program);
+        glUniform1ui(0, count);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, scan.sums[level]);
+        glDispatchCompute(blocks - 1, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+}
+
+/**
+ * Replaces the first `count` floats of `buffer` with their inclusive prefix
+ * sum, entirely on the GPU. `count` must not exceed the capacity of `scan`.
+ * The caller must issue any glMemoryBarrier needed by the consumer of the
+ * result other than a shader storage read, e.g. GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT.
+ * Leaves one of the scan programs as the current program.
+ */
+void inclusive_scan(const Scan& scan, GLuint buffer, GLuint count)
+{
+    if (count == 0 || count > scan.capacity) {
+        return;
+    }
+    scan_level(scan, buffer, count, 0);
+}
@@ -0,0 +1,19 @@
+#ifndef SCAN_H_INCLUDED
+#define SCAN_H_INCLUDED
+
+#include <vector>
+#include "glad.h"
+
+// GPU inclusive prefix sum over an SSBO of floats
+struct Scan {
+    GLuint block_program{};
+    GLuint add_program{};
+    std::vector<GLuint> sums; // block totals, one buffer per level
+    GLuint capacity{};
+};
+
+extern void create_scan(Scan& scan, GLuint capacity);
+extern void delete_scan(Scan& scan);
+extern void inclusive_scan(const Scan& scan, GLuint buffer, GLuint count);
+
+#endif // SCAN_H_INCLUDED
@@ -0,0 +1,90 @@
+#include "scheduler.h"
+
+/**
+ * Registers the iconify and refresh callbacks of `window`, which the demos
+ * do not use otherwise, to keep `scheduler` informed. The scheduler must
+ * outlive the window, whose user pointer it takes.
+ */
+void set_scheduler_callbacks(FrameScheduler& scheduler, GLFWwindow* window)
+{
+    glfwSetWindowUserPointer(window, &scheduler);
+    glfwSetWindowIconifyCallback(
+        window,
+        [](GLFWwindow* window, int iconified) {
+            FrameScheduler& scheduler = *static_cast<FrameScheduler*>(glfwGetWindowUserPointer(window));
+            scheduler.iconified = iconified;
+            request_redraw(scheduler);
+        }
+    );
+    glfwSetWindowRefreshCallback(
+        window,
+        [](GLFWwindow* window) {
+            // The window system lost the contents, e.g. after being covered
+            request_redraw(*static_cast<FrameScheduler*>(glfwGetWindowUserPointer(window)));
+        }
+    );
+}
+
+void request_redraw(FrameScheduler& scheduler)
+{
+    scheduler.dirty = true;
+}
+
+void set_animating(FrameScheduler& scheduler, bool animating)
+{
+    scheduler.animating = animating;
+    request_redraw(scheduler);
+}
+
+void set_window_focused(FrameScheduler& scheduler, bool focused)
+{
+    scheduler.focused = focused;
+    request_redraw(scheduler);
+}
+
+static bool wants_frame(const FrameScheduler& scheduler)
+{
+    return !scheduler.iconified &&
+        (scheduler.policy == FRAME_CONTINUOUS || scheduler.animating || scheduler.dirty);
+}
+
+/**
+ * Processes events, waiting for them while there is nothing to render or
+ * the next frame of an unfocused window is not due yet. Returns whether to
+ * render a frame now, and then counts it as rendered.
+ * Call it in place of glfwPollEvents() in the frame loop.
+ */
+bool wait_for_frame(FrameScheduler& scheduler)
+{
+    const double interval = scheduler.focused ? 0.0 : scheduler.unfocused_interval;
+    const double due = scheduler.last_frame + interval;
+    const double now = glfwGetTime();
+    if (!wants_frame(scheduler)) {
+        glfwWaitEventsTimeout(scheduler.idle_timeout);
+    }
+    else if (now < due) {
+        glfwWaitEventsTimeout(due - now);
+    }
+    else {
+        glfwPollEvents();
+    }
+
+    const double time = glfwGetTime();
+    if (scheduler.animating) {
+        scheduler.animation_time += time - scheduler.last_time;
+    }
+    scheduler.last_time = time;
+    if (!wants_frame(scheduler) || time < due) {
+        return false;
+    }
+
+    scheduler.dirty = false;
+    scheduler.last_frame = time;
+    scheduler.frames++;
+    return true;
+}
+
+const char* frame_policy_name(FramePolicy policy)
+{
+    return policy == FRAME_CONTINUOUS ? "continuously" : "on demand";
+}
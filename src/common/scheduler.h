@@ -0,0 +1,38 @@
+#ifndef SCHEDULER_H_INCLUDED
+#define SCHEDULER_H_INCLUDED
+
+#include <GLFW/glfw3.h>
+
+// When the frame loop renders
+enum FramePolicy : int {
+    FRAME_CONTINUOUS, // every vblank
+    FRAME_ON_DEMAND,  // when the scene is dirty or animating, else waits for events
+};
+
+// Decides in the frame loop whether to render a frame, and sleeps in
+// glfwWaitEventsTimeout() when not. Input, resizes and reloads mark the
+// scene dirty through request_redraw(), an animating scene is always dirty.
+// Unfocused windows render at most every `unfocused_interval` seconds and
+// iconified ones not at all.
+struct FrameScheduler {
+    FramePolicy policy{FRAME_ON_DEMAND};
+    bool dirty{true};
+    bool animating{};
+    bool focused{true};
+    bool iconified{};
+    double unfocused_interval{0.1};
+    double idle_timeout{0.5};  // longest sleep, so that polled input such as gamepads still works
+    double animation_time{};   // seconds the scene has animated, stops while it does not
+    double last_time{};        // of the last wait_for_frame()
+    double last_frame{-1.0};   // time of the last frame rendered
+    long long frames{};        // rendered
+};
+
+extern void set_scheduler_callbacks(FrameScheduler& scheduler, GLFWwindow* window);
+extern void request_redraw(FrameScheduler& scheduler);
+extern void set_animating(FrameScheduler& scheduler, bool animating);
+extern void set_window_focused(FrameScheduler& scheduler, bool focused);
+extern bool wait_for_frame(FrameScheduler& scheduler);
+extern const char* frame_policy_name(FramePolicy policy);
+
+#endif // SCHEDULER_H_INCLUDED
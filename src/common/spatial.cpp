@@ -0,0 +1,292 @@
+#include <algorithm>
+#include "spatial.h"
+
+static float perimeter(glm::vec2 min, glm::vec2 max)
+{
+    return 2.0f * (max.x - min.x + max.y - min.y);
+}
+
+static bool contains(const SpatialNode& outer, glm::vec2 min, glm::vec2 max)
+{
+    return outer.min.x <= min.x && outer.min.y <= min.y && max.x <= outer.max.x && max.y <= outer.max.y;
+}
+
+static void bounds(const glm::vec2 (&vertices)[3], glm::vec2& min, glm::vec2& max)
+{
+    min = glm::min(glm::min(vertices[0], vertices[1]), vertices[2]);
+    max = glm::max(glm::max(vertices[0], vertices[1]), vertices[2]);
+}
+
+static int allocate_node(SpatialIndex& index)
+{
+    if (index.free_node < 0) {
+        index.nodes.emplace_back();
+        return static_cast<int>(index.nodes.size()) - 1;
+    }
+    const int node = index.free_node;
+    index.free_node = index.nodes[node].parent;
+    index.nodes[node] = SpatialNode{};
+    return node;
+}
+
+static void free_node(SpatialIndex& index, int node)
+{
+    index.nodes[node] = SpatialNode{};
+    index.nodes[node].parent = index.free_node;
+    index.nodes[node].height = -1;
+    index.free_node = node;
+}
+
+static void fit(SpatialIndex& index, int node)
+{
+    SpatialNode& n = index.nodes[node];
+    const SpatialNode& left = index.nodes[n.left];
+    const SpatialNode& right = index.nodes[n.right];
+    n.min = glm::min(left.min, right.min);
+    n.max = glm::max(left.max, right.max);
+    n.height = 1 + std::max(left.height, right.height);
+}
+
+// Rotates the taller grandchild of `a` up if its children differ in height
+// by more than one. Returns the node that now takes the place of `a`.
+static int balance(SpatialIndex& index, int a)
+{
+    std::vector<SpatialNode>& nodes = index.nodes;
+    if (nodes[a].left < 0 || nodes[a].height < 2) {
+        return a;
+    }
+
+    const int b = nodes[a].left;
+    const int c = nodes[a].right;
+    const int difference = nodes[c].height - nodes[b].height;
+    if (difference >= -1 && difference <= 1) {
+        return a;
+    }
+
+    // Lift the taller child `up` of `a`, and give `a` the shorter child of `up`
+    const int up = difference > 1 ? c : b;
+    const int stay = difference > 1 ? b : c;
+    const int f = nodes[up].left;
+    const int g = nodes[up].right;
+    const int keep = nodes[f].height > nodes[g].height ? f : g;
+    const int give = keep == f ? g : f;
+
+    nodes[up].left = a;
+    nodes[up].right = keep;
+    nodes[up].parent = nodes[a].parent;
+    nodes[a].parent = up;
+    if (nodes[up].parent < 0) {
+        index.root = up;
+    }
+    else if (nodes[nodes[up].parent].left == a) {
+        nodes[nodes[up].parent].left = up;
+    }
+    else {
+        nodes[nodes[up].parent].right = up;
+    }
+
+    nodes[a].left = stay;
+    nodes[a].right = give;
+    nodes[give].parent = a;
+    fit(index, a);
+    fit(index, up);
+    return up;
+}
+
+// Refits and rebalances the ancestors of `node`, from the bottom up
+static void refit(SpatialIndex& index, int node)
+{
+    while (node >= 0) {
+        node = balance(index, node);
+        fit(index, node);
+        node = index.nodes[node].parent;
+    }
+}
+
+static void insert_leaf(SpatialIndex& index, int leaf)
+{
+    std::vector<SpatialNode>& nodes = index.nodes;
+    if (index.root < 0) {
+        index.root = leaf;
+        nodes[leaf].parent = -1;
+        return;
+    }
+
+    // Descend towards the sibling whose box grows the least, counting the
+    // growth of every box on the way
+    const glm::vec2 min = nodes[leaf].min, max = nodes[leaf].max;
+    int sibling = index.root;
+    while (nodes[sibling].left >= 0) {
+        const SpatialNode& n = nodes[sibling];
+        const float area = perimeter(n.min, n.max);
+        const float combined = perimeter(glm::min(n.min, min), glm::max(n.max, max));
+        const float cost = 2.0f * combined;           // a new parent of `leaf` and this node
+        const float inheritance = 2.0f * (combined - area); // growth of this node if we descend
+
+        float child_cost[2]{};
+        const int children[2]{n.left, n.right};
+        for (int i{}; i < 2; i++) {
+            const SpatialNode& child = nodes[children[i]];
+            const float enlarged = perimeter(glm::min(child.min, min), glm::max(child.max, max));
+            child_cost[i] = child.left < 0 ? enlarged + inheritance :
+                enlarged - perimeter(child.min, child.max) + inheritance;
+        }
+        if (cost < child_cost[0] && cost < child_cost[1]) {
+            break;
+        }
+        sibling = child_cost[0] < child_cost[1] ? n.left : n.right;
+    }
+
+    const int old_parent = nodes[sibling].parent;
+    const int parent = allocate_node(index);
+    nodes[parent].parent = old_parent;
+    nodes[parent].left = sibling;
+    nodes[parent].right = leaf;
+    nodes[sibling].parent = parent;
+    nodes[leaf].parent = parent;
+    if (old_parent < 0) {
+        index.root = parent;
+    }
+    else if (nodes[old_parent].left == sibling) {
+        nodes[old_parent].left = parent;
+    }
+    else {
+        nodes[old_parent].right = parent;
+    }
+    refit(index, parent);
+}
+
+static void remove_leaf(SpatialIndex& index, int leaf)
+{
+    std::vector<SpatialNode>& nodes = index.nodes;
+    if (leaf == index.root) {
+        index.root = -1;
+        return;
+    }
+
+    const int parent = nodes[leaf].parent;
+    const int grandparent = nodes[parent].parent;
+    const int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+    nodes[sibling].parent = grandparent;
+    if (grandparent < 0) {
+        index.root = sibling;
+    }
+    else {
+        if (nodes[grandparent].left == parent) {
+            nodes[grandparent].left = sibling;
+        }
+        else {
+            nodes[grandparent].right = sibling;
+        }
+    }
+    free_node(index, parent);
+    refit(index, grandparent);
+}
+
+static void set_leaf_bounds(SpatialIndex& index, int leaf, const glm::vec2 (&vertices)[3])
+{
+    glm::vec2 min{}, max{};
+    bounds(vertices, min, max);
+    const glm::vec2 margin = index.margin * (max - min);
+    index.nodes[leaf].min = min - margin;
+    index.nodes[leaf].max = max + margin;
+}
+
+/**
+ * Adds a triangle on top of the shapes already in `index`.
+ * `vertices` specifies the triangle in world space.
+ * Returns the id of the shape, its position in the stacking order.
+ */
+int insert_shape(SpatialIndex& index, const glm::vec2 (&vertices)[3])
+{
+    const int leaf = allocate_node(index);
+    const int shape = static_cast<int>(index.shapes.size());
+    index.nodes[leaf].shape = shape;
+    set_leaf_bounds(index, leaf, vertices);
+    index.shapes.emplace_back(SpatialShape{{vertices[0], vertices[1], vertices[2]}, leaf});
+    set_edge_triangle(index.edges, shape, vertices);
+    insert_leaf(index, leaf);
+    return shape;
+}
+
+/**
+ * Replaces the vertices of `shape` after a move, rotation or scale. The tree
+ * only changes when the triangle leaves the enlarged box of its leaf.
+ */
+void update_shape(SpatialIndex& index, int shape, const glm::vec2 (&vertices)[3])
+{
+    SpatialShape& s = index.shapes[shape];
+    std::copy(std::begin(vertices), std::end(vertices), std::begin(s.vertices));
+    set_edge_triangle(index.edges, shape, vertices);
+
+    glm::vec2 min{}, max{};
+    bounds(vertices, min, max);
+    if (contains(index.nodes[s.leaf], min, max)) {
+        return;
+    }
+    remove_leaf(index, s.leaf);
+    set_leaf_bounds(index, s.leaf, vertices);
+    insert_leaf(index, s.leaf);
+}
+
+// Removes `shape`, keeping the ids of the other shapes
+void remove_shape(SpatialIndex& index, int shape)
+{
+    SpatialShape& s = index.shapes[shape];
+    remove_leaf(index, s.leaf);
+    free_node(index, s.leaf);
+    clear_edge_triangle(index.edges, shape);
+    s.leaf = -1;
+}
+
+/**
+ * Returns the top-most shape containing `p`, or -1 if there is none.
+ * Every leaf whose box contains `p` is visited, as the stacking order is
+ * not spatial, and their triangles are then tested together by the SIMD
+ * kernel of edges.h.
+ */
+int pick_shape(const SpatialIndex& index, glm::vec2 p)
+{
+    if (index.root < 0) {
+        return -1;
+    }
+
+    int stack[64];
+    int top{};
+    std::vector<int> overflow;
+    std::vector<int> candidates;
+    stack[top++] = index.root;
+    while (top > 0 || !overflow.empty()) {
+        int node{};
+        if (!overflow.empty()) {
+            node = overflow.back();
+            overflow.pop_back();
+        }
+        else {
+            node = stack[--top];
+        }
+
+        const SpatialNode& n = index.nodes[node];
+        if (p.x < n.min.x || p.y < n.min.y || p.x > n.max.x || p.y > n.max.y) {
+            continue;
+        }
+        if (n.left < 0) {
+            candidates.emplace_back(n.shape);
+            continue;
+        }
+        for (const int child : {n.left, n.right}) {
+            if (top < 64) {
+                stack[top++] = child;
+            }
+            else {
+                overflow.emplace_back(child);
+            }
+        }
+    }
+    return find_triangle(index.edges, candidates.data(), static_cast<int>(candidates.size()), p);
+}
+
+int spatial_height(const SpatialIndex& index)
+{
+    return index.root < 0 ? 0 : index.nodes[index.root].height;
+}
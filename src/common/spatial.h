@@ -0,0 +1,44 @@
+#ifndef SPATIAL_H_INCLUDED
+#define SPATIAL_H_INCLUDED
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "edges.h"
+
+// A triangle in world space. Shapes inserted later are on top.
+struct SpatialShape {
+    glm::vec2 vertices[3];
+    int leaf{-1}; // node of the shape, -1 once removed
+};
+
+// Node of the tree. Leaves hold one shape and a box enlarged by a margin,
+// so that small moves stay inside it and need no change to the tree.
+struct SpatialNode {
+    glm::vec2 min{};
+    glm::vec2 max{};
+    int parent{-1};
+    int left{-1};   // -1 for a leaf
+    int right{-1};
+    int shape{-1};
+    int height{};   // 0 for a leaf, also links free nodes through `parent`
+};
+
+// Dynamic bounding volume hierarchy over triangles for picking. Inserting
+// picks the sibling that grows the tree's perimeter the least and rebalances
+// with rotations; moving a shape outside its enlarged box reinserts its leaf.
+struct SpatialIndex {
+    std::vector<SpatialNode> nodes;
+    std::vector<SpatialShape> shapes;
+    EdgeTriangles edges; // of the shapes, by shape id
+    int root{-1};
+    int free_node{-1};
+    float margin{0.1f}; // enlargement of each side of the leaf boxes, relative to their size
+};
+
+extern int insert_shape(SpatialIndex& index, const glm::vec2 (&vertices)[3]);
+extern void update_shape(SpatialIndex& index, int shape, const glm::vec2 (&vertices)[3]);
+extern void remove_shape(SpatialIndex& index, int shape);
+extern int pick_shape(const SpatialIndex& index, glm::vec2 p);
+extern int spatial_height(const SpatialIndex& index);
+
+#endif // SPATIAL_H_INCLUDED
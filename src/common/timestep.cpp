@@ -0,0 +1,48 @@
+#include <algorithm>
+#include "timestep.h"
+
+// Advances every frame by `frame_time` seconds, ignoring the clock
+void set_deterministic(FixedTimestep& timestep, double frame_time)
+{
+    timestep.deterministic = true;
+    timestep.frame_time = frame_time;
+}
+
+/**
+ * Adds the time since the last frame, `now` being seconds on any clock,
+ * e.g. glfwGetTime(). The first frame adds none. After a long stall, the
+ * time beyond `max_ticks` ticks is dropped, so the simulation slows down
+ * rather than falling further behind.
+ */
+void begin_timestep(FixedTimestep& timestep, double now)
+{
+    double elapsed = timestep.frame_time;
+    if (!timestep.deterministic) {
+        elapsed = timestep.last_time < 0.0 ? 0.0 : now - timestep.last_time;
+        timestep.last_time = now;
+    }
+    timestep.accumulator = std::min(timestep.accumulator + std::max(elapsed, 0.0), timestep.max_ticks * timestep.tick);
+}
+
+// Returns whether there is a tick to simulate, and then consumes it
+bool next_tick(FixedTimestep& timestep)
+{
+    if (timestep.accumulator < timestep.tick) {
+        return false;
+    }
+    timestep.accumulator -= timestep.tick;
+    timestep.time = ++timestep.ticks * timestep.tick;
+    return true;
+}
+
+// Returns how far the frame is between the last tick and the next, in [0, 1)
+double timestep_alpha(const FixedTimestep& timestep)
+{
+    return timestep.accumulator / timestep.tick;
+}
+
+// Returns the simulated time of the frame, between the last tick and the next
+double timestep_time(const FixedTimestep& timestep)
+{
+    return timestep.time + timestep.accumulator;
+}
@@ -0,0 +1,27 @@
+#ifndef TIMESTEP_H_INCLUDED
+#define TIMESTEP_H_INCLUDED
+
+// Advances a simulation in ticks of a fixed length, however often frames
+// are rendered. Each frame calls begin_timestep() with the current time,
+// runs an update for each next_tick(), and renders its state interpolated
+// by timestep_alpha() between the last two ticks. In deterministic mode
+// every frame advances by `frame_time`, for benchmarks and replays whose
+// results must not depend on the machine or the frame cap.
+struct FixedTimestep {
+    double tick{1.0 / 120.0}; // simulated seconds per update
+    double time{};            // simulated seconds, a whole number of ticks
+    double accumulator{};     // seconds to simulate
+    double last_time{-1.0};   // of the last begin_timestep(), -1 before the first
+    long long ticks{};
+    int max_ticks{8};         // per frame, so that a stall does not snowball
+    bool deterministic{};
+    double frame_time{1.0 / 60.0}; // seconds per frame in deterministic mode
+};
+
+extern void set_deterministic(FixedTimestep& timestep, double frame_time);
+extern void begin_timestep(FixedTimestep& timestep, double now);
+extern bool next_tick(FixedTimestep& timestep);
+extern double timestep_alpha(const FixedTimestep& timestep);
+extern double timestep_time(const FixedTimestep& timestep);
+
+#endif // TIMESTEP_H_INCLUDED
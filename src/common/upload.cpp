@@ -0,0 +1,212 @@
+#include "glad.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fmt/core.h>
+#include "upload.h"
+
+constexpr GLsizeiptr STAGING_ALIGNMENT{64};
+
+// Frees the space of the leading allocations that the GPU has copied out
+static void reclaim(UploadService& us)
+{
+    while (!us.allocations.empty() && us.allocations.front().done) {
+        us.tail = us.allocations.front().end;
+        us.allocations.pop_front();
+        us.first_allocation++;
+    }
+    if (us.allocations.empty()) {
+        us.tail = us.head;
+    }
+}
+
+static void upload_main(UploadService& us)
+{
+    glfwMakeContextCurrent(us.context);
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &us.staging);
+    glNamedBufferStorage(us.staging, us.capacity, nullptr, flags);
+    {
+        std::lock_guard<std::mutex> lock{us.mutex};
+        us.mapped = static_cast<unsigned char*>(glMapNamedBufferRange(us.staging, 0, us.capacity, flags));
+        us.ready = true;
+    }
+    us.space.notify_all();
+
+    std::deque<InflightCopies> inflight;
+    for (;;) {
+        std::vector<StagedCopy> copies;
+        {
+            std::unique_lock<std::mutex> lock{us.mutex};
+            if (inflight.empty()) {
+                us.work.wait(lock, [&us] { return !us.queued.empty() || us.stop; });
+            }
+            else {
+                us.work.wait_for(lock, std::chrono::milliseconds{1}, [&us] { return !us.queued.empty(); });
+            }
+            if (us.stop && us.queued.empty() && inflight.empty()) {
+                break;
+            }
+            copies.swap(us.queued);
+        }
+
+        // One batch of copies, a fence for the render thread to wait on, and
+        // another for this thread to know when the staging space is free
+        if (!copies.empty()) {
+            InflightCopies batch;
+            for (const StagedCopy& copy : copies) {
+                glCopyNamedBufferSubData(us.staging, copy.dst, copy.src_offset, copy.dst_offset, copy.size);
+                batch.allocations.emplace_back(copy.allocation);
+            }
+            const GLsync render_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+            inflight.emplace_back(std::move(batch));
+
+            std::lock_guard<std::mutex> lock{us.mutex};
+            us.published.emplace_back(copies.back().ticket, render_fence);
+        }
+
+        bool freed{};
+        while (!inflight.empty() &&
+               glClientWaitSync(inflight.front().fence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+            glDeleteSync(inflight.front().fence);
+            std::lock_guard<std::mutex> lock{us.mutex};
+            for (const std::uint64_t allocation : inflight.front().allocations) {
+                us.allocations[allocation - us.first_allocation].done = true;
+            }
+            reclaim(us);
+            inflight.pop_front();
+            freed = true;
+        }
+        if (freed) {
+            us.space.notify_all();
+        }
+    }
+
+    glUnmapNamedBuffer(us.staging);
+    glDeleteBuffers(1, &us.staging);
+    glfwMakeContextCurrent(nullptr);
+}
+
+/**
+ * Creates the upload context and starts the upload thread. Must be called
+ * on the main thread, as it creates a window.
+ * `window` specifies the window whose context shares objects with the upload context.
+ * `capacity` specifies the size of the staging ring in bytes.
+ */
+void create_upload_service(UploadService& us, GLFWwindow* window, GLsizeiptr capacity)
+{
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    us.context = glfwCreateWindow(1, 1, "upload", nullptr, window);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (!us.context) {
+        fmt::print(stderr, "ERROR: cannot create the upload context\n");
+        exit(EXIT_FAILURE);
+    }
+    us.capacity = capacity;
+    us.thread = std::thread{upload_main, std::ref(us)};
+}
+
+// Finishes the queued uploads and stops the upload thread. Must be called on the main thread.
+void delete_upload_service(UploadService& us)
+{
+    {
+        std::lock_guard<std::mutex> lock{us.mutex};
+        us.stop = true;
+    }
+    us.work.notify_one();
+    us.thread.join();
+    for (const auto& [ticket, fence] : us.published) {
+        glDeleteSync(fence);
+    }
+    glfwDestroyWindow(us.context);
+}
+
+/**
+ * Reserves `size` bytes of staging memory, waiting for earlier uploads to
+ * free space if needed. Safe to call from any thread.
+ * `size` must not exceed the capacity of the service.
+ */
+StagingRange begin_upload(UploadService& us, GLsizeiptr size)
+{
+    const GLsizeiptr aligned = (size + STAGING_ALIGNMENT - 1) / STAGING_ALIGNMENT * STAGING_ALIGNMENT;
+
+    std::unique_lock<std::mutex> lock{us.mutex};
+    GLsizeiptr begin{};
+    us.space.wait(lock, [&us, aligned, &begin] {
+        // Skip the end of the ring if the range would wrap around
+        const GLsizeiptr offset = us.head % us.capacity;
+        begin = offset + aligned > us.capacity ? us.head + us.capacity - offset : us.head;
+        return us.ready && begin + aligned - us.tail <= us.capacity;
+    });
+    us.head = begin + aligned;
+    us.allocations.emplace_back(StagingAllocation{begin, us.head, false});
+
+    StagingRange range;
+    range.offset = begin % us.capacity;
+    range.data = us.mapped + range.offset;
+    range.size = size;
+    range.allocation = us.first_allocation + us.allocations.size() - 1;
+    return range;
+}
+
+/**
+ * Queues the copy of `range`, once written, to `dst` at `dst_offset`.
+ * Safe to call from any thread.
+ * Returns a ticket for upload_visible(), increasing with every call.
+ */
+std::uint64_t end_upload(UploadService& us, const StagingRange& range, GLuint dst, GLintptr dst_offset)
+{
+    std::uint64_t ticket{};
+    {
+        std::lock_guard<std::mutex> lock{us.mutex};
+        ticket = us.next_ticket++;
+        us.queued.emplace_back(StagedCopy{range.offset, dst, dst_offset, range.size, range.allocation, ticket});
+    }
+    us.work.notify_one();
+    return ticket;
+}
+
+// Copies `data` through the staging ring in pieces of up to a quarter of it.
+// Returns the ticket of the last piece.
+std::uint64_t upload_buffer_data(UploadService& us, GLuint dst, GLintptr dst_offset, const void* data, GLsizeiptr size)
+{
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    const GLsizeiptr piece_size = std::max<GLsizeiptr>(us.capacity / 4, 1);
+    std::uint64_t ticket{};
+    for (GLsizeiptr offset{}; offset < size; offset += piece_size) {
+        const StagingRange range = begin_upload(us, std::min(piece_size, size - offset));
+        std::memcpy(range.data, bytes + offset, range.size);
+        ticket = end_upload(us, range, dst, dst_offset + offset);
+    }
+    return ticket;
+}
+
+/**
+ * Makes the render context wait on the GPU for the uploads published since
+ * the last call, without blocking the CPU. Call it on the render thread
+ * before drawing, and rebind the destination buffers after it.
+ * Returns the newest ticket whose data the following commands see.
+ */
+std::uint64_t sync_uploads(UploadService& us)
+{
+    std::vector<std::pair<std::uint64_t, GLsync>> published;
+    {
+        std::lock_guard<std::mutex> lock{us.mutex};
+        published.swap(us.published);
+    }
+    for (const auto& [ticket, fence] : published) {
+        glWaitSync(fence, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(fence);
+        us.visible_ticket = ticket;
+    }
+    return us.visible_ticket;
+}
+
+bool upload_visible(const UploadService& us, std::uint64_t ticket)
+{
+    return ticket <= us.visible_ticket;
+}
@@ -0,0 +1,77 @@
+#ifndef UPLOAD_H_INCLUDED
+#define UPLOAD_H_INCLUDED
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "glad.h"
+#include <GLFW/glfw3.h>
+
+// Space in the staging buffer, returned by begin_upload()
+struct StagingRange {
+    void* data{};          // persistently mapped, writable from any thread
+    GLintptr offset{};     // in the staging buffer
+    GLsizeiptr size{};
+    std::uint64_t allocation{};
+};
+
+struct StagingAllocation {
+    GLsizeiptr begin{}; // monotonic position, wraps modulo the capacity
+    GLsizeiptr end{};
+    bool done{};        // copied out by the GPU, so the space can be reused
+};
+
+struct StagedCopy {
+    GLintptr src_offset{};
+    GLuint dst{};
+    GLintptr dst_offset{};
+    GLsizeiptr size{};
+    std::uint64_t allocation{};
+    std::uint64_t ticket{};
+};
+
+struct InflightCopies {
+    GLsync fence{};
+    std::vector<std::uint64_t> allocations;
+};
+
+// Copies data into buffers from a thread with its own context, which shares
+// objects with the render context. Any thread writes the data into a ring
+// of persistently mapped staging memory, the upload thread copies it to the
+// destination with glCopyNamedBufferSubData and publishes a fence, and the
+// render thread makes its GPU wait on that fence rather than its CPU.
+struct UploadService {
+    GLFWwindow* context{}; // hidden window sharing objects with the render one
+    std::thread thread;
+    GLuint staging{};
+    unsigned char* mapped{};
+    GLsizeiptr capacity{};
+
+    std::mutex mutex;
+    std::condition_variable work;  // wakes the upload thread
+    std::condition_variable space; // wakes threads waiting for staging space
+    GLsizeiptr head{};             // monotonic positions of the staging ring
+    GLsizeiptr tail{};
+    std::deque<StagingAllocation> allocations;
+    std::uint64_t first_allocation{}; // id of allocations.front()
+    std::vector<StagedCopy> queued;
+    std::vector<std::pair<std::uint64_t, GLsync>> published; // newest ticket of a batch, its fence
+    std::uint64_t next_ticket{1};
+    bool ready{};
+    bool stop{};
+
+    std::uint64_t visible_ticket{}; // render thread only
+};
+
+extern void create_upload_service(UploadService& us, GLFWwindow* window, GLsizeiptr capacity = 64 << 20);
+extern void delete_upload_service(UploadService& us);
+extern StagingRange begin_upload(UploadService& us, GLsizeiptr size);
+extern std::uint64_t end_upload(UploadService& us, const StagingRange& range, GLuint dst, GLintptr dst_offset);
+extern std::uint64_t upload_buffer_data(UploadService& us, GLuint dst, GLintptr dst_offset, const void* data, GLsizeiptr size);
+extern std::uint64_t sync_uploads(UploadService& us);
+extern bool upload_visible(const UploadService& us, std::uint64_t ticket);
+
+#endif // UPLOAD_H_INCLUDED